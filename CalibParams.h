@@ -0,0 +1,54 @@
+/**
+ * IIRR -- Intelligent Irrigator Based on ESP8266
+    Copyright (C) 2016--2018  Sergio Queiroz <srmq@cin.ufpe.br>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef _CALIB_PARAMS_H_
+#define _CALIB_PARAMS_H_
+
+#include "sensor_calibration.h"
+
+#define NUM_SENSOR_INPUTS 6
+
+//Calibration of the moisture sensors. Each SensorInput has its own
+//curve moisture = (mulX/resistance)^(1/expFact), used for the readings
+//taken with the probe driven from that input. Defaults are the
+//compile-time constants of sensor_calibration.h.
+class CalibParams {
+public:
+  float mulX[NUM_SENSOR_INPUTS];
+  float expFact[NUM_SENSOR_INPUTS];
+  unsigned long refResistor;
+
+  CalibParams() : refResistor(REFERENCE_RESISTOR) {
+    for (int i = 0; i < NUM_SENSOR_INPUTS; i++) {
+      mulX[i] = MOISTURE_MULX;
+      expFact[i] = MOISTURE_EXPFACT;
+    }
+  }
+
+  inline bool isAllValid() const {
+    bool result = refResistor > 0;
+    for (int i = 0; i < NUM_SENSOR_INPUTS && result; i++) {
+      result = (mulX[i] > 0) && (expFact[i] > 0);
+    }
+    return result;
+  }
+};
+
+extern CalibParams mainCalibParams;
+
+#endif
@@ -22,6 +22,9 @@
 #include "HttpDateParser.h"
 #include "FS.h"
 #include "SensorTask.h"
+#include "SensorLog.h"
+#include "LogIndex.h"
+#include "LogCatalog.h"
 #include <pgmspace.h>
 #include <Arduino.h>
 #include <cstring>
@@ -36,6 +39,7 @@
 
 
 static const char CPARAMS_JSON_FILE[] PROGMEM = "/conf/cparams.json";
+static const char CLOUDACK_JSON_FILE[] PROGMEM = "/var/cloudack.json";
 
 static const char DATALOG_SENDPARAMS_URL[] PROGMEM = "/v100/datalog/send-params";
 static const char MSGLOG_SENDPARAMS_URL[] PROGMEM = "/v100/msglog/send-params";
@@ -51,6 +55,10 @@ static const char USER_AGENT_STR[] PROGMEM = "Android";
 
 
 bool CloudTask::confAvailable = false;
+int8_t CloudTask::syncEnabled = -1;
+time_t CloudTask::ackedDataLogTS = 0;
+time_t CloudTask::ackedMsgLogTS = 0;
+bool CloudTask::ackedRead = false;
 
 static const char FILEDATE_FMT_STR[] PROGMEM = "%04d%02d%02d"; //yyyymmdd
 
@@ -149,77 +157,68 @@ static String getFirstDigitSubstr(const String& str) {
   return str.substring(digitStartAt, subEnd);
 }
 
+//first valid date of a log file of kind, not before the date of aTime, 0 when there is none
+static time_t firstDateToOpen(uint8_t kind, time_t aTime) {
+  const LogSegment *segment = LogCatalog::firstFrom(kind, aTime);
+  while (segment != NULL && !TimeKeeper::isValidTS(segment->date())) {
+    segment = LogCatalog::firstFrom(kind, segment->date() + SECS_PER_DAY);
+  }
+  return (segment != NULL) ? segment->date() : 0;
+}
+
 bool CloudTask::getDatesToOpen(time_t &msgDate, time_t &logDate, time_t lastRepTSLog, time_t lastRepTSMsg, bool checkLog, bool checkMsg) {
-  tmElements_t outTm;
-  TimeKeeper::tkBreakTime(lastRepTSLog, outTm);
-  outTm.Second = 0;
-  outTm.Minute = 0;
-  outTm.Hour = 0;
-  time_t lastDateLog = TimeKeeper::tkMakeTime(outTm);
-
-  TimeKeeper::tkBreakTime(lastRepTSMsg, outTm);
-  outTm.Second = 0;
-  outTm.Minute = 0;
-  outTm.Hour = 0;
-  time_t lastDateMsg = TimeKeeper::tkMakeTime(outTm);
   if(!fsOpen) return false;
-  
+  logDate = checkLog ? firstDateToOpen(LOGKIND_SENSOR, lastRepTSLog) : 0;
+  msgDate = checkMsg ? firstDateToOpen(LOGKIND_MSG, lastRepTSMsg) : 0;
+  return true;
+}
 
-  String logDirStr = String(FPSTR(LOG_DIR));
-  Dir logDir = SPIFFS.openDir(logDirStr);
-  time_t initDateLog = 0;
-  time_t initMsgLog = 0;
-
-  bool finishedMsg = !checkMsg;
-  bool finishedLog = !checkLog;
-  while(logDir.next() && !(finishedMsg && finishedLog)) {
-    String fileName = logDir.fileName();
-    if (SensorTask::isLogFileName(fileName) && !finishedLog) {
-      int year, month, day;
-      if(SensorTask::getLogfileDMY(fileName, day, month, year)) {
-        outTm.Day = day;
-        outTm.Month = month;
-        outTm.Year = (year - 1970);
-        outTm.Second = 0;
-        outTm.Minute = 0;
-        outTm.Hour = 0;
-        time_t logFileTS = TimeKeeper::tkMakeTime(outTm);
-        if (logFileTS >= lastDateLog && TimeKeeper::isValidTS(logFileTS)) {
-          if (initDateLog == 0) {
-            initDateLog = logFileTS;  
-          } else if(logFileTS < initDateLog) {
-            initDateLog = logFileTS; 
-          }
-        }
-        if ((initDateLog != 0) && (initDateLog == lastDateLog)) {
-          finishedLog = true;
-        }
-      }
-    } else if (SensorTask::isMsgFileName(fileName) && !finishedMsg) {
-      int year, month, day;
-      if(SensorTask::getMsgfileDMY(fileName, day, month, year)) {
-        outTm.Day = day;
-        outTm.Month = month;
-        outTm.Year = (year - 1970);
-        outTm.Second = 0;
-        outTm.Minute = 0;
-        outTm.Hour = 0;
-        time_t msgFileTS = TimeKeeper::tkMakeTime(outTm);
-        if (msgFileTS >= lastDateMsg && TimeKeeper::isValidTS(msgFileTS)) {
-          if (initMsgLog == 0) {
-            initMsgLog = msgFileTS;  
-          } else if(msgFileTS < initMsgLog) {
-            initMsgLog = msgFileTS; 
-          }
-        }
-        if ((initMsgLog != 0) && (initMsgLog == lastDateMsg)) {
-          finishedMsg = true; 
-        }
-      }      
-    }
+bool CloudTask::isAcknowledged(uint8_t kind, time_t aTime) {
+  if (!TimeKeeper::isValidTS(aTime) || !confAvailable) return true;
+  if (syncEnabled < 0) {
+    CloudConf conf;
+    syncEnabled = (readCloudConf(conf) && conf.isAllValid() && conf.enabled != 0) ? 1 : 0;
   }
-  logDate = initDateLog;
-  msgDate = initMsgLog;
+  if (!syncEnabled) return true;
+  if (!ackedRead) readAckedTS();
+  return aTime <= ((kind == LOGKIND_SENSOR) ? ackedDataLogTS : ackedMsgLogTS);
+}
+
+//the acknowledged times survive a reboot, so the retention can go on
+//deleting what the cloud has while it is unreachable
+bool CloudTask::readAckedTS() {
+  if (!fsOpen) return false;
+  ackedRead = true;
+  String fileName = String(FPSTR(CLOUDACK_JSON_FILE));
+  File ackFile = SPIFFS.open(fileName, "r");
+  if (!ackFile) return false;
+  DynamicJsonBuffer jsonBuffer(JSON_OBJECT_SIZE(2) + 40);
+  JsonObject& root = jsonBuffer.parseObject(ackFile);
+  ackFile.close();
+  if (!root.success()) return false;
+  //a sync of this boot may have run first
+  const time_t dataLogTS = (time_t) root["datalog"];
+  const time_t msgLogTS = (time_t) root["msglog"];
+  if (dataLogTS > ackedDataLogTS) ackedDataLogTS = dataLogTS;
+  if (msgLogTS > ackedMsgLogTS) ackedMsgLogTS = msgLogTS;
+  return true;
+}
+
+bool CloudTask::updateAckedTS(time_t dataLogTS, time_t msgLogTS) {
+  if (!ackedRead) readAckedTS();
+  if (dataLogTS == ackedDataLogTS && msgLogTS == ackedMsgLogTS) return true; //no flash write
+  ackedDataLogTS = dataLogTS;
+  ackedMsgLogTS = msgLogTS;
+  if (!fsOpen) return false;
+  String fileName = String(FPSTR(CLOUDACK_JSON_FILE));
+  File ackFile = SPIFFS.open(fileName, "w+");
+  if (!ackFile) return false;
+  DynamicJsonBuffer jsonBuffer(JSON_OBJECT_SIZE(2));
+  JsonObject& root = jsonBuffer.createObject();
+  root["datalog"] = ackedDataLogTS;
+  root["msglog"] = ackedMsgLogTS;
+  root.printTo(ackFile);
+  ackFile.close();
   return true;
 }
 
@@ -227,10 +226,14 @@ static const char SSCANF_TSFORMAT[] PROGMEM = "%4d%2d%2dT%2d%2d%2d%*s";
 
 int CloudTask::sendDataLogFromDate(time_t logDate, CloudConf& conf, SendParams &datalogSendParams, std::shared_ptr<String> &outPayLoadPtr, int &outHttpCode) {
   if(TimeKeeper::isValidTS(logDate)) {
-    File logFile = SensorTask::getLogFileWithDateForRead(logDate);
-    if(logFile) {
+    File sensorFile = SensorTask::getLogFileWithDateForRead(logDate);
+    if(sensorFile) {
+      //the binary log is read as the CSV lines it always had
+      SensorLogStream logFile(sensorFile);
       char line[81];
       size_t pos;
+      //the index skips the lines already sent but a few
+      logFile.seek(LogIndex::seekHint(sensorFile, datalogSendParams.lastTS));
 
       bool foundToSend = false;
       while(logFile.available() > 0 && !foundToSend) {
@@ -244,7 +247,7 @@ int CloudTask::sendDataLogFromDate(time_t logDate, CloudConf& conf, SendParams &
           Serial.println(F("logfile successfuly read"));
           time_t ts = TimeKeeper::tkMakeTime(year, month, day, hour, min, secs);
           if (ts > datalogSendParams.lastTS) {
-            logFile.seek(pos, SeekSet);
+            logFile.seek(pos);
             foundToSend = true;
           } else {
             Serial.print(F("log line: \""));
@@ -290,6 +293,7 @@ int CloudTask::sendMsgsFromDate(time_t msgDate, CloudConf& conf, SendParams &msg
     if(msgFile) {
       char line[81];
       size_t pos;
+      msgFile.seek(LogIndex::seekHint(msgFile, msglogSendParams.lastTS), SeekSet);
 
       bool foundToSend = false;
       while(msgFile.available() > 0 && !foundToSend) {
@@ -349,8 +353,13 @@ int CloudTask::syncToCloud(CloudConf& conf) {
   yield();
   time_t newNow = TimeKeeper::tkNow();
   if (!CloudTask::getMsglogSendParams(conf, msglogSendParams)) {
+    if (!ackedRead) readAckedTS();
+    updateAckedTS(datalogSendParams.lastTS, ackedMsgLogTS);
     return CLOUDTASK_SYNCTOCLOUD_UNABLE_GET_MSGLOGPARAMS;
   }
+  if (!updateAckedTS(datalogSendParams.lastTS, msglogSendParams.lastTS)) {
+    Serial.println(F("WARNING: could not save the acknowledged log times"));
+  }
   newNow = TimeKeeper::tkNow() - newNow;
   newNow = msglogSendParams.now + (int)(0.5*newNow);
   if (TimeKeeper::isValidTS(msglogSendParams.now)) {
@@ -706,7 +715,8 @@ void CloudTask::loop()  {
             
             CloudConf conf;
             bool readOk = readCloudConf(conf);
-            if (readOk && conf.isAllValid() && conf.enabled != 0) {
+            syncEnabled = (readOk && conf.isAllValid() && conf.enabled != 0) ? 1 : 0;
+            if (syncEnabled) {
               const int retCode = syncToCloud(conf);
               if (retCode != CLOUDTASK_OK) {
                 Serial.print(F("WARNING: syncToCloud() returned error status code: "));
@@ -753,6 +763,7 @@ bool CloudTask::updateJsonFromConfParams(CloudConf &conf) {
   confFile.flush();
   confFile.close();
   CloudTask::confAvailable = true;
+  CloudTask::syncEnabled = -1;
   return true;
 }
 
@@ -135,6 +135,10 @@ public:
     static bool getMsglogSendParams(CloudConf& conf, SendParams& sendParams); 
     static bool getDatesToOpen(time_t &msgDate, time_t &logDate, time_t lastTSLog, time_t lastTSMsg, bool checkLog = true, bool checkMsg = true);
 
+    //whether the cloud has the log records of kind up to aTime. Always
+    //true with the sync disabled, and for times before the clock was set
+    static bool isAcknowledged(uint8_t kind, time_t aTime);
+
     static bool cloudServiceIsReachable();
     static bool isInternetConnected();
 
@@ -145,12 +149,19 @@ private:
     bool firstRun;
     time_t lastCheck;
     static bool confAvailable;
+    static int8_t syncEnabled; //-1 until the conf is read
+    //lastTS of the send params, what the cloud already has
+    static time_t ackedDataLogTS;
+    static time_t ackedMsgLogTS;
+    static bool ackedRead; //from CLOUDACK_JSON_FILE, once
     bool sentAllDataLogUntilToday;
     bool sentAllMsgLogUntilToday;
 
     //time_t lastTSDataSent;
     //time_t lastTSMsgSent;
 
+    static bool readAckedTS();
+    static bool updateAckedTS(time_t dataLogTS, time_t msgLogTS);
     static bool getEntryPointSendParams(CloudConf& conf, SendParams& sendParams, const String& entryPoint);
     static int sendMsgsFromDate(time_t msgDate, CloudConf& conf, SendParams &msglogSendParams, std::shared_ptr<String> &outPayLoadPtr, int &outHttpCode);
     static int sendDataLogFromDate(time_t logDate, CloudConf& conf, SendParams &datalogSendParams, std::shared_ptr<String> &outPayLoadPtr, int &outHttpCode);
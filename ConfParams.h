@@ -19,16 +19,36 @@
 #ifndef _CONF_PARAMS_H_
 #define _CONF_PARAMS_H_
 
+#include "sensor_calibration.h"
+#include "WeekMinuteMap.h"
+#include "IrrigRules.h"
+#include "PumpGovernor.h"
+
+#define MAX_NOIRR_WINDOWS 16
+#define WEEKDAYS_ALL 0x7F
+
+//no irrigation from initMinute to endMinute of the day, both included, on
+//the weekdays of the mask (bit 0 is Sunday). An endMinute before initMinute
+//goes on past midnight, into the next day
+class NoIrrigWindow {
+public:
+  uint16_t initMinute;
+  uint16_t endMinute;
+  uint8_t weekdays;
+
+  inline bool crossesMidnight() const { return endMinute < initMinute; }
+
+  inline bool isValid() const {
+    return initMinute < MINUTES_PER_DAY && endMinute < MINUTES_PER_DAY
+        && weekdays != 0 && (weekdays & ~WEEKDAYS_ALL) == 0;
+  }
+};
+
 class ConfParams {
 public:  
-  time_t noIrrTime0Init;
-  time_t noIrrTime0End;
-  time_t noIrrTime1Init;
-  time_t noIrrTime1End;
-  time_t noIrrTime2Init;
-  time_t noIrrTime2End;
-  time_t noIrrTime3Init;
-  time_t noIrrTime3End;
+  NoIrrigWindow noIrrWindows[MAX_NOIRR_WINDOWS]; //sorted by initMinute
+  uint8_t numNoIrrWindows;
+  bool noIrrWindowsValid; //false once a window was rejected by addNoIrrWindow()
   
   unsigned int irrSlotSeconds;
   unsigned int irrMIntervMins;
@@ -36,37 +56,108 @@ public:
   float critLevel;
   float satLevel;
   unsigned long normalPulsesPerSec;
+  float probeTolerance;    //adaptive sampling stops when the median is known within this moisture, 0 disables it
+  unsigned int maxProbes;  //probes per depth cap in adaptive sampling, 0 means NUM_PROBES
+  float pulsesPerLiter;    //flow sensor factor, 0 disables the totalizer
+  float irrMaxLitersDay;   //daily budget in liters instead of irrMaxTimeDaySeconds, 0 disables it
+  float doseLitersPerLevel; //dosing: liters that raise the moisture one unit of satLevel, 0 disables it
+  unsigned int numZones;   //probe banks and valves in use, up to ZONES_ON_BOARD
+  IrrigProgram startRules;
+  IrrigProgram stopRules;
+  float budgetSlotFraction; //of a slot that must be left of the daily budget to start a zone
+  float deepIncreaseFraction; //of the way from deep at start to satLevel that ends a zone
+  unsigned int flowSettleSecs; //before the flow rate is checked after a start, the ISR guard needs FLOW_COLLAPSE_LONG_PERIODS late edges
+  unsigned int predictHorizonMins; //drying forecasts looked at, 0 (as when missing) disables watering ahead of critLevel
+  unsigned int predictLeadMins; //a zone is watered this early before its last allowed start
+  //pump governor, 0 (as when missing from the file) turns each one off
+  float hystFraction;      //of the way from critLevel to satLevel, band of the level latches
+  unsigned int minRunSecs; //the rules cannot stop the pump sooner after a start
+  unsigned int minRestSecs; //nor start it sooner after a stop
+  unsigned int maxStartsPerHour; //0 is no cap
+  float fsHighWater;       //of the FS in use that starts the deletion of the oldest logs
+  float fsLowWater;        //and that ends it
+  float sensorLogQuota;    //of the FS the sensor logs may take, 0 is no quota
+  float msgLogQuota;       //of the FS the message logs may take, 0 is no quota
 
   ConfParams() : 
-      noIrrTime0Init(0), 
-      noIrrTime0End(0), 
-      noIrrTime1Init(0), 
-      noIrrTime1End(0), 
-      noIrrTime2Init(0), 
-      noIrrTime2End(0), 
-      noIrrTime3Init(0), 
-      noIrrTime3End(0),
+      numNoIrrWindows(0),
+      noIrrWindowsValid(true),
       irrSlotSeconds(0),
       irrMIntervMins(0),
       irrMaxTimeDaySeconds(0),
       critLevel(0),
       satLevel(0),
-      normalPulsesPerSec(0) { }
+      normalPulsesPerSec(0),
+      probeTolerance(0),
+      maxProbes(0),
+      pulsesPerLiter(0),
+      irrMaxLitersDay(0),
+      doseLitersPerLevel(0),
+      numZones(1),
+      startRules(RULES_START),
+      stopRules(RULES_STOP),
+      budgetSlotFraction(0.2),
+      deepIncreaseFraction(0.5),
+      flowSettleSecs(60),
+      predictHorizonMins(0),
+      predictLeadMins(0),
+      hystFraction(0),
+      minRunSecs(0),
+      minRestSecs(0),
+      maxStartsPerHour(0),
+      fsHighWater(0.85),
+      fsLowWater(0.7),
+      sensorLogQuota(0.5),
+      msgLogQuota(0.2) { }
 
-   inline bool isEmptyInterval(time_t initialTime, time_t endTime) {
-
-     return (initialTime == 0) && (endTime == 0);
+   //keeps the windows sorted, false when the window is not valid or there is no room for it
+   bool addNoIrrWindow(const NoIrrigWindow& window) {
+     if (!window.isValid() || numNoIrrWindows >= MAX_NOIRR_WINDOWS) {
+       noIrrWindowsValid = false;
+       return false;
+     }
+     int i = numNoIrrWindows;
+     for (; i > 0 && noIrrWindows[i-1].initMinute > window.initMinute; i--) {
+       noIrrWindows[i] = noIrrWindows[i-1];
+     }
+     noIrrWindows[i] = window;
+     numNoIrrWindows++;
+     return true;
    }
-   inline bool isValidOrEmptyInterval(time_t initialTime, time_t endTime) {
-     return isEmptyInterval(initialTime, endTime) || (endTime > initialTime);
+
+   inline void clearNoIrrWindows() {
+     numNoIrrWindows = 0;
+     noIrrWindowsValid = true;
    }
+
    inline bool isAllValid() {
-     return isValidOrEmptyInterval(noIrrTime0Init, noIrrTime0End) &&
-        isValidOrEmptyInterval(noIrrTime1Init, noIrrTime1End) &&
-        isValidOrEmptyInterval(noIrrTime2Init, noIrrTime2End) &&
-        isValidOrEmptyInterval(noIrrTime3Init, noIrrTime3End) &&
+     return noIrrWindowsValid &&
         irrSlotSeconds > 0 && irrMIntervMins > 0 && irrMaxTimeDaySeconds > 0 && critLevel >= 0
-        && critLevel < 100 && satLevel > critLevel && satLevel > 0 && satLevel <= 100;
+        && critLevel < 100 && satLevel > critLevel && satLevel > 0 && satLevel <= 100
+        && probeTolerance >= 0 && maxProbes <= MAX_PROBES && (maxProbes == 0 || maxProbes >= MIN_PROBES)
+        && pulsesPerLiter >= 0 && irrMaxLitersDay >= 0 && doseLitersPerLevel >= 0
+        && numZones >= 1 && numZones <= ZONES_ON_BOARD
+        && startRules.isValid() && stopRules.isValid()
+        && budgetSlotFraction >= 0 && budgetSlotFraction <= 1
+        && deepIncreaseFraction >= 0 && deepIncreaseFraction <= 1
+        && hystFraction >= 0 && hystFraction < 1 && maxStartsPerHour <= PUMP_START_HISTORY
+        && fsLowWater > 0 && fsLowWater < fsHighWater && fsHighWater <= 1
+        && sensorLogQuota >= 0 && sensorLogQuota <= 1 && msgLogQuota >= 0 && msgLogQuota <= 1;
+   }
+
+   //band of the critLevel and satLevel latches
+   inline float levelBand() const {
+     return hystFraction*(satLevel - critLevel);
+   }
+
+   //dosing needs the totalizer
+   inline bool hasDosing() const {
+     return doseLitersPerLevel > 0 && pulsesPerLiter > 0;
+   }
+
+   //liters budget needs the totalizer
+   inline bool hasVolumeBudget() const {
+     return irrMaxLitersDay > 0 && pulsesPerLiter > 0;
    }
    
 };
@@ -0,0 +1,119 @@
+/**
+ * IIRR -- Intelligent Irrigator Based on ESP8266
+    Copyright (C) 2016--2018  Sergio Queiroz <srmq@cin.ufpe.br>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "DryingRate.h"
+#include <math.h>
+
+DryingRate::DryingRate() : hourKnown(0) {
+  for (int i = 0; i < HOURS_PER_DAY; i++) hourDrop[i] = 0;
+  reset();
+}
+
+void DryingRate::reset() {
+  firstTime = lastTime = 0;
+  sumW = sumT = sumTT = sumM = sumTM = 0;
+  openHour = -1;
+  openMoisture = 0;
+}
+
+void DryingRate::add(time_t aTime, float moisture) {
+  const bool restart = (firstTime == 0 || aTime < lastTime); //first reading, or the clock went back
+  const bool contiguous = !restart && (aTime - lastTime) < SECS_PER_HOUR;
+  if (restart) {
+    reset();
+    firstTime = aTime;
+  } else {
+    //decay, then move the time origin to the new reading
+    const float dt = (aTime - lastTime)/(float)SECS_PER_HOUR;
+    const float decay = expf(-dt/DRYING_TAU_HOURS);
+    sumW *= decay;
+    sumT *= decay;
+    sumTT *= decay;
+    sumM *= decay;
+    sumTM *= decay;
+    sumTT += dt*(dt*sumW - 2*sumT);
+    sumTM -= dt*sumM;
+    sumT -= dt*sumW;
+  }
+  const int8_t lastHour = (lastTime != 0) ? elapsedSecsToday(lastTime)/SECS_PER_HOUR : -1;
+  lastTime = aTime;
+  sumW += 1;
+  sumM += moisture;
+  const int8_t hourNow = elapsedSecsToday(aTime)/SECS_PER_HOUR;
+  if (hourNow != lastHour) stepProfile(hourNow, contiguous);
+}
+
+//at the first reading of an hour the hour before, if measured from its
+//start, is folded into the profile; hours the soil got water in are not
+void DryingRate::stepProfile(int8_t hourNow, bool contiguous) {
+  if (!hasSpan()) {
+    openHour = -1;
+    return;
+  }
+  const float moisture = currMoisture();
+  if (contiguous && openHour >= 0 && hourNow == (openHour + 1) % HOURS_PER_DAY) {
+    const float drop = openMoisture - moisture;
+    if (drop >= 0) {
+      const uint32_t bit = 1ul << openHour;
+      hourDrop[openHour] = (hourKnown & bit) ? hourDrop[openHour] + DRYING_PROFILE_WEIGHT*(drop - hourDrop[openHour]) : drop;
+      hourKnown |= bit;
+    }
+  }
+  openHour = hourNow;
+  openMoisture = moisture;
+}
+
+float DryingRate::slope() const {
+  const float det = sumW*sumTT - sumT*sumT;
+  if (det <= 0) return 0;
+  return (sumW*sumTM - sumT*sumM)/det;
+}
+
+float DryingRate::perHour() const {
+  if (!hasSpan()) return 0;
+  const float rate = -slope();
+  return (rate > 0) ? rate : 0;
+}
+
+float DryingRate::currMoisture() const {
+  if (sumW <= 0) return 0;
+  return (sumM - slope()*sumT)/sumW;
+}
+
+long DryingRate::secsToLevel(float level, long maxSecs) const {
+  if (!hasSpan()) return -1;
+  float above = currMoisture() - level;
+  if (above <= 0) return 0;
+  const float currRate = perHour();
+  long secs = 0;
+  time_t aTime = lastTime;
+  while (secs <= maxSecs) {
+    const int hour = elapsedSecsToday(aTime)/SECS_PER_HOUR;
+    const long hourSecs = SECS_PER_HOUR - elapsedSecsToday(aTime)%SECS_PER_HOUR;
+    const float rate = (hourKnown & (1ul << hour)) ? hourDrop[hour] : currRate;
+    const float drop = rate*hourSecs/SECS_PER_HOUR;
+    if (drop >= above) {
+      secs += (long)(above/rate*SECS_PER_HOUR);
+      return (secs <= maxSecs) ? secs : -1;
+    }
+    above -= drop;
+    secs += hourSecs;
+    aTime += hourSecs;
+  }
+  return -1;
+}
@@ -0,0 +1,73 @@
+/**
+ * IIRR -- Intelligent Irrigator Based on ESP8266
+    Copyright (C) 2016--2018  Sergio Queiroz <srmq@cin.ufpe.br>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef _DRYING_RATE_H_
+#define _DRYING_RATE_H_
+
+#include <Arduino.h>
+#include <TimeLib.h>
+
+#define DRYING_TAU_HOURS 3.0f     //readings lose weight by e in this time
+#define DRYING_MIN_SPAN_SECS 1800 //of readings before a rate is given
+#define DRYING_PROFILE_WEIGHT 0.5f //of the last day in the drop of an hour of the day
+#define HOURS_PER_DAY 24
+
+//Online estimate of how fast one depth of a zone dries. The current rate
+//is the slope of a least squares line over the readings, weighted by
+//exp(-age/DRYING_TAU_HOURS); the sums are kept with the last reading at
+//time 0, so they stay small however long the soil dries. Evaporation
+//follows the sun, so the drop of each whole hour of the day is also
+//learned across days, and forecasts go hour by hour on that profile,
+//with the current rate for the hours not learned yet.
+class DryingRate {
+public:
+  DryingRate();
+
+  //the readings so far are forgotten, as after the zone is watered; the profile is kept
+  void reset();
+  void add(time_t aTime, float moisture);
+
+  //moisture lost per hour now, 0 while the soil is not drying or there are too few readings
+  float perHour() const;
+  //moisture of the line at the last reading
+  float currMoisture() const;
+  //seconds from the last reading until the moisture reaches level, 0 if it
+  //is already at or below it, -1 when that is not within maxSecs or not known
+  long secsToLevel(float level, long maxSecs) const;
+
+private:
+  time_t firstTime;
+  time_t lastTime;
+  //weighted sums of 1, t, t*t, m and t*m, t in hours before the last reading
+  float sumW;
+  float sumT;
+  float sumTT;
+  float sumM;
+  float sumTM;
+  //hour of the day being measured from its start, -1 when none is
+  int8_t openHour;
+  float openMoisture;
+  float hourDrop[HOURS_PER_DAY];
+  uint32_t hourKnown;
+
+  float slope() const;
+  inline bool hasSpan() const { return firstTime != 0 && (lastTime - firstTime) >= DRYING_MIN_SPAN_SECS; }
+  void stepProfile(int8_t hourNow, bool contiguous);
+};
+
+#endif
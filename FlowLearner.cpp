@@ -0,0 +1,84 @@
+/**
+ * IIRR -- Intelligent Irrigator Based on ESP8266
+    Copyright (C) 2016--2018  Sergio Queiroz <srmq@cin.ufpe.br>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "FlowLearner.h"
+#include "FlowMonitor.h"
+#include <math.h>
+
+FlowLearner::FlowLearner() : state(FLEARN_IDLE), startMs(0), lastStepMs(0),
+    numSamples(0), mean(0), m2(0) {
+}
+
+void FlowLearner::begin(unsigned long nowMs) {
+  state = FLEARN_PRIMING;
+  startMs = nowMs;
+  lastStepMs = nowMs;
+  numSamples = 0;
+  mean = 0;
+  m2 = 0;
+}
+
+void FlowLearner::fail() {
+  if (state != FLEARN_IDLE) state = FLEARN_ERROR;
+}
+
+FlowLearnState FlowLearner::step(unsigned long nowMs) {
+  if (!isRunning() || (nowMs - lastStepMs) < FLOW_LEARN_STEP_MS) return state;
+  lastStepMs = nowMs;
+  const unsigned long elapsedMs = nowMs - startMs;
+  if (state == FLEARN_PRIMING) {
+    if (elapsedMs >= FLOW_LEARN_PRIME_MS) state = FLEARN_SAMPLING;
+    return state;
+  }
+  if (elapsedMs > FLOW_LEARN_TIMEOUT_MS) {
+    state = FLEARN_ERROR;
+    return state;
+  }
+  if (!FlowMonitor::hasEstimate()) return state;
+
+  //Welford's update, stable without keeping the samples
+  const float sample = FlowMonitor::pulsesPerSec();
+  numSamples++;
+  const float delta = sample - mean;
+  mean += delta/numSamples;
+  m2 += delta*(sample - mean);
+  if (numSamples >= FLOW_LEARN_SAMPLES) {
+    state = (mean > 0) ? FLEARN_DONE : FLEARN_ERROR;
+  }
+  return state;
+}
+
+float FlowLearner::getStdDev() const {
+  return (numSamples > 1) ? sqrt(m2/(numSamples - 1)) : 0;
+}
+
+int FlowLearner::getProgress() const {
+  switch (state) {
+    case FLEARN_PRIMING: {
+      const unsigned long elapsedMs = lastStepMs - startMs;
+      return (elapsedMs >= FLOW_LEARN_PRIME_MS) ? 50 : (int)(50*elapsedMs/FLOW_LEARN_PRIME_MS);
+    }
+    case FLEARN_SAMPLING:
+      return 50 + (50*numSamples)/FLOW_LEARN_SAMPLES;
+    case FLEARN_DONE:
+      return 100;
+    default:
+      return 0;
+  }
+}
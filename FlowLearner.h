@@ -0,0 +1,70 @@
+/**
+ * IIRR -- Intelligent Irrigator Based on ESP8266
+    Copyright (C) 2016--2018  Sergio Queiroz <srmq@cin.ufpe.br>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef _FLOW_LEARNER_H_
+#define _FLOW_LEARNER_H_
+
+#include "Hal.h"
+
+#define FLOW_LEARN_PRIME_MS 30000ul //pump running before the flow is steady
+#define FLOW_LEARN_STEP_MS 250ul
+#define FLOW_LEARN_SAMPLES 40
+#define FLOW_LEARN_TIMEOUT_MS 120000ul
+
+enum FlowLearnState {
+  FLEARN_IDLE,
+  FLEARN_PRIMING,
+  FLEARN_SAMPLING,
+  FLEARN_DONE,
+  FLEARN_ERROR
+};
+
+//Learns the normal flow of the pump as a resumable state machine. After
+//begin(), step() is called from the sensor loop: it returns at once
+//until FLOW_LEARN_STEP_MS have passed, then takes at most one sample of
+//FlowMonitor::pulsesPerSec() into a running mean and variance. Samples
+//are only taken while the flow sensor is covered, so the learning goes
+//on through the moisture scans.
+class FlowLearner {
+public:
+  FlowLearner();
+
+  void begin(unsigned long nowMs);
+  //the learning, running or just done, is given up
+  void fail();
+  FlowLearnState step(unsigned long nowMs);
+
+  inline FlowLearnState getState() const { return state; }
+  inline bool isRunning() const { return state == FLEARN_PRIMING || state == FLEARN_SAMPLING; }
+  inline unsigned int getNumSamples() const { return numSamples; }
+  inline float getMean() const { return mean; }
+  float getStdDev() const;
+  //0 to 100, priming and sampling take half each
+  int getProgress() const;
+
+private:
+  FlowLearnState state;
+  unsigned long startMs;
+  unsigned long lastStepMs;
+  unsigned int numSamples;
+  float mean;
+  float m2;
+};
+
+#endif
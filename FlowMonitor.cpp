@@ -0,0 +1,206 @@
+/**
+ * IIRR -- Intelligent Irrigator Based on ESP8266
+    Copyright (C) 2016--2018  Sergio Queiroz <srmq@cin.ufpe.br>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "FlowMonitor.h"
+#include "sensor_calibration.h"
+
+#define FLOW_RING_MASK (FLOW_RING_SIZE - 1)
+
+volatile uint32_t FlowMonitor::pulseTimesUs[FLOW_RING_SIZE];
+volatile uint32_t FlowMonitor::pulseCount = 0;
+volatile bool FlowMonitor::covering = false;
+volatile bool FlowMonitor::paused = false;
+uint32_t FlowMonitor::pausedUs = 0;
+uint32_t FlowMonitor::pauseStartUs = 0;
+float FlowMonitor::pauseRate = 0;
+float FlowMonitor::bridgeCarry = 0;
+volatile uint32_t FlowMonitor::bridgedPulses = 0;
+uint32_t FlowMonitor::coverageStartUs = 0;
+uint32_t FlowMonitor::coverageStartCount = 0;
+volatile uint32_t FlowMonitor::lastEdgeCycles = 0;
+volatile uint32_t FlowMonitor::lastPeriodCycles = 0;
+volatile bool FlowMonitor::flowEstablished = false;
+volatile bool FlowMonitor::collapsed = false;
+volatile uint8_t FlowMonitor::longPeriods = 0;
+uint32_t FlowMonitor::maxPeriodCycles = 0;
+uint32_t FlowMonitor::maxPeriodUs = 0;
+GpioMasks FlowMonitor::guardMasks(0, 0);
+volatile bool FlowMonitor::doseArmed = false;
+volatile bool FlowMonitor::doseReached = false;
+uint32_t FlowMonitor::doseStopCount = 0;
+GpioMasks FlowMonitor::doseMasks(0, 0);
+
+void ICACHE_RAM_ATTR flowMonitorPulse() {
+  if (!FlowMonitor::covering || FlowMonitor::paused) return;
+  const uint32_t nowCycles = Hal::halCycleCount();
+  const uint32_t count = FlowMonitor::pulseCount;
+  FlowMonitor::pulseTimesUs[count & FLOW_RING_MASK] = (uint32_t)Hal::halMicros() - FlowMonitor::pausedUs;
+  if (count != FlowMonitor::coverageStartCount) {
+    const uint32_t periodCycles = nowCycles - FlowMonitor::lastEdgeCycles;
+    FlowMonitor::lastPeriodCycles = periodCycles;
+    if (FlowMonitor::maxPeriodCycles > 0) {
+      if (periodCycles <= FlowMonitor::maxPeriodCycles) {
+        FlowMonitor::flowEstablished = true;
+        FlowMonitor::longPeriods = 0;
+      } else if (FlowMonitor::flowEstablished && !FlowMonitor::collapsed
+                 && ++FlowMonitor::longPeriods >= FLOW_COLLAPSE_LONG_PERIODS) {
+        FlowMonitor::triggerCollapse();
+      }
+    }
+  }
+  FlowMonitor::lastEdgeCycles = nowCycles;
+  FlowMonitor::pulseCount = count + 1;
+  FlowMonitor::checkDose(count + 1 + FlowMonitor::bridgedPulses);
+}
+
+void ICACHE_RAM_ATTR FlowMonitor::checkDose(uint32_t total) {
+  if (doseArmed && (int32_t)(total - doseStopCount) >= 0) {
+    doseArmed = false;
+    doseReached = true;
+    //the flow stopping because of the dose is not a collapse
+    if (doseMasks.clearMask & guardMasks.clearMask) flowEstablished = false;
+    Hal::halWriteMasks(doseMasks);
+  }
+}
+
+//inline register writes only, runs from the ISR
+void ICACHE_RAM_ATTR FlowMonitor::triggerCollapse() {
+  collapsed = true;
+  Hal::halWriteMasks(guardMasks);
+}
+
+void FlowMonitor::begin() {
+  Hal::halAttachInterrupt(FLOWSIGNAL_PIN, flowMonitorPulse, FALLING);
+}
+
+void FlowMonitor::startCoverage() {
+  if (covering) return;
+  paused = false;
+  coverageStartUs = coveredMicros();
+  coverageStartCount = pulseCount;
+  lastPeriodCycles = 0;
+  flowEstablished = false;
+  longPeriods = 0;
+  bridgeCarry = 0;
+  covering = true;
+}
+
+void FlowMonitor::stopCoverage() {
+  covering = false;
+  paused = false;
+}
+
+void FlowMonitor::pauseCoverage() {
+  if (!covering || paused) return;
+  pauseRate = hasEstimate() ? pulsesPerSec() : 0;
+  pauseStartUs = Hal::halMicros();
+  paused = true;
+}
+
+//the edge before the pause and the first one after it are one covered
+//period apart, the ISR period is shifted by the pause to match
+void FlowMonitor::resumeCoverage() {
+  if (!covering || !paused) return;
+  const uint32_t pauseUs = (uint32_t)Hal::halMicros() - pauseStartUs;
+  bridgeCarry += pauseRate*pauseUs/1e6f;
+  const uint32_t bridged = (uint32_t)bridgeCarry;
+  bridgeCarry -= bridged;
+  noInterrupts();
+  pausedUs += pauseUs;
+  lastEdgeCycles += pauseUs*Hal::halCyclesPerMicro();
+  bridgedPulses += bridged;
+  paused = false;
+  checkDose(pulseCount + bridgedPulses);
+  interrupts();
+}
+
+bool FlowMonitor::hasEstimate() {
+  return covering && (coveredMicros() - coverageStartUs) >= FLOW_MIN_COVERAGE_MS*1000ul;
+}
+
+float FlowMonitor::pulsesPerSec() {
+  if (!covering) return 0;
+  const uint32_t count = pulseCount;
+  const uint32_t nowUs = coveredMicros();
+  const uint32_t covered = count - coverageStartCount;
+  if (covered <= FLOW_RATE_PULSES) {
+    const uint32_t elapsedUs = nowUs - coverageStartUs;
+    return (elapsedUs > 0) ? covered*1e6f/elapsedUs : 0;
+  }
+  //edge to edge over the window while the edges keep coming, a late
+  //edge stretches the window so the rate decays when the flow stops
+  const uint32_t lastUs = pulseTimesUs[(count - 1) & FLOW_RING_MASK];
+  const uint32_t windowUs = lastUs - pulseTimesUs[(count - 1 - FLOW_RATE_PULSES) & FLOW_RING_MASK];
+  const uint32_t periodUs = windowUs/FLOW_RATE_PULSES;
+  const uint32_t lateUs = nowUs - lastUs;
+  const uint32_t elapsedUs = (lateUs <= periodUs) ? windowUs : windowUs + lateUs - periodUs;
+  return (elapsedUs > 0) ? FLOW_RATE_PULSES*1e6f/elapsedUs : 0;
+}
+
+float FlowMonitor::periodPulsesPerSec() {
+  const uint32_t periodCycles = lastPeriodCycles;
+  if (!covering || periodCycles == 0) return 0;
+  return (1e6f*Hal::halCyclesPerMicro())/periodCycles;
+}
+
+void FlowMonitor::armCollapseGuard(float minPulsesPerSec, const GpioMasks& stopMasks) {
+  noInterrupts();
+  collapsed = false;
+  longPeriods = 0;
+  guardMasks = stopMasks;
+  if (minPulsesPerSec > 0) {
+    const float periodUs = 1e6f/minPulsesPerSec;
+    maxPeriodUs = (periodUs < FLOW_MAX_PERIOD_US) ? (uint32_t)periodUs : FLOW_MAX_PERIOD_US;
+    maxPeriodCycles = maxPeriodUs*Hal::halCyclesPerMicro();
+  } else {
+    maxPeriodUs = 0;
+    maxPeriodCycles = 0;
+  }
+  interrupts();
+}
+
+//a stopped flow has no edges left for the ISR to look at, so the time
+//since the last one is checked here
+bool FlowMonitor::hasCollapsed() {
+  if (collapsed) return true;
+  if (!covering || paused || !flowEstablished || maxPeriodUs == 0) return false;
+  noInterrupts();
+  const uint32_t lastEdgeUs = pulseTimesUs[(pulseCount - 1) & FLOW_RING_MASK];
+  if ((coveredMicros() - lastEdgeUs) > FLOW_COLLAPSE_PERIODS*maxPeriodUs && !collapsed) {
+    triggerCollapse();
+  }
+  interrupts();
+  return collapsed;
+}
+
+void FlowMonitor::armDoseStop(uint32_t stopCount, const GpioMasks& stopMasks) {
+  noInterrupts();
+  doseMasks = stopMasks;
+  doseStopCount = stopCount;
+  doseReached = (int32_t)(pulseCount + bridgedPulses - stopCount) >= 0;
+  doseArmed = !doseReached;
+  if (doseReached) Hal::halWriteMasks(doseMasks);
+  interrupts();
+}
+
+void FlowMonitor::disarmDoseStop() {
+  noInterrupts();
+  doseArmed = false;
+  doseReached = false;
+  interrupts();
+}
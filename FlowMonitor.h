@@ -0,0 +1,115 @@
+/**
+ * IIRR -- Intelligent Irrigator Based on ESP8266
+    Copyright (C) 2016--2018  Sergio Queiroz <srmq@cin.ufpe.br>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef _FLOW_MONITOR_H_
+#define _FLOW_MONITOR_H_
+
+#include "Hal.h"
+
+#define FLOW_RING_SIZE 32 //power of 2, larger than FLOW_RATE_PULSES
+#define FLOW_RATE_PULSES 16
+#define FLOW_MIN_COVERAGE_MS 1000
+#define FLOW_COLLAPSE_PERIODS 3 //missing edges, in slowest accepted periods, that mean no flow
+#define FLOW_COLLAPSE_LONG_PERIODS 3 //periods in a row longer than the slowest accepted one that mean no flow
+#define FLOW_MAX_PERIOD_US 5000000ul
+
+//Flow sensor pulses are timestamped by an always attached ISR into a
+//ring buffer written only by the ISR. Pulses count only while the sensor
+//is powered (a coverage window, see startCoverage()), and the rate is
+//estimated between the last FLOW_RATE_PULSES edges, and decays as soon
+//as the next edge is late. Every query is O(1) and never blocks.
+//
+//A window may be paused while a probe read borrows the decoder. Times are
+//kept in covered time, which stops during a pause, so the rate and the
+//collapse checks do not see the gap, and the pulses lost meanwhile are
+//bridged into totalPulses() at the rate seen before the pause.
+//
+//The ISR also measures each edge to edge period with the cycle counter.
+//Once the flow reached the rate given to armCollapseGuard(),
+//FLOW_COLLAPSE_LONG_PERIODS periods in a row longer than the slowest
+//accepted one, or no edge for FLOW_COLLAPSE_PERIODS of them, is a
+//collapse: the guard masks (the pump pin) are written at once from the
+//ISR, so a dry well is detected within a few pulses. A single late or
+//missed edge, as from an air bubble, does not stop the pump.
+//In the same way armDoseStop() writes its masks from the ISR on the pulse
+//that completes a dose.
+class FlowMonitor {
+public:
+  static void begin();
+
+  //the flow sensor was just powered, or is about to lose power
+  static void startCoverage();
+  static void stopCoverage();
+  static inline bool isCovering() { return covering; }
+
+  //the sensor loses power for a while, the window stays open
+  static void pauseCoverage();
+  static void resumeCoverage();
+
+  //covered long enough for pulsesPerSec() to be meaningful
+  static bool hasEstimate();
+
+  static float pulsesPerSec();
+
+  //pulses since begin(), including the ones bridged over pauses
+  static inline unsigned long totalPulses() { return pulseCount + bridgedPulses; }
+
+  //rate from the last edge to edge period, 0 until two edges were covered
+  static float periodPulsesPerSec();
+
+  //minPulsesPerSec <= 0 disables the guard, also clears a past collapse
+  static void armCollapseGuard(float minPulsesPerSec, const GpioMasks& stopMasks);
+  static bool hasCollapsed();
+
+  //stopCount is in totalPulses(), a count already reached stops at once
+  static void armDoseStop(uint32_t stopCount, const GpioMasks& stopMasks);
+  static void disarmDoseStop();
+  static inline bool isDoseReached() { return doseReached; }
+
+private:
+  friend void flowMonitorPulse();
+  static volatile uint32_t pulseTimesUs[FLOW_RING_SIZE];
+  static volatile uint32_t pulseCount;
+  static volatile bool covering;
+  static volatile bool paused;
+  static uint32_t pausedUs; //since begin(), covered time is micros minus this
+  static uint32_t pauseStartUs;
+  static float pauseRate;
+  static float bridgeCarry;
+  static volatile uint32_t bridgedPulses;
+  static uint32_t coverageStartUs;
+  static uint32_t coverageStartCount;
+  static volatile uint32_t lastEdgeCycles;
+  static volatile uint32_t lastPeriodCycles;
+  static volatile bool flowEstablished;
+  static volatile bool collapsed;
+  static volatile uint8_t longPeriods; //in a row, since the last accepted one
+  static uint32_t maxPeriodCycles;
+  static uint32_t maxPeriodUs;
+  static GpioMasks guardMasks;
+  static volatile bool doseArmed;
+  static volatile bool doseReached;
+  static uint32_t doseStopCount;
+  static GpioMasks doseMasks;
+
+  static void triggerCollapse();
+  static void checkDose(uint32_t total);
+  static inline uint32_t coveredMicros() { return (paused ? pauseStartUs : (uint32_t)Hal::halMicros()) - pausedUs; }
+};
+
+#endif
@@ -0,0 +1,125 @@
+/**
+ * IIRR -- Intelligent Irrigator Based on ESP8266
+    Copyright (C) 2016--2019  Sergio Queiroz <srmq@cin.ufpe.br>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "Hal.h"
+
+#ifdef HOST_BUILD
+
+#include <cstring>
+#include <time.h>
+
+static LinuxHalBackend defaultBackend;
+static HalBackend *currBackend = &defaultBackend;
+
+void Hal::setBackend(HalBackend *newBackend) {
+  currBackend = (newBackend != NULL) ? newBackend : &defaultBackend;
+}
+
+HalBackend& Hal::backend() {
+  return *currBackend;
+}
+
+static inline bool isValidPin(uint8_t pin) {
+  return pin < HAL_NUM_PINS;
+}
+
+LinuxHalBackend::LinuxHalBackend() {
+  memset(pinModes, 0, sizeof(pinModes));
+  memset(pinLevels, 0, sizeof(pinLevels));
+  memset(analogValues, 0, sizeof(analogValues));
+  memset(isrModes, 0, sizeof(isrModes));
+  nowOffset = 0;
+  for (int i = 0; i < HAL_NUM_PINS; i++) {
+    isrs[i] = NULL;
+  }
+}
+
+LinuxHalBackend::~LinuxHalBackend() {
+}
+
+void LinuxHalBackend::pinMode(uint8_t pin, uint8_t mode) {
+  if (isValidPin(pin)) pinModes[pin] = mode;
+}
+
+void LinuxHalBackend::digitalWrite(uint8_t pin, uint8_t val) {
+  if (!isValidPin(pin)) return;
+  const uint8_t oldLevel = pinLevels[pin];
+  pinLevels[pin] = (val == LOW) ? LOW : HIGH;
+  if (isrs[pin] != NULL && oldLevel != pinLevels[pin]) {
+    //an output looped back to an input with interrupt, as in a test bench
+    if ((isrModes[pin] == CHANGE)
+        || (isrModes[pin] == RISING && pinLevels[pin] == HIGH)
+        || (isrModes[pin] == FALLING && pinLevels[pin] == LOW)) {
+      isrs[pin]();
+    }
+  }
+}
+
+int LinuxHalBackend::digitalRead(uint8_t pin) {
+  return isValidPin(pin) ? pinLevels[pin] : LOW;
+}
+
+int LinuxHalBackend::analogRead(uint8_t pin) {
+  return isValidPin(pin) ? analogValues[pin] : 0;
+}
+
+unsigned long LinuxHalBackend::millis() {
+  return micros()/1000ul;
+}
+
+unsigned long LinuxHalBackend::micros() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (unsigned long)(ts.tv_sec*1000000ull + ts.tv_nsec/1000ull);
+}
+
+void LinuxHalBackend::delay(unsigned long ms) {
+  struct timespec ts;
+  ts.tv_sec = ms/1000ul;
+  ts.tv_nsec = (ms % 1000ul)*1000000ul;
+  nanosleep(&ts, NULL);
+}
+
+time_t LinuxHalBackend::now() {
+  return time(NULL) + nowOffset;
+}
+
+void LinuxHalBackend::setNow(time_t aTime) {
+  nowOffset = aTime - time(NULL);
+}
+
+void LinuxHalBackend::attachInterrupt(uint8_t pin, HalISR isr, int mode) {
+  if (!isValidPin(pin)) return;
+  isrs[pin] = isr;
+  isrModes[pin] = mode;
+}
+
+void LinuxHalBackend::detachInterrupt(uint8_t pin) {
+  if (!isValidPin(pin)) return;
+  isrs[pin] = NULL;
+}
+
+void LinuxHalBackend::setAnalogValue(uint8_t pin, int value) {
+  if (isValidPin(pin)) analogValues[pin] = value;
+}
+
+void LinuxHalBackend::fireInterrupt(uint8_t pin) {
+  if (isValidPin(pin) && isrs[pin] != NULL) isrs[pin]();
+}
+
+#endif
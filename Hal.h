@@ -0,0 +1,168 @@
+/**
+ * IIRR -- Intelligent Irrigator Based on ESP8266
+    Copyright (C) 2016--2019  Sergio Queiroz <srmq@cin.ufpe.br>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef _HAL_H_
+#define _HAL_H_
+
+#include <Arduino.h>
+#include <TimeLib.h>
+#include <Time.h>
+
+//Hardware abstraction for GPIO, ADC, clock and interrupts. On the board
+//every call is inlined into the plain Arduino call. When HOST_BUILD is
+//defined (the CMake host build, see host/) calls are routed to a
+//HalBackend, so the modules can run on a workstation. Filesystem and
+//network keep the SPIFFS and ESP8266WiFi APIs, host/ implements them with
+//an in-memory SPIFFS and a network that never connects.
+//#define HOST_BUILD
+
+#define HAL_NUM_PINS 18
+
+#define HAL_GPIO16_MASK (1ul << 16)
+
+#define HAL_HOST_CPU_MHZ 80 //cycle counter rate of the host build
+
+typedef void (*HalISR)(void);
+
+//GPIOs to drive HIGH and LOW with one halWriteMasks() call, bit n is GPIO n
+class GpioMasks {
+public:
+  uint32_t setMask;
+  uint32_t clearMask;
+
+  constexpr GpioMasks(uint32_t setMask, uint32_t clearMask) : setMask(setMask), clearMask(clearMask) { }
+
+  constexpr GpioMasks operator|(const GpioMasks& other) const {
+    return GpioMasks(setMask | other.setMask, clearMask | other.clearMask);
+  }
+};
+
+#ifdef HOST_BUILD
+
+class HalBackend {
+public:
+  virtual void pinMode(uint8_t pin, uint8_t mode) = 0;
+  virtual void digitalWrite(uint8_t pin, uint8_t val) = 0;
+  virtual int digitalRead(uint8_t pin) = 0;
+  virtual int analogRead(uint8_t pin) = 0;
+  virtual unsigned long millis() = 0;
+  virtual unsigned long micros() = 0;
+  virtual void delay(unsigned long ms) = 0;
+  virtual time_t now() = 0;
+  virtual void setNow(time_t aTime) = 0;
+  virtual void attachInterrupt(uint8_t pin, HalISR isr, int mode) = 0;
+  virtual void detachInterrupt(uint8_t pin) = 0;
+
+  virtual ~HalBackend() = 0;
+};
+
+inline HalBackend::~HalBackend() {}
+
+//Linux implementation: pins are kept in memory, the clock is the
+//monotonic clock of the host. Analog values and interrupts are driven
+//from outside with setAnalogValue() and fireInterrupt().
+class LinuxHalBackend : public HalBackend {
+public:
+  virtual void pinMode(uint8_t pin, uint8_t mode) override;
+  virtual void digitalWrite(uint8_t pin, uint8_t val) override;
+  virtual int digitalRead(uint8_t pin) override;
+  virtual int analogRead(uint8_t pin) override;
+  virtual unsigned long millis() override;
+  virtual unsigned long micros() override;
+  virtual void delay(unsigned long ms) override;
+  virtual time_t now() override;
+  virtual void setNow(time_t aTime) override;
+  virtual void attachInterrupt(uint8_t pin, HalISR isr, int mode) override;
+  virtual void detachInterrupt(uint8_t pin) override;
+  virtual ~LinuxHalBackend();
+  LinuxHalBackend();
+
+  void setAnalogValue(uint8_t pin, int value);
+  void fireInterrupt(uint8_t pin);
+
+protected:
+  uint8_t pinModes[HAL_NUM_PINS];
+  uint8_t pinLevels[HAL_NUM_PINS];
+  int analogValues[HAL_NUM_PINS];
+  HalISR isrs[HAL_NUM_PINS];
+  int isrModes[HAL_NUM_PINS];
+  time_t nowOffset;
+};
+
+class Hal {
+public:
+  static void setBackend(HalBackend *newBackend);
+  static HalBackend& backend();
+
+  static inline void halPinMode(uint8_t pin, uint8_t mode) { backend().pinMode(pin, mode); }
+  static inline void halDigitalWrite(uint8_t pin, uint8_t val) { backend().digitalWrite(pin, val); }
+  static inline int halDigitalRead(uint8_t pin) { return backend().digitalRead(pin); }
+  static inline int halAnalogRead(uint8_t pin) { return backend().analogRead(pin); }
+  static inline unsigned long halMillis() { return backend().millis(); }
+  static inline unsigned long halMicros() { return backend().micros(); }
+  static inline void halDelay(unsigned long ms) { backend().delay(ms); }
+  static inline time_t halNow() { return backend().now(); }
+  static inline void halSetNow(time_t aTime) { backend().setNow(aTime); }
+  static inline void halAttachInterrupt(uint8_t pin, HalISR isr, int mode) { backend().attachInterrupt(pin, isr, mode); }
+  static inline void halDetachInterrupt(uint8_t pin) { backend().detachInterrupt(pin); }
+  static inline uint32_t halCycleCount() { return (uint32_t)(backend().micros()*HAL_HOST_CPU_MHZ); }
+  static inline uint32_t halCyclesPerMicro() { return HAL_HOST_CPU_MHZ; }
+
+  static inline void halWriteMasks(const GpioMasks& masks) {
+    for (uint8_t pin = 0; pin < HAL_NUM_PINS; pin++) {
+      if (masks.setMask & (1ul << pin)) {
+        backend().digitalWrite(pin, HIGH);
+      } else if (masks.clearMask & (1ul << pin)) {
+        backend().digitalWrite(pin, LOW);
+      }
+    }
+  }
+};
+
+#else
+
+class Hal {
+public:
+  static inline void halPinMode(uint8_t pin, uint8_t mode) { pinMode(pin, mode); }
+  static inline void halDigitalWrite(uint8_t pin, uint8_t val) { digitalWrite(pin, val); }
+  static inline int halDigitalRead(uint8_t pin) { return digitalRead(pin); }
+  static inline int halAnalogRead(uint8_t pin) { return analogRead(pin); }
+  static inline unsigned long halMillis() { return millis(); }
+  static inline unsigned long halMicros() { return micros(); }
+  static inline void halDelay(unsigned long ms) { delay(ms); }
+  static inline time_t halNow() { return now(); }
+  static inline void halSetNow(time_t aTime) { setTime(aTime); }
+  static inline void halAttachInterrupt(uint8_t pin, HalISR isr, int mode) { attachInterrupt(digitalPinToInterrupt(pin), isr, mode); }
+  static inline void halDetachInterrupt(uint8_t pin) { detachInterrupt(digitalPinToInterrupt(pin)); }
+  //CCOUNT register, wraps around every 2^32 cycles (53 s at 80 MHz)
+  static inline uint32_t halCycleCount() { return ESP.getCycleCount(); }
+  static inline uint32_t halCyclesPerMicro() { return ESP.getCpuFreqMHz(); }
+
+  //GPIO0-15 with the set and clear registers, GPIO16 has its own register
+  static inline void halWriteMasks(const GpioMasks& masks) {
+    GPOS = masks.setMask & 0xFFFF;
+    GPOC = masks.clearMask & 0xFFFF;
+    if ((masks.setMask | masks.clearMask) & HAL_GPIO16_MASK) {
+      GP16O = (masks.setMask & HAL_GPIO16_MASK) ? 1 : 0;
+    }
+  }
+};
+
+#endif
+
+#endif
@@ -24,6 +24,7 @@
 #include "SensorTask.h"
 #include "ServerTask.h"
 #include "CloudTask.h"
+#include "LogCatalog.h"
 #include "WiFiTask.h"
 #include <Scheduler.h>
 #include <WiFiUdp.h>
@@ -42,6 +43,10 @@ void setup() {
   Serial.begin(115200);
   delay(1000);
   fsOpen = SPIFFS.begin();
+  if (fsOpen && !LogCatalog::build()) {
+    Serial.print(F("WARNING: log files left out of the catalog: "));
+    Serial.println(LogCatalog::dropped());
+  }
   static SensorTask sensorTask;
   static ServerTask serverTask;
   static WiFiTask wiFiTask;
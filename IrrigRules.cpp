@@ -0,0 +1,146 @@
+/**
+ * IIRR -- Intelligent Irrigator Based on ESP8266
+    Copyright (C) 2016--2018  Sergio Queiroz <srmq@cin.ufpe.br>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "IrrigRules.h"
+
+static const char PRED_NAME_VALIDTIME[] PROGMEM = "validtime";
+static const char PRED_NAME_ALLOWEDTIME[] PROGMEM = "allowedtime";
+static const char PRED_NAME_BUDGET[] PROGMEM = "budget";
+static const char PRED_NAME_INTERVAL[] PROGMEM = "interval";
+static const char PRED_NAME_WATEROK[] PROGMEM = "waterok";
+static const char PRED_NAME_FLOWCONF[] PROGMEM = "flowconf";
+static const char PRED_NAME_NOTLEARNING[] PROGMEM = "notlearning";
+static const char PRED_NAME_ZONEDRY[] PROGMEM = "zonedry";
+static const char PRED_NAME_DOSE[] PROGMEM = "dose";
+static const char PRED_NAME_SLOTEND[] PROGMEM = "slotend";
+static const char PRED_NAME_SURFACESAT[] PROGMEM = "surfacesat";
+static const char PRED_NAME_MIDDLESAT[] PROGMEM = "middlesat";
+static const char PRED_NAME_DEEPINCREASE[] PROGMEM = "deepincrease";
+static const char PRED_NAME_BUDGETOUT[] PROGMEM = "budgetout";
+
+//in IrrigPredicate order
+static PGM_P const PRED_NAMES[NUM_PREDICATES] = {
+  PRED_NAME_VALIDTIME, PRED_NAME_ALLOWEDTIME, PRED_NAME_BUDGET, PRED_NAME_INTERVAL,
+  PRED_NAME_WATEROK, PRED_NAME_FLOWCONF, PRED_NAME_NOTLEARNING, PRED_NAME_ZONEDRY,
+  PRED_NAME_DOSE, PRED_NAME_SLOTEND, PRED_NAME_SURFACESAT, PRED_NAME_MIDDLESAT,
+  PRED_NAME_DEEPINCREASE, PRED_NAME_BUDGETOUT
+};
+
+//the rules before the configurable ones existed
+static const uint8_t DEFAULT_START[] = { PRED_VALIDTIME, PRED_ALLOWEDTIME, PRED_BUDGET, PRED_INTERVAL,
+                                         PRED_WATEROK, PRED_FLOWCONF, PRED_ZONEDRY, PRED_NOTLEARNING };
+static const uint8_t DEFAULT_STOP[] = { PRED_DOSE, PRED_SLOTEND, PRED_SURFACESAT, PRED_MIDDLESAT,
+                                        PRED_DEEPINCREASE, PRED_BUDGETOUT };
+
+//a configuration can not remove these, irrigation would be unsafe or would not know which zone to water
+static const uint8_t START_INTERLOCKS[] = { PRED_VALIDTIME, PRED_WATEROK, PRED_FLOWCONF, PRED_NOTLEARNING, PRED_ZONEDRY };
+static const uint8_t STOP_INTERLOCKS[] = { PRED_DOSE, PRED_BUDGETOUT };
+
+static_assert(NUM_PREDICATES <= 16, "IrrigTrace keeps a predicate per bit of an uint16_t");
+
+IrrigProgram::IrrigProgram(IrrigProgramKind kind) : kind(kind) {
+  setDefault();
+}
+
+void IrrigProgram::clear() {
+  numOps = 0;
+  valid = true;
+}
+
+bool IrrigProgram::contains(IrrigPredicate pred) const {
+  for (uint8_t i = 0; i < numOps; i++) {
+    if (ops[i] == pred) return true;
+  }
+  return false;
+}
+
+bool IrrigProgram::append(IrrigPredicate pred) {
+  if (contains(pred)) return true;
+  if (numOps >= MAX_RULE_OPS) {
+    valid = false;
+    return false;
+  }
+  ops[numOps++] = pred;
+  return true;
+}
+
+bool IrrigProgram::add(const char* name) {
+  const IrrigPredicate pred = predicateFromName(name);
+  if (pred == PRED_NONE || kindOf(pred) != kind) {
+    valid = false;
+    return false;
+  }
+  return append(pred);
+}
+
+void IrrigProgram::addInterlocks() {
+  const uint8_t *interlocks = (kind == RULES_START) ? START_INTERLOCKS : STOP_INTERLOCKS;
+  const size_t numInterlocks = (kind == RULES_START) ? sizeof(START_INTERLOCKS) : sizeof(STOP_INTERLOCKS);
+  for (size_t i = 0; i < numInterlocks; i++) {
+    append(IrrigPredicate(interlocks[i]));
+  }
+}
+
+void IrrigProgram::setDefault() {
+  clear();
+  const uint8_t *defaults = (kind == RULES_START) ? DEFAULT_START : DEFAULT_STOP;
+  const size_t numDefaults = (kind == RULES_START) ? sizeof(DEFAULT_START) : sizeof(DEFAULT_STOP);
+  for (size_t i = 0; i < numDefaults; i++) {
+    append(IrrigPredicate(defaults[i]));
+  }
+}
+
+PGM_P IrrigProgram::predicateName(IrrigPredicate pred) {
+  return (pred < NUM_PREDICATES) ? PRED_NAMES[pred] : NULL;
+}
+
+IrrigPredicate IrrigProgram::predicateFromName(const char* name) {
+  if (name == NULL) return PRED_NONE;
+  for (int i = 0; i < NUM_PREDICATES; i++) {
+    if (strcmp_P(name, PRED_NAMES[i]) == 0) return IrrigPredicate(i);
+  }
+  return PRED_NONE;
+}
+
+bool IrrigRuleCycle::get(IrrigPredicate pred) {
+  const uint16_t bit = 1u << pred;
+  if (!(known & bit)) {
+    if (evaluator.evaluate(pred)) values |= bit;
+    known |= bit;
+  }
+  return values & bit;
+}
+
+IrrigPredicate IrrigRuleCycle::run(const IrrigProgram& program, IrrigTrace& trace) {
+  //start decides on the first false, stop on the first true
+  const bool decidingValue = (program.getKind() == RULES_STOP);
+  IrrigPredicate decisive = PRED_NONE;
+  trace.evaluated = 0;
+  for (uint8_t i = 0; i < program.size(); i++) {
+    const IrrigPredicate pred = program.op(i);
+    trace.evaluated |= 1u << pred;
+    if (get(pred) == decidingValue) {
+      decisive = pred;
+      break;
+    }
+  }
+  trace.kind = program.getKind();
+  trace.decisive = decisive;
+  trace.values = values & trace.evaluated;
+  return decisive;
+}
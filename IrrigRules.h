@@ -0,0 +1,123 @@
+/**
+ * IIRR -- Intelligent Irrigator Based on ESP8266
+    Copyright (C) 2016--2018  Sergio Queiroz <srmq@cin.ufpe.br>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef _IRRIG_RULES_H_
+#define _IRRIG_RULES_H_
+
+#include <Arduino.h>
+
+#define MAX_RULE_OPS 16
+
+enum IrrigPredicate {
+  //start program, irrigation starts when all of them hold
+  PRED_VALIDTIME,   //the clock was set
+  PRED_ALLOWEDTIME, //out of the no irrigation windows
+  PRED_BUDGET,      //at least budgetSlotFraction of a slot left for today
+  PRED_INTERVAL,    //irrMIntervMins since the last irrigation
+  PRED_WATEROK,     //the well was not found empty
+  PRED_FLOWCONF,    //the normal flow was learned
+  PRED_NOTLEARNING, //the pump is not busy learning the flow
+  PRED_ZONEDRY,     //some zone needs water
+  //stop program, the first one that holds ends the current zone
+  PRED_DOSE,
+  PRED_SLOTEND,
+  PRED_SURFACESAT,
+  PRED_MIDDLESAT,
+  PRED_DEEPINCREASE,
+  PRED_BUDGETOUT,   //nothing left of the daily budget, ends the irrigation
+  NUM_PREDICATES,
+  PRED_NONE = NUM_PREDICATES
+};
+
+enum IrrigProgramKind {
+  RULES_START,
+  RULES_STOP
+};
+
+//Predicates in evaluation order, compiled from their names in params.json.
+//The interlocks of a kind (see addInterlocks()) are always part of it.
+class IrrigProgram {
+public:
+  IrrigProgram(IrrigProgramKind kind);
+
+  void clear();
+  //false, and the program is left invalid, for an unknown name, a predicate of the other kind or a full program
+  bool add(const char* name);
+  void addInterlocks();
+  void setDefault();
+
+  inline IrrigProgramKind getKind() const { return kind; }
+  inline uint8_t size() const { return numOps; }
+  inline IrrigPredicate op(uint8_t i) const { return IrrigPredicate(ops[i]); }
+  inline bool isValid() const { return valid; }
+
+  static PGM_P predicateName(IrrigPredicate pred);
+  static IrrigPredicate predicateFromName(const char* name);
+  static inline IrrigProgramKind kindOf(IrrigPredicate pred) { return (pred < PRED_DOSE) ? RULES_START : RULES_STOP; }
+
+private:
+  IrrigProgramKind kind;
+  uint8_t ops[MAX_RULE_OPS];
+  uint8_t numOps;
+  bool valid;
+
+  bool contains(IrrigPredicate pred) const;
+  bool append(IrrigPredicate pred);
+};
+
+class PredicateEvaluator {
+public:
+  virtual bool evaluate(IrrigPredicate pred) = 0;
+  virtual ~PredicateEvaluator() = 0;
+};
+
+inline PredicateEvaluator::~PredicateEvaluator() {}
+
+//which predicates a run looked at, and the one that decided it
+class IrrigTrace {
+public:
+  IrrigProgramKind kind;
+  IrrigPredicate decisive; //start: the first that failed, stop: the first that held, PRED_NONE if none
+  uint16_t evaluated; //bit per predicate
+  uint16_t values;
+
+  IrrigTrace() : kind(RULES_START), decisive(PRED_NONE), evaluated(0), values(0) { }
+
+  inline bool wasEvaluated(IrrigPredicate pred) const { return (evaluated >> pred) & 1; }
+  inline bool valueOf(IrrigPredicate pred) const { return (values >> pred) & 1; }
+};
+
+//One sensor cycle: each predicate is evaluated at most once, on first
+//use, and later runs in the same cycle take the cached value.
+class IrrigRuleCycle {
+public:
+  IrrigRuleCycle(PredicateEvaluator& evaluator) : evaluator(evaluator), known(0), values(0) { }
+
+  bool get(IrrigPredicate pred);
+
+  //start: the first predicate that fails, stop: the first that holds, PRED_NONE if none.
+  //Later predicates are not evaluated
+  IrrigPredicate run(const IrrigProgram& program, IrrigTrace& trace);
+
+private:
+  PredicateEvaluator& evaluator;
+  uint16_t known;
+  uint16_t values;
+};
+
+#endif
@@ -0,0 +1,214 @@
+/**
+ * IIRR -- Intelligent Irrigator Based on ESP8266
+    Copyright (C) 2016--2018  Sergio Queiroz <srmq@cin.ufpe.br>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "LogCatalog.h"
+#include "LogIndex.h"
+#include "SensorLog.h"
+#include "SensorTask.h"
+#include "global_funcs.h"
+#include "TimeKeeper.h"
+
+LogSegment LogCatalog::segments[LOG_CATALOG_SIZE];
+uint8_t LogCatalog::numSegments = 0;
+uint8_t LogCatalog::numDropped = 0;
+
+uint8_t LogCatalog::lowerBound(uint8_t kind, uint16_t day) {
+  uint8_t lo = 0;
+  uint8_t hi = numSegments;
+  while (lo < hi) {
+    const uint8_t mid = lo + (hi - lo)/2;
+    const LogSegment& segment = segments[mid];
+    if (segment.kind < kind || (segment.kind == kind && segment.day < day)) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo;
+}
+
+LogSegment* LogCatalog::findDay(uint8_t kind, uint16_t day) {
+  const uint8_t i = lowerBound(kind, day);
+  if (i < numSegments && segments[i].kind == kind && segments[i].day == day) return &segments[i];
+  return NULL;
+}
+
+LogSegment* LogCatalog::segmentFor(uint8_t kind, uint16_t day) {
+  uint8_t i = lowerBound(kind, day);
+  if (i < numSegments && segments[i].kind == kind && segments[i].day == day) return &segments[i];
+  if (numSegments >= LOG_CATALOG_SIZE) {
+    Serial.println(F("WARNING: log catalog is full, the oldest file is left out"));
+    numDropped++;
+    //the first of each kind is its oldest
+    const uint8_t firstMsg = lowerBound(LOGKIND_MSG, 0);
+    const uint8_t oldest = (firstMsg < numSegments && (firstMsg == 0 || segments[firstMsg].day < segments[0].day)) ? firstMsg : 0;
+    if (day <= segments[oldest].day) return NULL;
+    numSegments--;
+    memmove(&segments[oldest], &segments[oldest + 1], (numSegments - oldest)*sizeof(LogSegment));
+    if (oldest < i) i--;
+  }
+  memmove(&segments[i + 1], &segments[i], (numSegments - i)*sizeof(LogSegment));
+  numSegments++;
+  LogSegment& segment = segments[i];
+  segment.kind = kind;
+  segment.day = day;
+  segment.size = 0;
+  segment.firstTS = 0;
+  segment.lastTS = 0;
+  return &segment;
+}
+
+const LogSegment* LogCatalog::find(uint8_t kind, time_t aTime) {
+  return findDay(kind, elapsedDays(aTime));
+}
+
+const LogSegment* LogCatalog::firstFrom(uint8_t kind, time_t aTime) {
+  const uint8_t i = lowerBound(kind, elapsedDays(aTime));
+  return (i < numSegments && segments[i].kind == kind) ? &segments[i] : NULL;
+}
+
+bool LogCatalog::fileName(const LogSegment& segment, char *out, size_t size) {
+  const time_t date = segment.date();
+  PGM_P fmtStr = (segment.kind == LOGKIND_SENSOR) ? LOGF_FMT_STR : MSGF_FMT_STR;
+  return snprintf_P(out, size, fmtStr, TimeKeeper::tkYear(date), TimeKeeper::tkMonth(date), TimeKeeper::tkDay(date)) < (int)size;
+}
+
+void LogCatalog::readTimes(LogSegment& segment, const char* name) {
+  segment.firstTS = 0;
+  segment.lastTS = 0;
+  File file = SPIFFS.open(name, "r");
+  if (!file) return;
+  const size_t size = file.size();
+  SensorLogStream log(file);
+  char line[LOG_INDEX_LINE_SIZE];
+  memset(line, '\0', sizeof(line));
+  log.readBytesUntil('\n', line, LOG_INDEX_LINE_SIZE - 1);
+  time_t ts;
+  if (LogIndex::parseTime(line, ts)) segment.firstTS = segment.lastTS = ts;
+  //the last record is in the tail of the file, a text line cut by the seek is skipped
+  const size_t tail = log.isBinary() ? SENSORLOG_RECORD_SIZE : 2*LOG_INDEX_LINE_SIZE;
+  if (size > tail) {
+    log.seek(size - tail);
+    if (!log.isBinary()) log.readBytesUntil('\n', line, LOG_INDEX_LINE_SIZE - 1);
+  }
+  while (log.available() > 0) {
+    memset(line, '\0', sizeof(line));
+    log.readBytesUntil('\n', line, LOG_INDEX_LINE_SIZE - 1);
+    if (LogIndex::parseTime(line, ts)) segment.lastTS = ts;
+  }
+  log.close();
+}
+
+bool LogCatalog::parseName(const String& name, uint8_t& kind, uint16_t& day) {
+  int year, month, mday;
+  if (SensorTask::isLogFileName(name) && SensorTask::getLogfileDMY(name, mday, month, year)) {
+    kind = LOGKIND_SENSOR;
+  } else if (SensorTask::isMsgFileName(name) && SensorTask::getMsgfileDMY(name, mday, month, year)) {
+    kind = LOGKIND_MSG;
+  } else {
+    return false;
+  }
+  day = elapsedDays(TimeKeeper::tkMakeTime(year, month, mday, 0, 0, 0));
+  return true;
+}
+
+bool LogCatalog::build() {
+  numSegments = 0;
+  numDropped = 0;
+  if (!fsOpen) return false;
+  Dir logDir = SPIFFS.openDir(String(FPSTR(LOG_DIR)));
+  while (logDir.next()) {
+    const String name = logDir.fileName();
+    uint8_t kind;
+    uint16_t day;
+    if (!parseName(name, kind, day)) continue;
+    LogSegment *segment = segmentFor(kind, day);
+    if (segment == NULL) continue;
+    segment->size = logDir.fileSize();
+    readTimes(*segment, name.c_str());
+  }
+  return numDropped == 0;
+}
+
+void LogCatalog::opened(uint8_t kind, time_t aTime, size_t size) {
+  const bool known = (findDay(kind, elapsedDays(aTime)) != NULL);
+  LogSegment *segment = segmentFor(kind, elapsedDays(aTime));
+  if (segment == NULL) return;
+  if (size == 0) {
+    segment->firstTS = 0;
+    segment->lastTS = 0;
+  } else if (!known) {
+    char name[LOG_CATALOG_ENTRY_SIZE];
+    if (fileName(*segment, name, sizeof(name))) readTimes(*segment, name);
+  }
+  segment->size = size;
+}
+
+void LogCatalog::recorded(uint8_t kind, time_t aTime) {
+  LogSegment *segment = segmentFor(kind, elapsedDays(aTime));
+  if (segment == NULL) return;
+  if (segment->firstTS == 0) segment->firstTS = aTime;
+  segment->lastTS = aTime;
+}
+
+void LogCatalog::written(uint8_t kind, time_t aTime, size_t size) {
+  LogSegment *segment = segmentFor(kind, elapsedDays(aTime));
+  if (segment != NULL) segment->size = size;
+}
+
+void LogCatalog::removed(uint8_t kind, time_t aDate) {
+  const uint8_t i = lowerBound(kind, elapsedDays(aDate));
+  if (i >= numSegments || segments[i].kind != kind || segments[i].day != elapsedDays(aDate)) {
+    if (numDropped > 0) numDropped--; //one that was left out
+    return;
+  }
+  numSegments--;
+  memmove(&segments[i], &segments[i + 1], (numSegments - i)*sizeof(LogSegment));
+}
+
+LogCatalogStream::LogCatalogStream() : Stream(), next(0), entryLen(0), entryPos(0) {
+  nextEntry();
+}
+
+//the first name goes without the comma, as DirStream does
+bool LogCatalogStream::nextEntry() {
+  entryLen = entryPos = 0;
+  if (next >= LogCatalog::count()) return false;
+  char name[LOG_CATALOG_ENTRY_SIZE];
+  if (!LogCatalog::fileName(LogCatalog::get(next), name, sizeof(name))) name[0] = '\0';
+  entryLen = snprintf_P(entry, LOG_CATALOG_ENTRY_SIZE, (next == 0) ? PSTR("\"%s\"") : PSTR(",\"%s\""), name);
+  if (entryLen >= LOG_CATALOG_ENTRY_SIZE) entryLen = LOG_CATALOG_ENTRY_SIZE - 1;
+  next++;
+  return true;
+}
+
+int LogCatalogStream::available() {
+  return entryLen - entryPos;
+}
+
+int LogCatalogStream::read() {
+  if (entryPos >= entryLen) return -1;
+  const int c = entry[entryPos++];
+  if (entryPos == entryLen) nextEntry();
+  return c;
+}
+
+int LogCatalogStream::peek() {
+  if (entryPos >= entryLen) return -1;
+  return entry[entryPos];
+}
@@ -0,0 +1,117 @@
+/**
+ * IIRR -- Intelligent Irrigator Based on ESP8266
+    Copyright (C) 2016--2018  Sergio Queiroz <srmq@cin.ufpe.br>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef _LOG_CATALOG_H_
+#define _LOG_CATALOG_H_
+
+#include <Arduino.h>
+#include "FS.h"
+#include <TimeLib.h>
+#include "sensor_calibration.h"
+
+#define LOG_CATALOG_SIZE (4*FS_LOG_KEEP_DAYS) //both kinds of the days kept, and as many waiting for the cloud
+#define LOG_CATALOG_ENTRY_SIZE 36 //of a quoted name with its comma
+
+enum LogKind {
+  LOGKIND_SENSOR,
+  LOGKIND_MSG
+};
+#define LOG_KINDS 2
+
+//one daily log file
+class LogSegment {
+public:
+  uint8_t kind;
+  uint16_t day;   //elapsedDays() of the date of the file
+  size_t size;    //bytes in flash
+  time_t firstTS; //of its first and last records, 0 when it has none
+  time_t lastTS;
+
+  inline time_t date() const { return (time_t)day*SECS_PER_DAY; }
+};
+
+//The log files in LOG_DIR, kept in RAM so that FS maintenance, the cloud
+//sync and the web API need not list the directory and parse the names
+//again. It is built once when the FS is opened; LogWriter reports the
+//files it opens, the records it writes and the bytes that reach flash,
+//and FS maintenance the files it deletes.
+//When it is full the oldest file is left out: it is older than keepDays
+//and waits for the cloud, dropped() counts those and FS maintenance and
+//the web API list LOG_DIR to find them until they are deleted.
+class LogCatalog {
+public:
+  //lists LOG_DIR, false when the FS is not open or files were left out
+  static bool build();
+
+  //the file of the date of aTime was opened with size bytes, an
+  //overwritten file starts with none
+  static void opened(uint8_t kind, time_t aTime, size_t size);
+  static void recorded(uint8_t kind, time_t aTime);
+  static void written(uint8_t kind, time_t aTime, size_t size);
+  static void removed(uint8_t kind, time_t aDate);
+
+  //the file of kind of the date of aTime, NULL when there is none
+  static const LogSegment* find(uint8_t kind, time_t aTime);
+  //the first file of kind of a date not before the date of aTime, NULL when there is none
+  static const LogSegment* firstFrom(uint8_t kind, time_t aTime);
+
+  static inline uint8_t count() { return numSegments; }
+  static inline const LogSegment& get(uint8_t i) { return segments[i]; }
+  //files of LOG_DIR left out of the catalog, 0 when it has them all
+  static inline uint8_t dropped() { return numDropped; }
+  static bool fileName(const LogSegment& segment, char *out, size_t size);
+  //kind and elapsedDays() of the date of a log file name, false for other files
+  static bool parseName(const String& name, uint8_t& kind, uint16_t& day);
+
+private:
+  static LogSegment segments[LOG_CATALOG_SIZE]; //by kind, then day
+  static uint8_t numSegments;
+  static uint8_t numDropped;
+
+  //position of the first segment not before kind and day
+  static uint8_t lowerBound(uint8_t kind, uint16_t day);
+  static LogSegment* findDay(uint8_t kind, uint16_t day);
+  //the segment of kind and day, added when missing. With the catalog full the
+  //oldest one is left out, NULL when that is the one of kind and day
+  static LogSegment* segmentFor(uint8_t kind, uint16_t day);
+  //first and last record times, read from the file
+  static void readTimes(LogSegment& segment, const char* name);
+};
+
+//The names of the cataloged files as the CSV of quoted names that the
+//web API sends for the directory listing
+class LogCatalogStream : public Stream {
+public:
+  LogCatalogStream();
+
+  virtual int available() override;
+  virtual int read() override;
+  virtual int peek() override;
+  virtual size_t write(uint8_t) override { return 0; }
+  using Print::write;
+
+private:
+  uint8_t next;   //segment after the one in entry
+  char entry[LOG_CATALOG_ENTRY_SIZE];
+  uint8_t entryLen;
+  uint8_t entryPos;
+
+  bool nextEntry();
+};
+
+#endif
@@ -0,0 +1,180 @@
+/**
+ * IIRR -- Intelligent Irrigator Based on ESP8266
+    Copyright (C) 2016--2018  Sergio Queiroz <srmq@cin.ufpe.br>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "LogIndex.h"
+#include "LogWriter.h"
+#include "SensorLog.h"
+#include "TimeKeeper.h"
+
+static const char LOG_INDEX_NAME_FMT[] PROGMEM = "/idx/%s";
+static const char LOG_INDEX_TSFORMAT[] PROGMEM = "%4d%2d%2dT%2d%2d%2d";
+
+void LogIndexEntry::encode(uint8_t out[LOG_INDEX_ENTRY_SIZE]) const {
+  const uint32_t ts = timeStamp;
+  const uint32_t off = offset;
+  for (int i = 0; i < 4; i++) {
+    out[i] = (ts >> (8*i)) & 0xFF;
+    out[4 + i] = (off >> (8*i)) & 0xFF;
+  }
+}
+
+void LogIndexEntry::decode(const uint8_t in[LOG_INDEX_ENTRY_SIZE]) {
+  uint32_t ts = 0;
+  uint32_t off = 0;
+  for (int i = 0; i < 4; i++) {
+    ts |= (uint32_t)in[i] << (8*i);
+    off |= (uint32_t)in[4 + i] << (8*i);
+  }
+  timeStamp = ts;
+  offset = off;
+}
+
+bool LogIndex::indexName(const char* logName, char *out, size_t size) {
+  const char *baseName = strrchr(logName, '/');
+  baseName = (baseName == NULL) ? logName : baseName + 1;
+  return snprintf_P(out, size, LOG_INDEX_NAME_FMT, baseName) < (int)size;
+}
+
+bool LogIndex::parseTime(const char* line, time_t& aTime) {
+  int year, month, day, hour, min, secs;
+  String tsFmtStr = String(FPSTR(LOG_INDEX_TSFORMAT));
+  if (sscanf(line, tsFmtStr.c_str(), &year, &month, &day, &hour, &min, &secs) != 6) return false;
+  aTime = TimeKeeper::tkMakeTime(year, month, day, hour, min, secs);
+  return true;
+}
+
+size_t LogIndex::countEntries(File& idxFile) {
+  return idxFile.size()/LOG_INDEX_ENTRY_SIZE;
+}
+
+bool LogIndex::readEntry(File& idxFile, size_t n, LogIndexEntry& entry) {
+  uint8_t bytes[LOG_INDEX_ENTRY_SIZE];
+  if (!idxFile.seek(n*LOG_INDEX_ENTRY_SIZE, SeekSet)) return false;
+  if (idxFile.read(bytes, LOG_INDEX_ENTRY_SIZE) != LOG_INDEX_ENTRY_SIZE) return false;
+  entry.decode(bytes);
+  return true;
+}
+
+File LogIndex::openChecked(File& logFile) {
+  const size_t logSize = logFile.size();
+  char idxName[LOG_NAME_SIZE];
+  File idxFile;
+  if (!indexName(logFile.name(), idxName, LOG_NAME_SIZE)) return idxFile;
+  idxFile = SPIFFS.open(idxName, "r");
+  bool usable = false;
+  if (idxFile) {
+    const size_t count = countEntries(idxFile);
+    LogIndexEntry last;
+    usable = (idxFile.size() % LOG_INDEX_ENTRY_SIZE == 0)
+        && ((count == 0) ? (logSize == 0) : (readEntry(idxFile, count - 1, last) && last.offset < logSize));
+    if (!usable) idxFile.close();
+  }
+  if (!usable && logSize > 0) {
+    Serial.print(F("Rebuilding log index: "));
+    Serial.println(idxName);
+    if (rebuild(logFile)) idxFile = SPIFFS.open(idxName, "r");
+  }
+  return idxFile;
+}
+
+size_t LogIndex::seekHint(File& logFile, time_t aTime) {
+  File idxFile = openChecked(logFile);
+  if (!idxFile) return 0;
+  //last entry with a time not after aTime
+  size_t lo = 0;
+  size_t hi = countEntries(idxFile);
+  size_t offset = 0;
+  LogIndexEntry entry;
+  while (lo < hi) {
+    const size_t mid = lo + (hi - lo)/2;
+    if (!readEntry(idxFile, mid, entry)) break;
+    if (entry.timeStamp <= aTime) {
+      offset = entry.offset;
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  idxFile.close();
+  return offset;
+}
+
+bool LogIndex::lastEntry(File& logFile, LogIndexEntry& entry) {
+  File idxFile = openChecked(logFile);
+  if (!idxFile) return false;
+  const size_t count = countEntries(idxFile);
+  const bool found = (count > 0) && readEntry(idxFile, count - 1, entry);
+  idxFile.close();
+  return found;
+}
+
+bool LogIndex::append(const char* logName, const LogIndexEntry *entries, uint8_t count) {
+  char idxName[LOG_NAME_SIZE];
+  if (!indexName(logName, idxName, LOG_NAME_SIZE)) return false;
+  File idxFile = SPIFFS.open(idxName, "a+");
+  if (!idxFile) return false;
+  const size_t indexed = countEntries(idxFile);
+  LogIndexEntry last;
+  const bool hasLast = (indexed > 0) && readEntry(idxFile, indexed - 1, last);
+  uint8_t bytes[LOG_INDEX_ENTRY_SIZE*LOG_INDEX_PENDING];
+  size_t length = 0;
+  for (uint8_t i = 0; i < count && i < LOG_INDEX_PENDING; i++) {
+    if (hasLast && entries[i].offset <= last.offset) continue;
+    entries[i].encode(bytes + length);
+    length += LOG_INDEX_ENTRY_SIZE;
+  }
+  const bool allOk = (length == 0) || (idxFile.write(bytes, length) == length);
+  idxFile.close();
+  return allOk;
+}
+
+bool LogIndex::rebuild(File& logFile) {
+  char idxName[LOG_NAME_SIZE];
+  if (!indexName(logFile.name(), idxName, LOG_NAME_SIZE)) return false;
+  File idxFile = SPIFFS.open(idxName, "w");
+  if (!idxFile) return false;
+  //a binary sensor log is read as its CSV lines, at record offsets, through
+  //the handle of the caller
+  logFile.seek(0, SeekSet);
+  SensorLogStream log(logFile);
+  char line[LOG_INDEX_LINE_SIZE];
+  bool hasEntry = false;
+  size_t lastOffset = 0;
+  bool allOk = true;
+  while (log.available() > 0) {
+    const size_t pos = log.position();
+    memset(line, '\0', sizeof(line));
+    log.readBytesUntil('\n', line, LOG_INDEX_LINE_SIZE - 1);
+    time_t ts;
+    if ((!hasEntry || (pos - lastOffset) >= LOG_INDEX_STRIDE) && parseTime(line, ts)) {
+      uint8_t bytes[LOG_INDEX_ENTRY_SIZE];
+      LogIndexEntry(ts, pos).encode(bytes);
+      allOk = (idxFile.write(bytes, LOG_INDEX_ENTRY_SIZE) == LOG_INDEX_ENTRY_SIZE) && allOk;
+      hasEntry = true;
+      lastOffset = pos;
+    }
+  }
+  idxFile.close();
+  return allOk;
+}
+
+bool LogIndex::remove(const char* logName) {
+  char idxName[LOG_NAME_SIZE];
+  if (!indexName(logName, idxName, LOG_NAME_SIZE)) return false;
+  return !SPIFFS.exists(idxName) || SPIFFS.remove(idxName);
+}
@@ -0,0 +1,78 @@
+/**
+ * IIRR -- Intelligent Irrigator Based on ESP8266
+    Copyright (C) 2016--2018  Sergio Queiroz <srmq@cin.ufpe.br>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef _LOG_INDEX_H_
+#define _LOG_INDEX_H_
+
+#include <Arduino.h>
+#include "FS.h"
+#include <TimeLib.h>
+
+#define LOG_INDEX_STRIDE 256     //log bytes between indexed records, about a page
+#define LOG_INDEX_ENTRY_SIZE 8
+#define LOG_INDEX_PENDING 8      //entries LogWriter keeps until a commit
+#define LOG_INDEX_LINE_SIZE 81
+
+//one indexed record: its time and where it starts in the log
+class LogIndexEntry {
+public:
+  time_t timeStamp;
+  size_t offset;
+
+  LogIndexEntry() : timeStamp(0), offset(0) { }
+  LogIndexEntry(time_t aTime, size_t offset) : timeStamp(aTime), offset(offset) { }
+
+  void encode(uint8_t out[LOG_INDEX_ENTRY_SIZE]) const;
+  void decode(const uint8_t in[LOG_INDEX_ENTRY_SIZE]);
+};
+
+//Sparse index of a daily log file, kept in /idx with the name of the log:
+//the (time, offset) of a record every LOG_INDEX_STRIDE bytes, 8 bytes
+//each, little endian, in log order. LogWriter appends to it as records are
+//written; an index that is missing, or that points past the end of its
+//log, is rebuilt by scanning the log. Records are expected in time order,
+//as the logs are written, so a binary search finds where to start reading.
+class LogIndex {
+public:
+  //false when logName does not fit the index directory
+  static bool indexName(const char* logName, char *out, size_t size);
+  //The log is passed open, a rebuild reads it through that handle and
+  //leaves its position anywhere, so the caller seeks after. Only the index
+  //file is opened, see FS_MAX_OPEN_FILES.
+
+  //offset in logFile where a scan for the records after aTime can start:
+  //the last indexed record at or before aTime, 0 when there is none
+  static size_t seekHint(File& logFile, time_t aTime);
+  //last entry of the index of logFile, rebuilding a missing or stale
+  //index. False when the log has no timestamped record
+  static bool lastEntry(File& logFile, LogIndexEntry& entry);
+  //entries not after the last one of the index are dropped
+  static bool append(const char* logName, const LogIndexEntry *entries, uint8_t count);
+  static bool rebuild(File& logFile);
+  static bool remove(const char* logName);
+  //time of a log line, false when it does not start with one
+  static bool parseTime(const char* line, time_t& aTime);
+
+private:
+  static size_t countEntries(File& idxFile);
+  static bool readEntry(File& idxFile, size_t n, LogIndexEntry& entry);
+  //the index file, checked against its log, rebuilt when it is not usable
+  static File openChecked(File& logFile);
+};
+
+#endif
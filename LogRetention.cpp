@@ -0,0 +1,163 @@
+/**
+ * IIRR -- Intelligent Irrigator Based on ESP8266
+    Copyright (C) 2016--2018  Sergio Queiroz <srmq@cin.ufpe.br>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "LogRetention.h"
+#include "LogWriter.h"
+#include "LogIndex.h"
+#include "global_funcs.h"
+
+LogRetention::LogRetention(LogAckCheck ackCheck) :
+    ackCheck(ackCheck),
+    evicting(false),
+    checkDue(true),
+    lastCheckMs(0),
+    usedBytes(0),
+    totalBytes(0),
+    evictions(0),
+    lastReason(RETENTION_NONE),
+    blockedBytes(0) { }
+
+bool LogRetention::canEvict(const LogSegment& segment, time_t nowTime) {
+  if (segment.day == elapsedDays(nowTime)) return false;
+  return (ackCheck == NULL) || ackCheck(segment.kind, segment.lastTS);
+}
+
+int LogRetention::oldestOf(uint8_t kind, time_t nowTime) {
+  //the catalog has the files of a kind by date
+  for (uint8_t i = 0; i < LogCatalog::count(); i++) {
+    const LogSegment& segment = LogCatalog::get(i);
+    if (segment.kind == kind && canEvict(segment, nowTime)) return i;
+  }
+  return -1;
+}
+
+int LogRetention::pickVictim(const ConfParams& conf, unsigned int keepDays, time_t nowTime, RetentionReason& reason) {
+  size_t kindBytes[LOG_KINDS] = {0, 0};
+  for (uint8_t i = 0; i < LogCatalog::count(); i++) {
+    const LogSegment& segment = LogCatalog::get(i);
+    kindBytes[segment.kind] += segment.size;
+    const time_t logFileTime = segment.date();
+    if (nowTime > logFileTime && (nowTime - logFileTime)/SECS_PER_DAY > keepDays && canEvict(segment, nowTime)) {
+      reason = RETENTION_AGE;
+      return i;
+    }
+  }
+
+  const float quota[LOG_KINDS] = {conf.sensorLogQuota, conf.msgLogQuota};
+  for (uint8_t k = 0; k < LOG_KINDS; k++) {
+    if (quota[k] > 0 && kindBytes[k] > quota[k]*totalBytes) {
+      const int i = oldestOf(k, nowTime);
+      if (i >= 0) {
+        reason = RETENTION_QUOTA;
+        return i;
+      }
+    }
+  }
+
+  blockedBytes = 0;
+  if (!evicting) return -1;
+  //the kind furthest over its quota first, a kind without a quota has none
+  const float sensorExcess = kindBytes[LOGKIND_SENSOR] - quota[LOGKIND_SENSOR]*totalBytes;
+  const float msgExcess = kindBytes[LOGKIND_MSG] - quota[LOGKIND_MSG]*totalBytes;
+  const uint8_t first = (msgExcess > sensorExcess) ? LOGKIND_MSG : LOGKIND_SENSOR;
+  for (uint8_t n = 0; n < LOG_KINDS; n++) {
+    const int i = oldestOf((first + n) % LOG_KINDS, nowTime);
+    if (i >= 0) {
+      reason = RETENTION_WATERMARK;
+      return i;
+    }
+  }
+  blockedBytes = usedBytes - (size_t)(conf.fsLowWater*totalBytes);
+  Serial.print(F("WARNING: log retention cannot free space, bytes waiting for the cloud: "));
+  Serial.println(blockedBytes);
+  return -1;
+}
+
+bool LogRetention::evict(uint8_t i) {
+  const LogSegment segment = LogCatalog::get(i);
+  char fileName[LOG_NAME_SIZE];
+  if (!LogCatalog::fileName(segment, fileName, LOG_NAME_SIZE)) return false;
+  Serial.print(F("Log retention is deleting file: "));
+  Serial.println(fileName);
+  if (!SPIFFS.remove(fileName)) return false;
+  LogCatalog::removed(segment.kind, segment.date());
+  evictions++;
+  return LogIndex::remove(fileName);
+}
+
+bool LogRetention::evictUncataloged(unsigned int keepDays, time_t nowTime, bool& deleted) {
+  deleted = false;
+  Dir logDir = SPIFFS.openDir(String(FPSTR(LOG_DIR)));
+  String victim;
+  uint8_t victimKind = 0;
+  uint16_t victimDay = 0xFFFF;
+  while (logDir.next()) {
+    const String name = logDir.fileName();
+    uint8_t kind;
+    uint16_t day;
+    if (!LogCatalog::parseName(name, kind, day) || day >= victimDay) continue;
+    const time_t logFileTime = (time_t)day*SECS_PER_DAY;
+    if (LogCatalog::find(kind, logFileTime) != NULL) continue;
+    if (nowTime <= logFileTime || (nowTime - logFileTime)/SECS_PER_DAY <= keepDays) continue;
+    //its last record is not known, the end of its day is taken
+    if (ackCheck != NULL && !ackCheck(kind, logFileTime + SECS_PER_DAY - 1)) continue;
+    victim = name;
+    victimKind = kind;
+    victimDay = day;
+  }
+  if (victim.length() == 0) return true;
+  Serial.print(F("Log retention is deleting file: "));
+  Serial.println(victim);
+  if (!SPIFFS.remove(victim)) return false;
+  LogCatalog::removed(victimKind, (time_t)victimDay*SECS_PER_DAY);
+  evictions++;
+  lastReason = RETENTION_AGE;
+  deleted = true;
+  return LogIndex::remove(victim.c_str());
+}
+
+bool LogRetention::step(const ConfParams& conf, unsigned int keepDays, time_t nowTime, unsigned long nowMs) {
+  if (!fsOpen) return true;
+  if (!checkDue && (nowMs - lastCheckMs) < RETENTION_CHECK_MS) return true;
+  checkDue = false;
+  lastCheckMs = nowMs;
+  FSInfo info;
+  if (!SPIFFS.info(info)) return false;
+  usedBytes = info.usedBytes;
+  totalBytes = info.totalBytes;
+  if (usedBytes > conf.fsHighWater*totalBytes) {
+    evicting = true;
+  } else if (usedBytes <= conf.fsLowWater*totalBytes) {
+    evicting = false;
+  }
+  if (LogCatalog::dropped() > 0) {
+    bool deleted;
+    if (!evictUncataloged(keepDays, nowTime, deleted)) return false;
+    if (deleted) {
+      checkDue = true;
+      return true;
+    }
+  }
+  RetentionReason reason;
+  const int i = pickVictim(conf, keepDays, nowTime, reason);
+  if (i < 0) return true;
+  lastReason = reason;
+  if (!evict(i)) return false;
+  checkDue = true; //the next file, if there is one, on the next step
+  return true;
+}
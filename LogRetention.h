@@ -0,0 +1,87 @@
+/**
+ * IIRR -- Intelligent Irrigator Based on ESP8266
+    Copyright (C) 2016--2018  Sergio Queiroz <srmq@cin.ufpe.br>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef _LOG_RETENTION_H_
+#define _LOG_RETENTION_H_
+
+#include <Arduino.h>
+#include "FS.h"
+#include <TimeLib.h>
+#include "ConfParams.h"
+#include "LogCatalog.h"
+
+#define RETENTION_CHECK_MS 60000ul //FSInfo is read this often while nothing is being evicted
+
+//whether the records of a log of kind up to aTime may be deleted, the
+//cloud sync answers it
+typedef bool (*LogAckCheck)(uint8_t kind, time_t aTime);
+
+enum RetentionReason {
+  RETENTION_NONE,
+  RETENTION_AGE,       //older than keepDays
+  RETENTION_QUOTA,     //its kind takes more than its quota of the FS
+  RETENTION_WATERMARK  //the FS went over fsHighWater and is not yet down to fsLowWater
+};
+
+//Deletes the oldest log files, with their indexes, a file per step() so
+//the sensor loop is never held for long. In this order:
+//  files older than keepDays
+//  the oldest of a kind over its quota of the FS
+//  while the FS is above fsHighWater, until it is down to fsLowWater, the
+//  oldest of the kind furthest over its quota
+//Files the full catalog left out are older than keepDays, they go first.
+//A file is deleted only when ackCheck lets it, and the file of today never.
+class LogRetention {
+public:
+  LogRetention(LogAckCheck ackCheck);
+
+  //deletes at most one file, false when a deletion failed
+  bool step(const ConfParams& conf, unsigned int keepDays, time_t nowTime, unsigned long nowMs);
+  //the next step reads FSInfo, as before a new log file is opened
+  inline void checkSoon() { checkDue = true; }
+
+  inline bool isEvicting() const { return evicting; }
+  inline size_t getUsedBytes() const { return usedBytes; }
+  inline size_t getTotalBytes() const { return totalBytes; }
+  inline unsigned long getEvictions() const { return evictions; }
+  //why the last file was deleted
+  inline RetentionReason getLastReason() const { return lastReason; }
+  //bytes of the files the FS needs freed but the cloud has not acknowledged yet
+  inline size_t getBlockedBytes() const { return blockedBytes; }
+
+private:
+  LogAckCheck ackCheck;
+  bool evicting;
+  bool checkDue;
+  unsigned long lastCheckMs;
+  size_t usedBytes;
+  size_t totalBytes;
+  unsigned long evictions;
+  RetentionReason lastReason;
+  size_t blockedBytes;
+
+  bool canEvict(const LogSegment& segment, time_t nowTime);
+  //catalog position of the oldest file of kind that can be deleted, -1 when there is none
+  int oldestOf(uint8_t kind, time_t nowTime);
+  int pickVictim(const ConfParams& conf, unsigned int keepDays, time_t nowTime, RetentionReason& reason);
+  //the oldest file of LOG_DIR out of the catalog that can be deleted, false when a deletion failed
+  bool evictUncataloged(unsigned int keepDays, time_t nowTime, bool& deleted);
+  bool evict(uint8_t i);
+};
+
+#endif
@@ -0,0 +1,173 @@
+/**
+ * IIRR -- Intelligent Irrigator Based on ESP8266
+    Copyright (C) 2016--2018  Sergio Queiroz <srmq@cin.ufpe.br>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "LogWriter.h"
+#include "TimeKeeper.h"
+#include "global_funcs.h"
+#include "Hal.h"
+#include "LogCatalog.h"
+
+LogWriter::LogWriter(uint8_t kind, PGM_P fmtStr, LogOpenHook beforeOpen) :
+    kind(kind),
+    fmtStr(fmtStr),
+    beforeOpen(beforeOpen),
+    isOpen(false),
+    fileDay(-1),
+    failedDay(-1),
+    fileSize(0),
+    headerSize(0),
+    recordSize(0),
+    recordLost(false),
+    buffered(0),
+    bufferedSinceMs(0),
+    flashWrites(0),
+    numPending(0),
+    hasIndexed(false),
+    lastIndexed(0) {
+  fileName[0] = '\0';
+}
+
+bool LogWriter::beginRecord(time_t aTime) {
+  recordLost = false;
+  if (elapsedDays(aTime) == failedDay) return false;
+  if (!(isOpen && elapsedDays(aTime) == fileDay) && !openFile(aTime)) return false;
+  indexRecord(aTime);
+  LogCatalog::recorded(kind, aTime);
+  return true;
+}
+
+bool LogWriter::openFile(time_t aTime) {
+  close();
+  if (!fsOpen) return false;
+  if (beforeOpen != NULL) beforeOpen();
+  snprintf_P(fileName, LOG_NAME_SIZE, fmtStr, TimeKeeper::tkYear(aTime), TimeKeeper::tkMonth(aTime), TimeKeeper::tkDay(aTime));
+  //before the clock is set the dates are not real, their file starts over
+  const bool append = TimeKeeper::isValidTS(aTime);
+  Serial.print(F("Opening file: "));
+  Serial.print(fileName);
+  Serial.println(append ? F(" for append") : F(" for overwrite"));
+  if (!append) LogIndex::remove(fileName);
+  file = SPIFFS.open(fileName, append ? "a+" : "w");
+  if (!file) return false;
+  isOpen = true;
+  fileDay = elapsedDays(aTime);
+  fileSize = file.size();
+  LogCatalog::opened(kind, aTime, fileSize);
+  LogIndexEntry last;
+  hasIndexed = (fileSize > 0) && LogIndex::lastEntry(file, last);
+  lastIndexed = last.offset;
+  return true;
+}
+
+void LogWriter::indexRecord(time_t aTime) {
+  const size_t offset = getFileSize();
+  if (hasIndexed && (offset - lastIndexed) < LOG_INDEX_STRIDE) return;
+  if (numPending >= LOG_INDEX_PENDING) commit();
+  pending[numPending++] = LogIndexEntry(aTime, offset);
+  hasIndexed = true;
+  lastIndexed = offset;
+}
+
+size_t LogWriter::write(uint8_t c) {
+  return write(&c, 1);
+}
+
+size_t LogWriter::write(const uint8_t *data, size_t size) {
+  if (!isOpen || recordLost) return 0;
+  for (size_t i = 0; i < size; i++) {
+    if (buffered == 0) bufferedSinceMs = Hal::halMillis();
+    buffer[buffered++] = data[i];
+    if (buffered >= toPageEnd() && !writeOut(toPageEnd())) return i + 1;
+  }
+  return size;
+}
+
+//the first n buffered bytes go to the file, the rest move to the front
+bool LogWriter::writeOut(size_t n) {
+  const size_t written = file.write(buffer, n);
+  file.flush();
+  flashWrites++;
+  if (written != n) {
+    dropUnwritten(written);
+    return false;
+  }
+  fileSize += written;
+  LogCatalog::written(kind, (time_t)fileDay*SECS_PER_DAY, fileSize);
+  buffered -= n;
+  memmove(buffer, buffer + n, buffered);
+  if (buffered > 0) bufferedSinceMs = Hal::halMillis();
+  return true;
+}
+
+//the bytes that did not make it are lost rather than retried forever, with
+//the records they cut and the index entries of those
+void LogWriter::dropUnwritten(size_t written) {
+  const size_t cutAt = fileSize + written;
+  size_t keepTo = cutAt;
+  if (recordSize > 0) {
+    keepTo = (cutAt < headerSize) ? 0 : cutAt - (cutAt - headerSize) % recordSize;
+  }
+  const long day = fileDay;
+  if (keepTo < cutAt && !file.truncate(keepTo)) {
+    //the next record would be read from the middle of this one
+    Serial.print(F("WARNING: no more records today, could not cut the log back to a whole record: "));
+    Serial.println(fileName);
+    buffered = 0;
+    numPending = 0;
+    close();
+    failedDay = day;
+    return;
+  }
+  fileSize = keepTo;
+  LogCatalog::written(kind, (time_t)day*SECS_PER_DAY, fileSize);
+  //in the buffer, the records after the lost bytes are not whole either
+  buffered = 0;
+  recordLost = true;
+  uint8_t kept = 0;
+  while (kept < numPending && pending[kept].offset < keepTo) kept++;
+  numPending = kept;
+  if (hasIndexed && lastIndexed >= keepTo) {
+    //the next record is indexed, the index may then have one entry closer than LOG_INDEX_STRIDE
+    hasIndexed = false;
+  }
+}
+
+//the index entries go after the records they point to
+bool LogWriter::commit() {
+  if (!isOpen) return true;
+  bool allOk = (buffered == 0) || writeOut(buffered);
+  if (numPending > 0) {
+    allOk = LogIndex::append(fileName, pending, numPending) && allOk;
+    numPending = 0;
+  }
+  return allOk;
+}
+
+void LogWriter::commitDue(unsigned long nowMs) {
+  if (buffered > 0 && (nowMs - bufferedSinceMs) >= LOG_COMMIT_MS) commit();
+}
+
+void LogWriter::close() {
+  if (!isOpen) return;
+  commit();
+  file.close();
+  isOpen = false;
+  fileDay = -1;
+  buffered = 0;
+  hasIndexed = false;
+}
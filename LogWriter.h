@@ -0,0 +1,117 @@
+/**
+ * IIRR -- Intelligent Irrigator Based on ESP8266
+    Copyright (C) 2016--2018  Sergio Queiroz <srmq@cin.ufpe.br>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef _LOG_WRITER_H_
+#define _LOG_WRITER_H_
+
+#include <Arduino.h>
+#include "FS.h"
+#include <TimeLib.h>
+#include "LogIndex.h"
+
+#define LOG_PAGE_DATA 251       //data bytes of a 256 byte SPIFFS page
+#define LOG_COMMIT_MS 300000ul  //a record waits at most this long in RAM
+#define LOG_NAME_SIZE 33
+
+typedef void (*LogOpenHook)();
+
+//Appends the records of one daily log file. The file of the current date
+//is kept open and records are gathered in RAM: a write goes to flash when
+//it fills the last page of the file, so SPIFFS programs each page once,
+//and the rest goes out by commit(), from commitDue() after LOG_COMMIT_MS,
+//before the pump or the valves change state and right after the record of
+//the change, or before a reader opens the file.
+//A record every LOG_INDEX_STRIDE bytes goes to the LogIndex of the file at
+//the next commit. The files opened, their records and the bytes that reach
+//flash are reported to the LogCatalog.
+//On a short write, as on a full FS, the rest of the record is dropped. A
+//file of fixed size records (setRecordSize()) is cut back to the last whole
+//one, so its records stay aligned; if it cannot be cut, the log of that day
+//is given up. A line of text cut short runs into the next record, the
+//lines after it are whole.
+//Usage, from one task only:
+//  if (log.beginRecord(aTime)) {
+//    log.print(...); log.println(...);
+//  }
+class LogWriter : public Print {
+public:
+  //kind is the LogKind of the files in the LogCatalog. fmtStr makes the
+  //file name from year, month and day. beforeOpen, if not NULL, runs
+  //before the file of a new date is opened
+  LogWriter(uint8_t kind, PGM_P fmtStr, LogOpenHook beforeOpen);
+
+  //switches to the file of the date of aTime, false when there is no file to write
+  bool beginRecord(time_t aTime);
+
+  virtual size_t write(uint8_t c) override;
+  virtual size_t write(const uint8_t *buffer, size_t size) override;
+  using Print::write;
+
+  //records of recordSize bytes after a header of headerSize, 0 for lines of text
+  inline void setRecordSize(size_t headerSize, size_t recordSize) {
+    this->headerSize = headerSize;
+    this->recordSize = recordSize;
+  }
+
+  //writes out the buffer, false when it could not be written
+  bool commit();
+  //commits when the oldest buffered byte is LOG_COMMIT_MS old
+  void commitDue(unsigned long nowMs);
+  //commits and closes the file, the next record opens it again
+  void close();
+
+  inline size_t getBuffered() const { return buffered; }
+  //of the open file, with the bytes still buffered
+  inline size_t getFileSize() const { return fileSize + buffered; }
+  inline const char* getFileName() const { return fileName; }
+  //flash writes done, each at most a page
+  inline unsigned long getFlashWrites() const { return flashWrites; }
+
+private:
+  uint8_t kind;
+  PGM_P fmtStr;
+  LogOpenHook beforeOpen;
+  File file;
+  char fileName[LOG_NAME_SIZE];
+  bool isOpen;
+  long fileDay;  //elapsedDays() of the open file
+  long failedDay; //the log of this day could not be cut back to a whole record
+  size_t fileSize;
+  size_t headerSize;
+  size_t recordSize;
+  bool recordLost; //the rest of the record is dropped, until the next beginRecord()
+  uint8_t buffer[LOG_PAGE_DATA];
+  size_t buffered;
+  unsigned long bufferedSinceMs;
+  unsigned long flashWrites;
+  LogIndexEntry pending[LOG_INDEX_PENDING];
+  uint8_t numPending;
+  bool hasIndexed; //lastIndexed is the offset of the last indexed record
+  size_t lastIndexed;
+
+  //bytes that complete the last page of the file
+  inline size_t toPageEnd() const { return LOG_PAGE_DATA - fileSize % LOG_PAGE_DATA; }
+  bool writeOut(size_t n);
+  //after a short write of the buffer, of which written bytes went out
+  void dropUnwritten(size_t written);
+  bool openFile(time_t aTime);
+  //the record about to be written starts at the end of the file
+  void indexRecord(time_t aTime);
+};
+
+#endif
@@ -0,0 +1,87 @@
+/**
+ * IIRR -- Intelligent Irrigator Based on ESP8266
+    Copyright (C) 2016--2018  Sergio Queiroz <srmq@cin.ufpe.br>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "MoistureCurve.h"
+#include <math.h>
+
+#define CURVE_TABLE_BITS 5
+#define CURVE_TABLE_SIZE ((1 << CURVE_TABLE_BITS) + 1)
+
+//log2(1 + i/32) in Q16
+static const uint32_t LOG2_TABLE[CURVE_TABLE_SIZE] PROGMEM = {
+  0, 2909, 5732, 8473, 11136, 13727, 16248, 18704, 21098, 23433, 25711,
+  27936, 30109, 32234, 34312, 36346, 38336, 40286, 42196, 44068, 45904,
+  47705, 49472, 51207, 52911, 54584, 56229, 57845, 59434, 60997, 62534,
+  64047, 65536
+};
+
+//2^(-i/32) in Q16
+static const uint32_t EXP2_TABLE[CURVE_TABLE_SIZE] PROGMEM = {
+  65536, 64132, 62757, 61413, 60097, 58809, 57549, 56316, 55109, 53928,
+  52773, 51642, 50535, 49452, 48393, 47356, 46341, 45348, 44376, 43425,
+  42495, 41584, 40693, 39821, 38968, 38133, 37316, 36516, 35734, 34968,
+  34219, 33486, 32768
+};
+
+//linear interpolation between entries i and i+1, frac in Q16
+static inline int32_t interpolate(const uint32_t *table, uint32_t i, uint32_t frac) {
+  const int32_t lo = pgm_read_dword(&table[i]);
+  const int32_t hi = pgm_read_dword(&table[i + 1]);
+  return lo + int32_t((int64_t(hi - lo)*frac) >> 16);
+}
+
+MoistureCurve::MoistureCurve(double mulX, double expFact) {
+  setParams(mulX, expFact);
+}
+
+void MoistureCurve::setParams(double mulX, double expFact) {
+  this->mulX = mulX;
+  this->expFact = expFact;
+  log2MulXQ16 = int32_t(log(mulX)/log(2.0)*MOISTURE_Q16_ONE + 0.5);
+  invExpFactQ16 = uint32_t(MOISTURE_Q16_ONE/expFact + 0.5);
+}
+
+int32_t MoistureCurve::log2Q16(uint32_t x) {
+  const int intPart = 31 - __builtin_clz(x);
+  //mantissa bits below the leading one, aligned to bit 31
+  const uint32_t mantissa = (x << (31 - intPart)) << 1;
+  const uint32_t i = mantissa >> (32 - CURVE_TABLE_BITS);
+  const uint32_t frac = (mantissa << CURVE_TABLE_BITS) >> 16;
+  return (int32_t(intPart) << 16) + interpolate(LOG2_TABLE, i, frac);
+}
+
+uint32_t MoistureCurve::exp2NegQ16(uint32_t y) {
+  const uint32_t intPart = y >> 16;
+  if (intPart > 16) return 0;
+  const uint32_t i = (y & 0xFFFF) >> (16 - CURVE_TABLE_BITS);
+  const uint32_t frac = (y << CURVE_TABLE_BITS) & 0xFFFF;
+  return uint32_t(interpolate(EXP2_TABLE, i, frac)) >> intPart;
+}
+
+uint32_t MoistureCurve::toMoistureQ16(long resistance) const {
+  const int32_t aboveMulX = log2Q16(uint32_t(resistance)) - log2MulXQ16;
+  if (aboveMulX <= 0) return MOISTURE_Q16_ONE;
+  const uint32_t y = uint32_t((uint64_t(aboveMulX)*invExpFactQ16) >> 16);
+  return exp2NegQ16(y);
+}
+
+float MoistureCurve::toMoistureFloat(long resistance) const {
+  float value = float(exp((log(mulX)-log(resistance))/(expFact)));
+  if (value > 1) value = 1;
+  return value;
+}
@@ -0,0 +1,63 @@
+/**
+ * IIRR -- Intelligent Irrigator Based on ESP8266
+    Copyright (C) 2016--2018  Sergio Queiroz <srmq@cin.ufpe.br>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef _MOISTURE_CURVE_H_
+#define _MOISTURE_CURVE_H_
+
+#include <Arduino.h>
+#include "sensor_calibration.h"
+
+#define MOISTURE_Q16_ONE 65536ul
+
+//Resistance to moisture curve moisture = (mulX/resistance)^(1/expFact),
+//evaluated in fixed point as 2^(-(log2(resistance) - log2(mulX))/expFact)
+//with interpolated log2 and exp2 tables shared by every curve. A curve
+//is just two Q16 constants, so each probe may have its own.
+class MoistureCurve {
+public:
+  MoistureCurve(double mulX = MOISTURE_MULX, double expFact = MOISTURE_EXPFACT);
+
+  void setParams(double mulX, double expFact);
+
+  //moisture in Q16 (MOISTURE_Q16_ONE is saturated soil), resistance > 0
+  uint32_t toMoistureQ16(long resistance) const;
+
+  inline float toMoisture(long resistance) const {
+    return float(toMoistureQ16(resistance))/MOISTURE_Q16_ONE;
+  }
+
+  //reference floating point path, for validation of the fixed point one
+  float toMoistureFloat(long resistance) const;
+
+  inline double getMulX() const { return mulX; }
+  inline double getExpFact() const { return expFact; }
+
+  //log2(x) in Q16, x > 0
+  static int32_t log2Q16(uint32_t x);
+
+  //2^(-y) in Q16, y in Q16
+  static uint32_t exp2NegQ16(uint32_t y);
+
+private:
+  double mulX;
+  double expFact;
+  int32_t log2MulXQ16;
+  uint32_t invExpFactQ16;
+};
+
+#endif
@@ -0,0 +1,44 @@
+/**
+ * IIRR -- Intelligent Irrigator Based on ESP8266
+    Copyright (C) 2016--2018  Sergio Queiroz <srmq@cin.ufpe.br>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef _MUX_ADDRESS_H_
+#define _MUX_ADDRESS_H_
+
+#include "Hal.h"
+#include "sensor_calibration.h"
+
+constexpr uint32_t pinBit(uint8_t pin) {
+  return 1ul << pin;
+}
+
+//3 bit address on pins p0 (least significant), p1 and p2
+constexpr GpioMasks addressMasks(int address, uint8_t p0, uint8_t p1, uint8_t p2) {
+  return GpioMasks(((address & 1) ? pinBit(p0) : 0) | ((address & 2) ? pinBit(p1) : 0) | ((address & 4) ? pinBit(p2) : 0),
+                   ((address & 1) ? 0 : pinBit(p0)) | ((address & 2) ? 0 : pinBit(p1)) | ((address & 4) ? 0 : pinBit(p2)));
+}
+
+//decoder output 2*SensorType + SensorDirection drives a probe, FLOWSENSOR_DECODER_OUTPUT the flow sensor
+constexpr GpioMasks decoderMasks(int output) {
+  return addressMasks(output, DECOD_A0_PIN, DECOD_A1_PIN, DECOD_A2_PIN);
+}
+
+constexpr GpioMasks muxMasks(SensorInput input) {
+  return addressMasks(input, MULA_PIN, MULB_PIN, MULC_PIN);
+}
+
+#endif
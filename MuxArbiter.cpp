@@ -0,0 +1,99 @@
+/**
+ * IIRR -- Intelligent Irrigator Based on ESP8266
+    Copyright (C) 2016--2018  Sergio Queiroz <srmq@cin.ufpe.br>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "MuxArbiter.h"
+#include "sensor_calibration.h"
+#include "global_funcs.h"
+
+MuxClient MuxArbiter::owner = MUX_NONE;
+bool MuxArbiter::flowLeased = false;
+GpioMasks MuxArbiter::flowChannel(0, 0);
+MuxHandover MuxArbiter::flowHandover = NULL;
+unsigned long MuxArbiter::flowSinceMs = 0;
+
+void MuxArbiter::begin() {
+  Hal::halPinMode(DECOD_A0_PIN, OUTPUT);
+  Hal::halPinMode(DECOD_A1_PIN, OUTPUT);
+  Hal::halPinMode(DECOD_A2_PIN, OUTPUT);
+  Hal::halPinMode(MUL_DECOD_INHIB_PIN, OUTPUT);
+  disableMulAndDecod();
+  Hal::halPinMode(MULA_PIN, OUTPUT);
+  Hal::halPinMode(MULB_PIN, OUTPUT);
+  Hal::halPinMode(MULC_PIN, OUTPUT);
+  owner = MUX_NONE;
+}
+
+//break before make, no output sees the address lines moving
+void MuxArbiter::drive(const GpioMasks& channel) {
+  disableMulAndDecod();
+  Hal::halWriteMasks(channel);
+  enableMulAndDecod();
+}
+
+void MuxArbiter::grantFlow() {
+  drive(flowChannel);
+  owner = MUX_FLOW;
+  flowSinceMs = Hal::halMillis();
+  if (flowHandover != NULL) flowHandover(true);
+}
+
+bool MuxArbiter::acquire(MuxClient client, const GpioMasks& channel, MuxHandover handover) {
+  switch (client) {
+    case MUX_FLOW:
+      flowLeased = true;
+      flowChannel = channel;
+      flowHandover = handover;
+      //else granted when the probe read releases it
+      if (owner == MUX_PROBES) return false;
+      drive(flowChannel);
+      owner = MUX_FLOW;
+      flowSinceMs = Hal::halMillis();
+      return true;
+    case MUX_PROBES:
+      if (owner == MUX_PROBES || waitMs(MUX_PROBES) > 0) return false;
+      if (owner == MUX_FLOW && flowHandover != NULL) flowHandover(false);
+      drive(channel);
+      owner = MUX_PROBES;
+      return true;
+    default:
+      return false;
+  }
+}
+
+bool MuxArbiter::select(MuxClient client, const GpioMasks& channel) {
+  if (client != owner) return false;
+  Hal::halWriteMasks(channel);
+  return true;
+}
+
+void MuxArbiter::release(MuxClient client) {
+  if (client == MUX_FLOW) {
+    flowLeased = false;
+    flowHandover = NULL;
+  }
+  if (client != owner) return;
+  disableMulAndDecod();
+  owner = MUX_NONE;
+  if (client == MUX_PROBES && flowLeased) grantFlow();
+}
+
+unsigned long MuxArbiter::waitMs(MuxClient client) {
+  if (client != MUX_PROBES || owner != MUX_FLOW) return 0;
+  const unsigned long heldMs = Hal::halMillis() - flowSinceMs;
+  return (heldMs < MUX_FLOW_SLICE_MS) ? (MUX_FLOW_SLICE_MS - heldMs) : 0;
+}
@@ -0,0 +1,68 @@
+/**
+ * IIRR -- Intelligent Irrigator Based on ESP8266
+    Copyright (C) 2016--2018  Sergio Queiroz <srmq@cin.ufpe.br>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef _MUX_ARBITER_H_
+#define _MUX_ARBITER_H_
+
+#include "Hal.h"
+
+#define MUX_FLOW_SLICE_MS 40 //least time the flow sensor keeps the decoder between two probe reads
+
+enum MuxClient {
+  MUX_NONE,
+  MUX_FLOW, //standing lease while the pump runs, the decoder powers the flow sensor
+  MUX_PROBES //one probe read, preempts MUX_FLOW
+};
+
+//called with false when a standing lease loses the decoder, with true when it gets it back
+typedef void (*MuxHandover)(bool hasMux);
+
+//The decoder and mux address lines and the inhibit pin are written only
+//here, so a client never finds a channel selected by another one. The
+//flow sensor holds a standing lease while the pump runs. Every probe read
+//takes a short lease that preempts it, and the release hands the decoder
+//back to the flow sensor for at least MUX_FLOW_SLICE_MS, so flow
+//supervision keeps running during a moisture scan.
+//Switching the decoder output goes through the inhibited state.
+class MuxArbiter {
+public:
+  static void begin();
+
+  //false while the decoder is not available to client yet, see waitMs()
+  static bool acquire(MuxClient client, const GpioMasks& channel, MuxHandover handover = NULL);
+  //another mux input for the lease owner, the decoder output stays driven
+  static bool select(MuxClient client, const GpioMasks& channel);
+  static void release(MuxClient client);
+
+  //ms until acquire() may grant the decoder to client
+  static unsigned long waitMs(MuxClient client);
+
+  static inline MuxClient getOwner() { return owner; }
+
+private:
+  static MuxClient owner;
+  static bool flowLeased;
+  static GpioMasks flowChannel;
+  static MuxHandover flowHandover;
+  static unsigned long flowSinceMs;
+
+  static void drive(const GpioMasks& channel);
+  static void grantFlow();
+};
+
+#endif
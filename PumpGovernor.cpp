@@ -0,0 +1,70 @@
+/**
+ * IIRR -- Intelligent Irrigator Based on ESP8266
+    Copyright (C) 2016--2018  Sergio Queiroz <srmq@cin.ufpe.br>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "PumpGovernor.h"
+
+void ZoneLevels::update(float surface, float middle, float critLevel, float satLevel, float band) {
+  surfaceDry.updateBelow(surface, critLevel, band);
+  middleDry.updateBelow(middle, critLevel, band);
+  surfaceSat.updateAbove(surface, satLevel, band);
+  middleSat.updateAbove(middle, satLevel, band);
+}
+
+PumpGovernor::PumpGovernor() : lastStart(0), totalStarts(0), onSince(0), offSince(0), lastHold(PUMP_HOLD_NONE) {
+  for (int i = 0; i < PUMP_START_HISTORY; i++) startTimes[i] = 0;
+}
+
+PumpHold PumpGovernor::startHold(time_t aTime, unsigned int minRestSecs, unsigned int maxStartsPerHour) {
+  if (offSince != 0 && aTime >= offSince && (unsigned long)(aTime - offSince) < minRestSecs) {
+    lastHold = PUMP_HOLD_MINREST;
+  } else if (maxStartsPerHour > 0 && startsLastHour(aTime) >= maxStartsPerHour) {
+    lastHold = PUMP_HOLD_STARTSHOUR;
+  } else {
+    lastHold = PUMP_HOLD_NONE;
+  }
+  return lastHold;
+}
+
+PumpHold PumpGovernor::stopHold(time_t aTime, unsigned int minRunSecs) {
+  const bool shortRun = onSince != 0 && aTime >= onSince && (unsigned long)(aTime - onSince) < minRunSecs;
+  lastHold = shortRun ? PUMP_HOLD_MINRUN : PUMP_HOLD_NONE;
+  return lastHold;
+}
+
+void PumpGovernor::started(time_t aTime) {
+  lastStart = (lastStart + 1) % PUMP_START_HISTORY;
+  startTimes[lastStart] = aTime;
+  totalStarts++;
+  onSince = aTime;
+}
+
+void PumpGovernor::stopped(time_t aTime) {
+  onSince = 0;
+  offSince = aTime;
+}
+
+//newest first, a start after aTime (the clock went back) ends the count
+unsigned int PumpGovernor::startsLastHour(time_t aTime) const {
+  unsigned int starts = 0;
+  for (int i = 0; i < PUMP_START_HISTORY; i++) {
+    const time_t startTime = startTimes[(lastStart + PUMP_START_HISTORY - i) % PUMP_START_HISTORY];
+    if (startTime == 0 || startTime > aTime || (aTime - startTime) >= (time_t)SECS_PER_HOUR) break;
+    starts++;
+  }
+  return starts;
+}
@@ -0,0 +1,102 @@
+/**
+ * IIRR -- Intelligent Irrigator Based on ESP8266
+    Copyright (C) 2016--2018  Sergio Queiroz <srmq@cin.ufpe.br>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef _PUMP_GOVERNOR_H_
+#define _PUMP_GOVERNOR_H_
+
+#include <Arduino.h>
+#include <TimeLib.h>
+#include "sensor_calibration.h"
+
+#define PUMP_START_HISTORY 16 //starts remembered, the most maxStartsPerHour can be
+
+//Schmitt trigger on one moisture reading. A latch on the low side is set
+//at or below level and released only at or above level + band, one on
+//the high side mirrors it, so a reading jittering around the level does
+//not flip it. With band 0 it is the plain comparison.
+class LevelLatch {
+public:
+  LevelLatch() : set(false) { }
+
+  inline bool updateBelow(float value, float level, float band) {
+    if (value <= level) set = true;
+    else if (value >= level + band) set = false;
+    return set;
+  }
+
+  inline bool updateAbove(float value, float level, float band) {
+    if (value >= level) set = true;
+    else if (value <= level - band) set = false;
+    return set;
+  }
+
+  inline bool isSet() const { return set; }
+
+private:
+  bool set;
+};
+
+//critLevel and satLevel of surface and middle of a zone, as latches
+class ZoneLevels {
+public:
+  LevelLatch surfaceDry;
+  LevelLatch middleDry;
+  LevelLatch surfaceSat;
+  LevelLatch middleSat;
+
+  void update(float surface, float middle, float critLevel, float satLevel, float band);
+  inline bool isDry() const { return surfaceDry.isSet() || middleDry.isSet(); }
+  inline bool isSaturated() const { return surfaceSat.isSet() || middleSat.isSet(); }
+};
+
+enum PumpHold {
+  PUMP_HOLD_NONE,
+  PUMP_HOLD_MINREST,    //stopped less than minRestSecs ago
+  PUMP_HOLD_STARTSHOUR, //maxStartsPerHour already in the last hour
+  PUMP_HOLD_MINRUN      //on for less than minRunSecs
+};
+
+//Output stage between the irrigation rules and the pump. A start the
+//rules decided waits for the minimum rest and the hourly start cap, a
+//stop waits for the minimum run, except the stops that protect the pump
+//or the budget, which the caller does not submit. The starts of the last
+//hour are kept for the cap and for the status page.
+class PumpGovernor {
+public:
+  PumpGovernor();
+
+  PumpHold startHold(time_t aTime, unsigned int minRestSecs, unsigned int maxStartsPerHour);
+  PumpHold stopHold(time_t aTime, unsigned int minRunSecs);
+  void started(time_t aTime);
+  void stopped(time_t aTime);
+
+  unsigned int startsLastHour(time_t aTime) const;
+  inline unsigned long getTotalStarts() const { return totalStarts; }
+  //the hold of the last start or stop submitted
+  inline PumpHold getLastHold() const { return lastHold; }
+
+private:
+  time_t startTimes[PUMP_START_HISTORY]; //ring, newest at lastStart
+  uint8_t lastStart;
+  unsigned long totalStarts;
+  time_t onSince;
+  time_t offSince;
+  PumpHold lastHold;
+};
+
+#endif
@@ -0,0 +1,96 @@
+/**
+ * IIRR -- Intelligent Irrigator Based on ESP8266
+    Copyright (C) 2016--2019  Sergio Queiroz <srmq@cin.ufpe.br>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef _SELECTION_KERNEL_H_
+#define _SELECTION_KERNEL_H_
+
+template<typename T>
+class ProbeStats {
+public:
+  T median;
+  T lowerQuartile;
+  T upperQuartile;
+
+  inline T iqr() const { return upperQuartile - lowerQuartile; }
+};
+
+//Median and quartiles of N samples by quickselect, in expected O(N)
+//time and without extra memory. The samples are partially reordered.
+template<typename T, int N>
+class SelectionKernel {
+public:
+  static_assert(N > 0, "SelectionKernel needs at least one sample");
+
+  static inline ProbeStats<T> quantiles(T values[N]) {
+    return quantiles(values, N);
+  }
+
+  //same for the first n samples, 0 < n <= N
+  static ProbeStats<T> quantiles(T values[], const int n) {
+    ProbeStats<T> result;
+    result.median = select(values, 0, n - 1, n/2);
+    //after selecting the median each half holds its own quartile
+    result.lowerQuartile = (n/2 > 0) ? select(values, 0, n/2 - 1, n/4) : result.median;
+    result.upperQuartile = (n/2 + 1 < n) ? select(values, n/2 + 1, n - 1, (3*n)/4) : result.median;
+    return result;
+  }
+
+  static inline T median(T values[N]) {
+    return select(values, 0, N - 1, N/2);
+  }
+
+  //puts the k-th smallest of values[first..last] at position k and returns it
+  static T select(T values[], int first, int last, const int k) {
+    while (first < last) {
+      const int mid = first + (last - first)/2;
+      //median of three as pivot, keeps sorted and reversed input linear
+      if (values[mid] < values[first]) swap(values[mid], values[first]);
+      if (values[last] < values[first]) swap(values[last], values[first]);
+      if (values[last] < values[mid]) swap(values[last], values[mid]);
+      const T pivot = values[mid];
+      int i = first;
+      int j = last;
+      while (i <= j) {
+        while (values[i] < pivot) i++;
+        while (pivot < values[j]) j--;
+        if (i <= j) {
+          swap(values[i], values[j]);
+          i++;
+          j--;
+        }
+      }
+      if (k <= j) {
+        last = j;
+      } else if (k >= i) {
+        first = i;
+      } else {
+        break;
+      }
+    }
+    return values[k];
+  }
+
+private:
+  static inline void swap(T& a, T& b) {
+    const T tmp = a;
+    a = b;
+    b = tmp;
+  }
+};
+
+#endif
@@ -0,0 +1,208 @@
+/**
+ * IIRR -- Intelligent Irrigator Based on ESP8266
+    Copyright (C) 2016--2018  Sergio Queiroz <srmq@cin.ufpe.br>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "SensorLog.h"
+#include <math.h>
+
+SensorLogRecord::SensorLogRecord(time_t aTime, float surface, float middle, float deep, bool irrigating) :
+    timeStamp(aTime),
+    surface(toHundredths(surface)),
+    middle(toHundredths(middle)),
+    deep(toHundredths(deep)),
+    irrigating(irrigating),
+    negZeros(0) {
+  const float values[3] = {surface, middle, deep};
+  const int16_t hundredths[3] = {this->surface, this->middle, this->deep};
+  for (uint8_t depth = 0; depth < 3; depth++) {
+    if (values[depth] < 0 && hundredths[depth] == 0) negZeros |= SENSORLOG_NEGZERO << depth;
+  }
+}
+
+//the digits of printFloat() of the ESP8266 core with 2 decimals: half a
+//hundredth is added and the digits are taken off one by one, in double,
+//which is not always value*100 rounded
+int16_t SensorLogRecord::toHundredths(float value) {
+  if (isnan(value)) return SENSORLOG_NAN;
+  const bool negative = value < 0;
+  double number = (negative ? -(double)value : (double)value) + 1.0/200;
+  if (number >= (SENSORLOG_MAX_HUNDREDTHS + 1)/100.0) return negative ? -SENSORLOG_MAX_HUNDREDTHS : SENSORLOG_MAX_HUNDREDTHS;
+  double tenpow = 1.0;
+  int digitCount = 1;
+  while (number >= 10.0*tenpow) {
+    tenpow *= 10.0;
+    digitCount++;
+  }
+  number /= tenpow;
+  long hundredths = 0;
+  for (int n = digitCount + 2; n > 0; n--) {
+    int digit = (int)number;
+    if (digit > 9) digit = 9;
+    hundredths = hundredths*10 + digit;
+    number -= digit;
+    number *= 10.0;
+  }
+  if (hundredths > SENSORLOG_MAX_HUNDREDTHS) hundredths = SENSORLOG_MAX_HUNDREDTHS;
+  return negative ? -(int16_t)hundredths : (int16_t)hundredths;
+}
+
+static inline void putInt16(uint8_t *out, int16_t value) {
+  out[0] = (uint16_t)value & 0xFF;
+  out[1] = (uint16_t)value >> 8;
+}
+
+static inline int16_t getInt16(const uint8_t *in) {
+  return (int16_t)(in[0] | (in[1] << 8));
+}
+
+void SensorLogRecord::encode(uint8_t out[SENSORLOG_RECORD_SIZE], time_t baseTime) const {
+  const uint32_t secs = timeStamp - baseTime;
+  putInt16(out, secs & 0xFFFF);
+  putInt16(out + 2, surface);
+  putInt16(out + 4, middle);
+  putInt16(out + 6, deep);
+  out[8] = (irrigating ? SENSORLOG_IRRIGATING : 0) | negZeros | ((secs & 0x10000) ? SENSORLOG_SECS_BIT16 : 0);
+}
+
+void SensorLogRecord::decode(const uint8_t in[SENSORLOG_RECORD_SIZE], time_t baseTime) {
+  const uint32_t secs = (uint16_t)getInt16(in) | ((in[8] & SENSORLOG_SECS_BIT16) ? 0x10000 : 0);
+  timeStamp = baseTime + secs;
+  surface = getInt16(in + 2);
+  middle = getInt16(in + 4);
+  deep = getInt16(in + 6);
+  irrigating = (in[8] & SENSORLOG_IRRIGATING) != 0;
+  negZeros = in[8] & (7*SENSORLOG_NEGZERO);
+}
+
+static const char SENSORLOG_CSV_TS[] PROGMEM = "%04d%02d%02dT%02d%02d%02d";
+
+static size_t printHundredths(char *out, size_t size, int16_t value, bool negZero) {
+  if (value == SENSORLOG_NAN) return snprintf_P(out, size, PSTR(",nan"));
+  const unsigned int magnitude = (value < 0) ? -(int)value : value;
+  return snprintf_P(out, size, PSTR(",%s%u.%02u"), (value < 0 || negZero) ? "-" : "", magnitude/100, magnitude%100);
+}
+
+size_t SensorLogRecord::toCSV(char out[SENSORLOG_LINE_SIZE]) const {
+  tmElements_t tm;
+  breakTime(timeStamp, tm);
+  size_t len = snprintf_P(out, SENSORLOG_LINE_SIZE, SENSORLOG_CSV_TS, tm.Year + 1970, tm.Month, tm.Day, tm.Hour, tm.Minute, tm.Second);
+  len += printHundredths(out + len, SENSORLOG_LINE_SIZE - len, surface, negZeros & SENSORLOG_NEGZERO);
+  len += printHundredths(out + len, SENSORLOG_LINE_SIZE - len, middle, negZeros & (SENSORLOG_NEGZERO << 1));
+  len += printHundredths(out + len, SENSORLOG_LINE_SIZE - len, deep, negZeros & (SENSORLOG_NEGZERO << 2));
+  len += snprintf_P(out + len, SENSORLOG_LINE_SIZE - len, PSTR(",%c\r\n"), irrigating ? '1' : '0');
+  return len;
+}
+
+void SensorLogRecord::encodeHeader(uint8_t out[SENSORLOG_HEADER_SIZE], time_t baseTime) {
+  memcpy(out, SENSORLOG_MAGIC, 4);
+  const uint32_t base = baseTime;
+  for (int i = 0; i < 4; i++) out[4 + i] = (base >> (8*i)) & 0xFF;
+}
+
+bool SensorLogRecord::decodeHeader(const uint8_t in[SENSORLOG_HEADER_SIZE], time_t& baseTime) {
+  if (memcmp(in, SENSORLOG_MAGIC, 4) != 0) return false;
+  uint32_t base = 0;
+  for (int i = 0; i < 4; i++) base |= (uint32_t)in[4 + i] << (8*i);
+  baseTime = base;
+  return true;
+}
+
+SensorLogStream::SensorLogStream(File file) : file(file), binary(false), baseTime(0), lineLen(0), linePos(0) {
+  uint8_t header[SENSORLOG_HEADER_SIZE];
+  if (this->file.read(header, SENSORLOG_HEADER_SIZE) == SENSORLOG_HEADER_SIZE) {
+    binary = SensorLogRecord::decodeHeader(header, baseTime);
+  }
+  if (!binary) this->file.seek(0, SeekSet);
+}
+
+bool SensorLogStream::nextLine() {
+  uint8_t bytes[SENSORLOG_RECORD_SIZE];
+  lineLen = linePos = 0;
+  if (!atRecord()) return false;
+  if (file.read(bytes, SENSORLOG_RECORD_SIZE) != SENSORLOG_RECORD_SIZE) return false;
+  SensorLogRecord record;
+  record.decode(bytes, baseTime);
+  lineLen = record.toCSV(line);
+  return true;
+}
+
+//a seek off the start of a record would render garbage, it ends the text instead
+bool SensorLogStream::atRecord() const {
+  return (file.position() - SENSORLOG_HEADER_SIZE) % SENSORLOG_RECORD_SIZE == 0;
+}
+
+int SensorLogStream::available() {
+  if (!binary) return file.available();
+  if (linePos < lineLen) return (lineLen - linePos) + file.available();
+  //only whole records are rendered
+  return (atRecord() && file.available() >= SENSORLOG_RECORD_SIZE) ? file.available() : 0;
+}
+
+int SensorLogStream::read() {
+  if (!binary) return file.read();
+  if (linePos == lineLen && !nextLine()) return -1;
+  return line[linePos++];
+}
+
+int SensorLogStream::peek() {
+  if (!binary) return file.peek();
+  if (linePos == lineLen && !nextLine()) return -1;
+  return line[linePos];
+}
+
+size_t SensorLogStream::readBytes(char *buffer, size_t length) {
+  if (!binary) return file.readBytes(buffer, length);
+  size_t count = 0;
+  while (count < length) {
+    if (linePos == lineLen && !nextLine()) break;
+    const size_t chunk = min((size_t)(lineLen - linePos), length - count);
+    memcpy(buffer + count, line + linePos, chunk);
+    linePos += chunk;
+    count += chunk;
+  }
+  return count;
+}
+
+size_t SensorLogStream::position() const {
+  if (!binary) return file.position();
+  //inside a line it is the record of that line
+  return file.position() - ((linePos < lineLen) ? SENSORLOG_RECORD_SIZE : 0);
+}
+
+bool SensorLogStream::seek(size_t pos) {
+  lineLen = linePos = 0;
+  //offset 0 is the first record of a binary log too
+  if (binary && pos < SENSORLOG_HEADER_SIZE) pos = SENSORLOG_HEADER_SIZE;
+  return file.seek(pos, SeekSet);
+}
+
+size_t SensorLogStream::csvSize() {
+  if (!binary) return file.size();
+  const size_t filePos = file.position();
+  const uint8_t savedLen = lineLen;
+  const uint8_t savedPos = linePos;
+  char savedLine[SENSORLOG_LINE_SIZE];
+  memcpy(savedLine, line, savedLen);
+  file.seek(SENSORLOG_HEADER_SIZE, SeekSet);
+  size_t size = 0;
+  while (nextLine()) size += lineLen;
+  file.seek(filePos, SeekSet);
+  memcpy(line, savedLine, savedLen);
+  lineLen = savedLen;
+  linePos = savedPos;
+  return size;
+}
@@ -0,0 +1,109 @@
+/**
+ * IIRR -- Intelligent Irrigator Based on ESP8266
+    Copyright (C) 2016--2018  Sergio Queiroz <srmq@cin.ufpe.br>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef _SENSOR_LOG_H_
+#define _SENSOR_LOG_H_
+
+#include <Arduino.h>
+#include "FS.h"
+#include <TimeLib.h>
+
+//Binary sensor log: an 8 byte header with SENSORLOG_MAGIC and the time of
+//the midnight that starts the file, then 9 byte records, little endian:
+//  seconds since the header time, low 16 bits
+//  surface, middle, deep, int16 hundredths (SENSORLOG_NAN when not a number)
+//  flags: SENSORLOG_IRRIGATING, SENSORLOG_NEGZERO << depth, SENSORLOG_SECS_BIT16
+//A record is about a quarter of its CSV line, and it decodes by itself,
+//so a reader can seek to any record.
+//The CSV of a record is byte for byte the line Print wrote for the text
+//log, -0.00 included, except for a value of 327.675 or more either way,
+//infinity too: it is stored, and printed, as +-327.67. Moistures are
+//fractions of saturation and a read error is MOISTURE_READERROR, only a
+//broken probe gets there.
+#define SENSORLOG_MAGIC "SLB\x01"
+#define SENSORLOG_HEADER_SIZE 8
+#define SENSORLOG_RECORD_SIZE 9
+#define SENSORLOG_LINE_SIZE 48
+#define SENSORLOG_NAN INT16_MIN
+#define SENSORLOG_IRRIGATING 0x01
+#define SENSORLOG_NEGZERO 0x02 //of surface, shifted by the depth: a negative that prints as -0.00
+#define SENSORLOG_MAX_HUNDREDTHS INT16_MAX
+#define SENSORLOG_SECS_BIT16 0x80
+
+class SensorLogRecord {
+public:
+  time_t timeStamp;
+  int16_t surface; //hundredths
+  int16_t middle;
+  int16_t deep;
+  bool irrigating;
+  uint8_t negZeros; //SENSORLOG_NEGZERO bits
+
+  SensorLogRecord() : timeStamp(0), surface(0), middle(0), deep(0), irrigating(false), negZeros(0) { }
+  SensorLogRecord(time_t aTime, float surface, float middle, float deep, bool irrigating);
+
+  void encode(uint8_t out[SENSORLOG_RECORD_SIZE], time_t baseTime) const;
+  void decode(const uint8_t in[SENSORLOG_RECORD_SIZE], time_t baseTime);
+  //the line of the text log, as File::print() wrote it, with its line end. Returns its length
+  size_t toCSV(char out[SENSORLOG_LINE_SIZE]) const;
+
+  static void encodeHeader(uint8_t out[SENSORLOG_HEADER_SIZE], time_t baseTime);
+  //false when in is not the header of a binary sensor log
+  static bool decodeHeader(const uint8_t in[SENSORLOG_HEADER_SIZE], time_t& baseTime);
+  static inline time_t baseTimeOf(time_t aTime) { return aTime - elapsedSecsToday(aTime); }
+  //value as Print prints it with 2 decimals, saturated to +-SENSORLOG_MAX_HUNDREDTHS
+  static int16_t toHundredths(float value);
+};
+
+//Reads a sensor log as the CSV text it always was: a binary log is
+//rendered a line at a time, a text log from before is passed through.
+//position() and seek() are offsets in the file, of the next line when
+//called between lines, which is how the cloud upload uses them.
+class SensorLogStream : public Stream {
+public:
+  explicit SensorLogStream(File file);
+
+  inline bool isBinary() const { return binary; }
+  virtual int available() override;
+  virtual int read() override;
+  virtual int peek() override;
+  virtual size_t readBytes(char *buffer, size_t length) override;
+  virtual size_t write(uint8_t) override { return 0; }
+  using Print::write;
+
+  size_t position() const;
+  bool seek(size_t pos);
+  //length of the whole CSV text, each record is rendered once for it
+  size_t csvSize();
+  inline const char* name() const { return file.name(); }
+  inline void close() { file.close(); }
+
+private:
+  File file;
+  bool binary;
+  time_t baseTime;
+  char line[SENSORLOG_LINE_SIZE];
+  uint8_t lineLen;
+  uint8_t linePos;
+
+  //renders the next record, false at the end of the file
+  bool nextLine();
+  bool atRecord() const;
+};
+
+#endif
@@ -25,36 +25,47 @@
 #include <ArduinoJson.h>
 #include "TimeKeeper.h"
 #include "WaterController.h"
+#include "Hal.h"
+#include "SelectionKernel.h"
+#include "MoistureCurve.h"
+#include "WeekMinuteMap.h"
+#include "CalibParams.h"
+#include "MuxAddress.h"
+#include "MuxArbiter.h"
+#include "DryingRate.h"
+#include "SensorLog.h"
+#include "LogRetention.h"
+#include "CloudTask.h"
 
 SensorDirection currSensorDirection;
-long resistances[NUM_PROBES];
+long moistureSamples[3][MAX_PROBES];
+long moistureIQRs[3];
 SoilMoisture moistures;
+ZoneMoistures zoneMoistures;
 ConfParams mainConfParams;
+CalibParams mainCalibParams;
 IrrigData irrigData;
+static MoistureCurve moistureCurves[NUM_SENSOR_INPUTS];
+static WeekMinuteMap noIrrigMinutes;
 static bool requestLearn;
 static AsyncLearnFlowStatus learnFlowStatus;
+static const FlowLearner *flowLearner = NULL;
+static IrrigTrace irrigTrace;
+static DryingRate surfaceDrying[MAX_ZONES];
+static DryingRate middleDrying[MAX_ZONES];
+static unsigned long zoneSlotSeconds;
+static ZoneLevels zoneLevels[MAX_ZONES];
+static PumpGovernor pumpGovernor;
+static LogRetention logRetention(CloudTask::isAcknowledged);
+static uint8_t uncatalogedLogged = 0; //LogCatalog::dropped() last logged
 
-static const char UNINPLEMENTED_CALL[] PROGMEM = "WARNING: Unimplemented call at ";
 static const char PARAMS_JSON_FILE[] PROGMEM = "/conf/params.json";
+static const char CALIB_JSON_FILE[] PROGMEM = "/conf/calib.json";
 
 static const char TS_FMT_HHMM[] PROGMEM = "%02d%02d";
 
 static time_t lastLogWrite = 0;
 
-void sortResistances() {
-  long tmp;
-  int i,j;
-  for(i = 0; i < NUM_PROBES-1; i++) {
-    for(j = i + 1; j < NUM_PROBES; j++) {
-      if ( resistances[j] < resistances[i] ) {
-        tmp = resistances[i];
-        resistances[i] = resistances[j];
-        resistances[j] = tmp;
-      }
-    }
-  }
-}
-
 static const char LOGF_NAME_PREFIX[] PROGMEM = "/logs/sensor"; 
 static const char MSGF_NAME_PREFIX[] PROGMEM = "/logs/msg";
 static const char YMD_DATE_FMT[] PROGMEM = "%04d%02d%02d";
@@ -87,20 +98,6 @@ bool SensorTask::getMsgfileDMY(const String& msgStr, int& day, int& month, int&y
 }
 
 
-time_t SensorTask::toConfTimet(time_t aTime_t) {
-  char timeStr[5];
-  timeStr[4] = '\0';
-
-  if (aTime_t > 0) {
-    snprintf_P(timeStr, 5, TS_FMT_HHMM, TimeKeeper::tkHour(aTime_t), TimeKeeper::tkMinute(aTime_t));    
-  } else {
-    return 0;
-  }
-
-  return confParamTime2Timet(timeStr);
-  
-}
-
 bool SensorTask::fulfillMinIrrigInterval(time_t aTime) {
   bool result = true;
   if (irrigData.lastIrrigEnd != 0) {
@@ -136,126 +133,303 @@ unsigned int SensorTask::irrigTodayRemainingSecs() {
   return remainSeconds;
 }
 
-bool SensorTask::isInHHMMConfInterval(time_t aTimeInConfTimet, time_t initHHMM, time_t endHHMM) {
-  if (!mainConfParams.isEmptyInterval(initHHMM, endHHMM) 
-      && mainConfParams.isValidOrEmptyInterval(initHHMM, endHHMM)) {
-        
-    if(aTimeInConfTimet >= initHHMM && aTimeInConfTimet <= endHHMM)
-      return true;
+float SensorTask::irrigTodayRemainingLiters() {
+  const time_t nowTime = TimeKeeper::tkNow();
+  float usedLiters = irrigData.litersOnDate(nowTime);
+  if (irrigData.isIrrigating) usedLiters += irrigData.irrigLiters;
+  return (usedLiters >= mainConfParams.irrMaxLitersDay) ? 0 : mainConfParams.irrMaxLitersDay - usedLiters;
+}
+
+//the daily budget in liters when there is one, else in seconds. At least
+//slotFraction of an irrigation slot must remain, in liters that is the
+//volume of a slot at the normal flow
+bool SensorTask::hasIrrigTodayBudget(float slotFraction) {
+  if (mainConfParams.hasVolumeBudget()) {
+    const float slotLiters = mainConfParams.irrSlotSeconds*mainConfParams.normalPulsesPerSec/mainConfParams.pulsesPerLiter;
+    const float remainLiters = irrigTodayRemainingLiters();
+    return (slotFraction > 0) ? (remainLiters >= slotFraction*slotLiters) : (remainLiters > 0);
+  }
+  const unsigned int remainSecs = irrigTodayRemainingSecs();
+  return (slotFraction > 0) ? (remainSecs >= slotFraction*mainConfParams.irrSlotSeconds) : (remainSecs > 0);
+}
+
+//volume for the moisture deficit of surface and middle, within the daily budget
+float SensorTask::doseLiters(uint8_t zone) {
+  const float surface = zoneMoistures.surface[zone];
+  const float middle = zoneMoistures.middle[zone];
+  const float driest = (surface < middle) ? surface : middle;
+  const float deficit = mainConfParams.satLevel - driest;
+  float liters = (deficit > 0) ? deficit*mainConfParams.doseLitersPerLevel : 0;
+  if (mainConfParams.hasVolumeBudget()) {
+    const float remainLiters = irrigTodayRemainingLiters();
+    if (liters > remainLiters) liters = remainLiters;
   }
+  return liters;
+}
 
-  return false; 
+//by the drying rates, seconds until surface or middle reach critLevel, -1 when neither does within maxSecs
+long SensorTask::secsToCritLevel(uint8_t zone, long maxSecs) {
+  const long surfaceSecs = surfaceDrying[zone].secsToLevel(mainConfParams.critLevel, maxSecs);
+  const long middleSecs = middleDrying[zone].secsToLevel(mainConfParams.critLevel, maxSecs);
+  if (surfaceSecs < 0) return middleSecs;
+  if (middleSecs < 0) return surfaceSecs;
+  return (surfaceSecs < middleSecs) ? surfaceSecs : middleSecs;
 }
 
-bool SensorTask::isInNoIrrigTime(time_t aTime) {
-  time_t timeInConfTimet = SensorTask::toConfTimet(aTime);
+//a zone reaching critLevel within the horizon is due when its last allowed
+//start before that is near: water then, not in a no irrigation window
+bool SensorTask::zoneDueSoon(uint8_t zone, time_t aTime) {
+  if (mainConfParams.predictHorizonMins == 0) return false;
+  const long critSecs = secsToCritLevel(zone, (long)mainConfParams.predictHorizonMins*SECS_PER_MIN);
+  if (critSecs < 0) return false;
+  const time_t latestStart = lastIrrigAllowedTime(aTime + critSecs);
+  return latestStart != 0 && latestStart <= aTime + (time_t)mainConfParams.predictLeadMins*SECS_PER_MIN;
+}
 
-  return isInHHMMConfInterval(timeInConfTimet, mainConfParams.noIrrTime0Init, mainConfParams.noIrrTime0End)
-      || isInHHMMConfInterval(timeInConfTimet, mainConfParams.noIrrTime1Init, mainConfParams.noIrrTime1End)
-      || isInHHMMConfInterval(timeInConfTimet, mainConfParams.noIrrTime2Init, mainConfParams.noIrrTime2End)
-      || isInHHMMConfInterval(timeInConfTimet, mainConfParams.noIrrTime3Init, mainConfParams.noIrrTime3End);
+//moisture rule of a zone, on its own level latches only: dry now, or soon by its forecast
+bool SensorTask::zoneNeedsWater(uint8_t zone, time_t aTime) {
+  const ZoneLevels& levels = zoneLevels[zone];
+  if (levels.isSaturated()) return false;
+  return levels.isDry() || zoneDueSoon(zone, aTime);
 }
 
-//timeStr is HHMM
-//output time_t is this time at Jan 1st 2017 (0 secs)
-time_t SensorTask::confParamTime2Timet(const char* timeStr) {
-  time_t result = 0;
-  if ( (strlen(timeStr) != 4)) return 0;
-  if ( timeStr[0] < '0' || timeStr[0] > '2') return 0;
-  if ( timeStr[0] == '2') {
-    if (timeStr[1] < '0' || timeStr[1] > '3') return 0;
+//predicates of the irrigation rules on the state of one sensor cycle
+class SensorRuleEvaluator : public PredicateEvaluator {
+public:
+  SensorRuleEvaluator(SensorTask& task, time_t nowTime) : task(task), nowTime(nowTime), waterStatusRead(false), waterStatus(WATER_CURRSTOP) { }
+  virtual bool evaluate(IrrigPredicate pred) override;
+
+private:
+  SensorTask& task;
+  const time_t nowTime;
+  bool waterStatusRead;
+  WaterCurrSensorStatus waterStatus;
+
+  //one read for both water predicates
+  inline WaterCurrSensorStatus currWaterStatus() {
+    if (!waterStatusRead) {
+      waterStatus = task.waterControl.currStatus();
+      waterStatusRead = true;
+    }
+    return waterStatus;
+  }
+};
+
+bool SensorRuleEvaluator::evaluate(IrrigPredicate pred) {
+  const uint8_t zone = (task.zoneScheduler.getCurrZone() != NO_ZONE) ? task.zoneScheduler.getCurrZone() : 0;
+  const ZoneLevels& levels = zoneLevels[zone];
+  const float deep = zoneMoistures.deep[zone];
+  switch (pred) {
+    case PRED_VALIDTIME:
+      return nowTime > MIN_IRRIG_TS;
+    case PRED_ALLOWEDTIME:
+      return !(TimeKeeper::isValidTS(nowTime) && SensorTask::isInNoIrrigTime(nowTime));
+    case PRED_BUDGET:
+      return SensorTask::hasIrrigTodayBudget(mainConfParams.budgetSlotFraction);
+    case PRED_INTERVAL:
+      return task.fulfillMinIrrigInterval(nowTime);
+    case PRED_WATEROK:
+      return currWaterStatus() != WATER_CURREMPTY;
+    case PRED_FLOWCONF:
+      return currWaterStatus() != WATER_CURRNOCONF;
+    case PRED_NOTLEARNING:
+      return learnFlowStatus != LFLOW_INPROGRESS;
+    case PRED_ZONEDRY:
+      return task.zoneScheduler.hasPending();
+    case PRED_DOSE:
+      return task.waterControl.isDoseReached();
+    case PRED_SLOTEND:
+      return (unsigned long)(nowTime - task.zoneScheduler.getZoneSince()) > zoneSlotSeconds;
+    case PRED_SURFACESAT:
+      return levels.surfaceSat.isSet();
+    case PRED_MIDDLESAT:
+      return levels.middleSat.isSet();
+    case PRED_DEEPINCREASE:
+      return (deep > irrigData.deepAtStartIrrig)
+          && (deep > (irrigData.deepAtStartIrrig + mainConfParams.deepIncreaseFraction*(mainConfParams.satLevel - irrigData.deepAtStartIrrig)))
+          && !levels.isDry();
+    case PRED_BUDGETOUT:
+      return !SensorTask::hasIrrigTodayBudget(0);
+    default:
+      return false;
   }
-  if (timeStr[1] < '0' || timeStr[1] > '9') return 0;
-  if (timeStr[2] > '5' || timeStr[2] < '0') return 0;
-  if (timeStr[3] < '0' || timeStr[3] > '9') return 0;
-
-  tmElements_t timeElements;
-  timeElements.Second = 0;
-  char buf[3];
-  buf[2] = '\0';
-  strncpy(buf, timeStr, 2);
-  timeElements.Hour = strtol(buf, NULL, 10);
-
-  strncpy(buf, timeStr+2, 2);
-  timeElements.Minute = strtol(buf, NULL, 10);
-
-  timeElements.Wday = 0;
-  timeElements.Year = 2017 - 1970;
-  timeElements.Month = 1;
-  timeElements.Day = 1;
-
-    // tm.Second  Seconds   0 to 59
-    // tm.Minute  Minutes   0 to 59
-    // tm.Hour    Hours     0 to 23
-    // tm.Wday    Week Day  0 to 6  (not needed for mktime)
-    // tm.Day     Day       1 to 31
-    // tm.Month   Month     1 to 12
-    // tm.Year    Year      0 to 99 (offset from 1970)    
-  result = TimeKeeper::tkMakeTime(timeElements);    
-  return result;
 }
 
-JsonObject& SensorTask::createJsonFromConfParams(DynamicJsonBuffer& jsonBuffer) {
-  JsonObject& root = jsonBuffer.createObject();
-
-  JsonArray& noirrtimes = root.createNestedArray("noirrtimes");
-  char strBuf[5];
-  strBuf[4] = '\0';
+static StopIrrigReason stopReasonOf(IrrigPredicate pred) {
+  switch (pred) {
+    case PRED_DOSE:
+      return STOPIRRIG_DOSEREACHED;
+    case PRED_SURFACESAT:
+      return STOPIRRIG_SURFACESAT;
+    case PRED_MIDDLESAT:
+      return STOPIRRIG_MIDDLESAT;
+    case PRED_DEEPINCREASE:
+      return STOPIRRIG_DEEPINCREASE;
+    case PRED_BUDGETOUT:
+      return mainConfParams.hasVolumeBudget() ? STOPIRRIG_MAXVOLUMEDAY : STOPIRRIG_MAXTIMEDAY;
+    default:
+      return STOPIRRIG_SLOTEND;
+  }
+}
 
-  if (mainConfParams.noIrrTime0Init == 0) {
-    noirrtimes.add(String('0'));
-  } else {
-    snprintf_P(strBuf, 5, TS_FMT_HHMM, TimeKeeper::tkHour(mainConfParams.noIrrTime0Init), TimeKeeper::tkMinute(mainConfParams.noIrrTime0Init));
-    noirrtimes.add(String(strBuf));
+static void printIrrigTrace(const IrrigTrace& trace) {
+  for (int i = 0; i < NUM_PREDICATES; i++) {
+    const IrrigPredicate pred = IrrigPredicate(i);
+    if (!trace.wasEvaluated(pred)) continue;
+    Serial.print(trace.valueOf(pred) ? F("OK ") : F("ERR "));
+    Serial.println(FPSTR(IrrigProgram::predicateName(pred)));
+  }
+  if (trace.decisive != PRED_NONE) {
+    Serial.print((trace.kind == RULES_START) ? F("Irrigation blocked by ") : F("Zone ended by "));
+    Serial.println(FPSTR(IrrigProgram::predicateName(trace.decisive)));
   }
+}
 
-  if (mainConfParams.noIrrTime0End == 0) {
-    noirrtimes.add(String('0'));
-  } else {
-    snprintf_P(strBuf, 5, TS_FMT_HHMM, TimeKeeper::tkHour(mainConfParams.noIrrTime0End), TimeKeeper::tkMinute(mainConfParams.noIrrTime0End));
-    noirrtimes.add(String(strBuf));
+const IrrigTrace& SensorTask::getLastIrrigTrace() {
+  return irrigTrace;
+}
+
+const PumpGovernor& SensorTask::getPumpGovernor() {
+  return pumpGovernor;
+}
+
+const LogRetention& SensorTask::getLogRetention() {
+  return logRetention;
+}
+
+//stops that protect the pump or the budget, or that the pump already made, are never held
+static bool isForcedStop(StopIrrigReason reason) {
+  return reason == STOPIRRIG_WATEREMPTY || reason == STOPIRRIG_DOSEREACHED
+      || reason == STOPIRRIG_MAXTIMEDAY || reason == STOPIRRIG_MAXVOLUMEDAY;
+}
+
+static void printPumpHold(PumpHold hold) {
+  switch (hold) {
+    case PUMP_HOLD_MINREST:
+      Serial.println(F("Pump start held, minimum rest"));
+      break;
+    case PUMP_HOLD_STARTSHOUR:
+      Serial.println(F("Pump start held, starts per hour"));
+      break;
+    case PUMP_HOLD_MINRUN:
+      Serial.println(F("Pump stop held, minimum run"));
+      break;
+    default:
+      break;
   }
+}
 
-  if (mainConfParams.noIrrTime1Init == 0) {
-    noirrtimes.add(String('0'));
+//the pump goes on to the next queued zone while the daily budget allows,
+//else it stops, after its minimum run unless the stop is forced
+void SensorTask::endZoneIrrigation(time_t aTime, StopIrrigReason reason) {
+  const int nextZone = hasIrrigTodayBudget(mainConfParams.budgetSlotFraction) ? takeNextDryZone() : NO_ZONE;
+  if (nextZone != NO_ZONE) {
+    switchZoneAndLog(aTime, nextZone, reason);
+  } else if (isForcedStop(reason) || pumpGovernor.stopHold(aTime, mainConfParams.minRunSecs) == PUMP_HOLD_NONE) {
+    stopIrrigationAndLog(aTime, reason);
   } else {
-    snprintf_P(strBuf, 5, TS_FMT_HHMM, TimeKeeper::tkHour(mainConfParams.noIrrTime1Init), TimeKeeper::tkMinute(mainConfParams.noIrrTime1Init));
-    noirrtimes.add(String(strBuf));
+    printPumpHold(pumpGovernor.getLastHold());
   }
+}
 
-  if (mainConfParams.noIrrTime1End == 0) {
-    noirrtimes.add(String('0'));    
-  } else {
-    snprintf_P(strBuf, 5, TS_FMT_HHMM, TimeKeeper::tkHour(mainConfParams.noIrrTime1End), TimeKeeper::tkMinute(mainConfParams.noIrrTime1End));
-    noirrtimes.add(String(strBuf));
+//next queued zone that still needs water
+int SensorTask::takeNextDryZone() {
+  int zone;
+  do {
+    zone = zoneScheduler.takeNext();
+  } while (zone != NO_ZONE && !zoneNeedsWater(zone, TimeKeeper::tkNow()));
+  return zone;
+}
+
+//every window on each of its weekdays, a window past midnight goes on in
+//the next day and the one of Saturday in Sunday
+void SensorTask::compileNoIrrigTimes() {
+  noIrrigMinutes.clear();
+  for (int i = 0; i < mainConfParams.numNoIrrWindows; i++) {
+    const NoIrrigWindow& window = mainConfParams.noIrrWindows[i];
+    const uint16_t length = (window.crossesMidnight() ? MINUTES_PER_DAY : 0) + window.endMinute - window.initMinute;
+    for (int wday = 0; wday < DAYS_PER_WEEK; wday++) {
+      if (window.weekdays & (1 << wday)) {
+        const uint16_t first = wday*MINUTES_PER_DAY + window.initMinute;
+        noIrrigMinutes.setRange(first, first + length);
+      }
+    }
   }
+}
 
-  if (mainConfParams.noIrrTime2Init == 0) {
-    noirrtimes.add(String('0'));    
-  } else {
-    snprintf_P(strBuf, 5, TS_FMT_HHMM, TimeKeeper::tkHour(mainConfParams.noIrrTime2Init), TimeKeeper::tkMinute(mainConfParams.noIrrTime2Init));
-    noirrtimes.add(String(strBuf));
+bool SensorTask::isInNoIrrigTime(time_t aTime) {
+  return (aTime > 0) && noIrrigMinutes.test(WeekMinuteMap::minuteOfWeek(aTime));
+}
+
+time_t SensorTask::nextIrrigAllowedTime(time_t aTime) {
+  if (!isInNoIrrigTime(aTime)) return aTime;
+  const uint16_t nowMinute = WeekMinuteMap::minuteOfWeek(aTime);
+  const uint16_t allowedMinute = noIrrigMinutes.nextClear(nowMinute);
+  if (allowedMinute == WEEK_MINUTE_NONE) return 0;
+  const time_t waitMinutes = (allowedMinute + MINUTES_PER_WEEK - nowMinute) % MINUTES_PER_WEEK;
+  return aTime - elapsedSecsToday(aTime) % SECS_PER_MIN + waitMinutes*SECS_PER_MIN;
+}
+
+time_t SensorTask::lastIrrigAllowedTime(time_t aTime) {
+  if (!isInNoIrrigTime(aTime)) return aTime;
+  const uint16_t nowMinute = WeekMinuteMap::minuteOfWeek(aTime);
+  const uint16_t allowedMinute = noIrrigMinutes.prevClear(nowMinute);
+  if (allowedMinute == WEEK_MINUTE_NONE) return 0;
+  const time_t backMinutes = (nowMinute + MINUTES_PER_WEEK - allowedMinute) % MINUTES_PER_WEEK;
+  return aTime - elapsedSecsToday(aTime) % SECS_PER_MIN - backMinutes*SECS_PER_MIN;
+}
+
+static bool isEmptyConfTime(const char* timeStr) {
+  return timeStr != NULL && strcmp(timeStr, "0") == 0;
+}
+
+//timeStr is HHMM, the result is the minute of the day or -1
+int SensorTask::confParamMinute(const char* timeStr) {
+  if (timeStr == NULL || (strlen(timeStr) != 4)) return -1;
+  if ( timeStr[0] < '0' || timeStr[0] > '2') return -1;
+  if ( timeStr[0] == '2') {
+    if (timeStr[1] < '0' || timeStr[1] > '3') return -1;
   }
+  if (timeStr[1] < '0' || timeStr[1] > '9') return -1;
+  if (timeStr[2] > '5' || timeStr[2] < '0') return -1;
+  if (timeStr[3] < '0' || timeStr[3] > '9') return -1;
 
-  if (mainConfParams.noIrrTime2End == 0) {
-    noirrtimes.add(String('0'));    
-  } else {
-    snprintf_P(strBuf, 5, TS_FMT_HHMM, TimeKeeper::tkHour(mainConfParams.noIrrTime2End), TimeKeeper::tkMinute(mainConfParams.noIrrTime2End));
-    noirrtimes.add(String(strBuf));
+  const int hours = (timeStr[0] - '0')*10 + (timeStr[1] - '0');
+  const int minutes = (timeStr[2] - '0')*10 + (timeStr[3] - '0');
+  return hours*60 + minutes;
+}
+
+static void addRuleNames(JsonArray& names, const IrrigProgram& program) {
+  for (uint8_t i = 0; i < program.size(); i++) {
+    names.add(String(FPSTR(IrrigProgram::predicateName(program.op(i)))));
   }
+}
 
-  if (mainConfParams.noIrrTime3Init == 0) {
-    noirrtimes.add(String('0'));    
-  } else {
-    snprintf_P(strBuf, 5, TS_FMT_HHMM, TimeKeeper::tkHour(mainConfParams.noIrrTime3Init), TimeKeeper::tkMinute(mainConfParams.noIrrTime3Init));
-    noirrtimes.add(String(strBuf));
+//the rules are compiled here, a program without the key is left as it was
+static void readRuleNames(JsonObject& root, const char* key, IrrigProgram& program) {
+  if (!root.containsKey(key)) return;
+  JsonArray& names = root[key];
+  program.clear();
+  for (size_t i = 0; i < names.size(); i++) {
+    program.add(names[i].as<const char*>());
   }
+  program.addInterlocks();
+}
 
-  if (mainConfParams.noIrrTime3End == 0) {
-    noirrtimes.add(String('0'));    
-  } else {
-    snprintf_P(strBuf, 5, TS_FMT_HHMM, TimeKeeper::tkHour(mainConfParams.noIrrTime3End), TimeKeeper::tkMinute(mainConfParams.noIrrTime3End));
+JsonObject& SensorTask::createJsonFromConfParams(DynamicJsonBuffer& jsonBuffer) {
+  JsonObject& root = jsonBuffer.createObject();
+
+  //an init and end HHMM pair for each window, and its weekdays
+  JsonArray& noirrtimes = root.createNestedArray("noirrtimes");
+  JsonArray& noirrdays = root.createNestedArray("noirrdays");
+  char strBuf[7]; //HHMM, and room for any uint8_t hour, which the compiler can check
+  for (int i = 0; i < mainConfParams.numNoIrrWindows; i++) {
+    const NoIrrigWindow& window = mainConfParams.noIrrWindows[i];
+    snprintf_P(strBuf, sizeof(strBuf), TS_FMT_HHMM, (uint8_t)(window.initMinute/60), (uint8_t)(window.initMinute%60));
     noirrtimes.add(String(strBuf));
+    snprintf_P(strBuf, sizeof(strBuf), TS_FMT_HHMM, (uint8_t)(window.endMinute/60), (uint8_t)(window.endMinute%60));
+    noirrtimes.add(String(strBuf));
+    noirrdays.add(window.weekdays);
   }
 
   root["irrslot"] = mainConfParams.irrSlotSeconds;
@@ -264,6 +438,27 @@ JsonObject& SensorTask::createJsonFromConfParams(DynamicJsonBuffer& jsonBuffer)
   root["critlevel"] = mainConfParams.critLevel;
   root["satlevel"] = mainConfParams.satLevel;
   root["normpulses"] = mainConfParams.normalPulsesPerSec;
+  root["probetol"] = mainConfParams.probeTolerance;
+  root["maxprobes"] = mainConfParams.maxProbes;
+  root["pulsesliter"] = mainConfParams.pulsesPerLiter;
+  root["irrmaxlitersday"] = mainConfParams.irrMaxLitersDay;
+  root["doselitersperlevel"] = mainConfParams.doseLitersPerLevel;
+  root["numzones"] = mainConfParams.numZones;
+  addRuleNames(root.createNestedArray("startrules"), mainConfParams.startRules);
+  addRuleNames(root.createNestedArray("stoprules"), mainConfParams.stopRules);
+  root["budgetslotfrac"] = mainConfParams.budgetSlotFraction;
+  root["deepincfrac"] = mainConfParams.deepIncreaseFraction;
+  root["flowsettlesecs"] = mainConfParams.flowSettleSecs;
+  root["predicthorizonmins"] = mainConfParams.predictHorizonMins;
+  root["predictleadmins"] = mainConfParams.predictLeadMins;
+  root["hystfrac"] = mainConfParams.hystFraction;
+  root["minrunsecs"] = mainConfParams.minRunSecs;
+  root["minrestsecs"] = mainConfParams.minRestSecs;
+  root["maxstartshour"] = mainConfParams.maxStartsPerHour;
+  root["fshighwater"] = mainConfParams.fsHighWater;
+  root["fslowwater"] = mainConfParams.fsLowWater;
+  root["sensorlogquota"] = mainConfParams.sensorLogQuota;
+  root["msglogquota"] = mainConfParams.msgLogQuota;
 
   return root;  
 }
@@ -273,10 +468,11 @@ bool SensorTask::updateConfParams(const ConfParams &newParams) {
   if (&newParams != &mainConfParams) {
     memcpy(&mainConfParams, &newParams, sizeof(ConfParams));    
   }
+  compileNoIrrigTimes();
   String fileName = String(FPSTR(PARAMS_JSON_FILE));
   File confFile = SPIFFS.open(fileName, "w");
   if (!confFile) return false;
-  const size_t bufferSize = JSON_ARRAY_SIZE(8) + JSON_OBJECT_SIZE(7);
+  const size_t bufferSize = CONF_JSON_SIZE;
   DynamicJsonBuffer jsonBuffer(bufferSize);
 
   JsonObject& root = createJsonFromConfParams(jsonBuffer);
@@ -290,18 +486,21 @@ bool SensorTask::updateConfParams(const ConfParams &newParams) {
 
 void SensorTask::updateConfParamsFromJson(ConfParams& confStruct, JsonObject& jsonConfParamsRoot) {
   JsonArray& noirrtimes = jsonConfParamsRoot["noirrtimes"];
-  confStruct.noIrrTime0Init = confParamTime2Timet(noirrtimes[0]);
-  confStruct.noIrrTime0End = confParamTime2Timet(noirrtimes[1]);
-  
-
-  confStruct.noIrrTime1Init = confParamTime2Timet(noirrtimes[2]);
-  confStruct.noIrrTime1End = confParamTime2Timet(noirrtimes[3]);
-
-  confStruct.noIrrTime2Init = confParamTime2Timet(noirrtimes[4]);
-  confStruct.noIrrTime2End = confParamTime2Timet(noirrtimes[5]);
-
-  confStruct.noIrrTime3Init = confParamTime2Timet(noirrtimes[6]);
-  confStruct.noIrrTime3End = confParamTime2Timet(noirrtimes[7]);
+  JsonArray& noirrdays = jsonConfParamsRoot["noirrdays"];
+  confStruct.clearNoIrrWindows();
+  for (size_t i = 0; i + 1 < noirrtimes.size(); i += 2) {
+    const char* initStr = noirrtimes[i];
+    const char* endStr = noirrtimes[i+1];
+    //"0" pairs are the empty windows of files from before the window list
+    if (isEmptyConfTime(initStr) && isEmptyConfTime(endStr)) continue;
+    const int initMinute = confParamMinute(initStr);
+    const int endMinute = confParamMinute(endStr);
+    NoIrrigWindow window;
+    window.initMinute = (initMinute >= 0) ? initMinute : MINUTES_PER_DAY; //invalid, rejected below
+    window.endMinute = (endMinute >= 0) ? endMinute : MINUTES_PER_DAY;
+    window.weekdays = (i/2 < noirrdays.size()) ? noirrdays[i/2].as<uint8_t>() : WEEKDAYS_ALL;
+    confStruct.addNoIrrWindow(window);
+  }
 
   confStruct.irrSlotSeconds = jsonConfParamsRoot["irrslot"];
   confStruct.irrMaxTimeDaySeconds = jsonConfParamsRoot["irrmaxtimeday"]; 
@@ -309,6 +508,29 @@ void SensorTask::updateConfParamsFromJson(ConfParams& confStruct, JsonObject& js
   confStruct.critLevel = jsonConfParamsRoot["critlevel"]; 
   confStruct.satLevel = jsonConfParamsRoot["satlevel"];
   confStruct.normalPulsesPerSec = jsonConfParamsRoot["normpulses"];
+  confStruct.probeTolerance = jsonConfParamsRoot["probetol"];
+  confStruct.maxProbes = jsonConfParamsRoot["maxprobes"];
+  confStruct.pulsesPerLiter = jsonConfParamsRoot["pulsesliter"];
+  confStruct.irrMaxLitersDay = jsonConfParamsRoot["irrmaxlitersday"];
+  confStruct.doseLitersPerLevel = jsonConfParamsRoot["doselitersperlevel"];
+  const unsigned int numZones = jsonConfParamsRoot["numzones"];
+  confStruct.numZones = (numZones > 0) ? numZones : 1; //files from before the zones
+  //files from before the rules keep the values in confStruct
+  readRuleNames(jsonConfParamsRoot, "startrules", confStruct.startRules);
+  readRuleNames(jsonConfParamsRoot, "stoprules", confStruct.stopRules);
+  if (jsonConfParamsRoot.containsKey("budgetslotfrac")) confStruct.budgetSlotFraction = jsonConfParamsRoot["budgetslotfrac"];
+  if (jsonConfParamsRoot.containsKey("deepincfrac")) confStruct.deepIncreaseFraction = jsonConfParamsRoot["deepincfrac"];
+  if (jsonConfParamsRoot.containsKey("flowsettlesecs")) confStruct.flowSettleSecs = jsonConfParamsRoot["flowsettlesecs"];
+  if (jsonConfParamsRoot.containsKey("predicthorizonmins")) confStruct.predictHorizonMins = jsonConfParamsRoot["predicthorizonmins"];
+  if (jsonConfParamsRoot.containsKey("predictleadmins")) confStruct.predictLeadMins = jsonConfParamsRoot["predictleadmins"];
+  if (jsonConfParamsRoot.containsKey("hystfrac")) confStruct.hystFraction = jsonConfParamsRoot["hystfrac"];
+  if (jsonConfParamsRoot.containsKey("minrunsecs")) confStruct.minRunSecs = jsonConfParamsRoot["minrunsecs"];
+  if (jsonConfParamsRoot.containsKey("minrestsecs")) confStruct.minRestSecs = jsonConfParamsRoot["minrestsecs"];
+  if (jsonConfParamsRoot.containsKey("maxstartshour")) confStruct.maxStartsPerHour = jsonConfParamsRoot["maxstartshour"];
+  if (jsonConfParamsRoot.containsKey("fshighwater")) confStruct.fsHighWater = jsonConfParamsRoot["fshighwater"];
+  if (jsonConfParamsRoot.containsKey("fslowwater")) confStruct.fsLowWater = jsonConfParamsRoot["fslowwater"];
+  if (jsonConfParamsRoot.containsKey("sensorlogquota")) confStruct.sensorLogQuota = jsonConfParamsRoot["sensorlogquota"];
+  if (jsonConfParamsRoot.containsKey("msglogquota")) confStruct.msgLogQuota = jsonConfParamsRoot["msglogquota"];
   
 }
 
@@ -319,11 +541,17 @@ bool readFSIrrigData(IrrigData& data) {
   String fileName = String(FPSTR(IRRIGDATA_JSON_FILE));
   File irrigFile = SPIFFS.open(fileName, "r");
   if (!irrigFile) return false;
-  const size_t bufferSize = JSON_OBJECT_SIZE(2) + 60;
+  const size_t bufferSize = JSON_OBJECT_SIZE(5) + JSON_ARRAY_SIZE(IRRIG_LITERS_DAYS) + 100;
   DynamicJsonBuffer jsonBuffer(bufferSize);
   JsonObject& root = jsonBuffer.parseObject(irrigFile);
   data.lastIrrigEnd = (time_t) root["lastIrrigEnd"];
   data.irrigTodaySecs = (unsigned long) root["irrigTodaySecs"]; 
+  data.irrigLiters = root["irrigLiters"];
+  data.litersDay = root["litersDay"];
+  JsonArray& dailyLiters = root["dailyLiters"];
+  for (int i = 0; i < IRRIG_LITERS_DAYS; i++) {
+    data.dailyLiters[i] = dailyLiters[i]; //0 in files from before the totalizer
+  }
   irrigFile.close();  
   return true;
 }
@@ -333,67 +561,181 @@ bool updateFSIrrigData(IrrigData& data) {
   String fileName = String(FPSTR(IRRIGDATA_JSON_FILE));
   File irrigFile = SPIFFS.open(fileName, "w+");
   if (!irrigFile) return false;
-  const size_t bufferSize = JSON_OBJECT_SIZE(2);
+  const size_t bufferSize = JSON_OBJECT_SIZE(5) + JSON_ARRAY_SIZE(IRRIG_LITERS_DAYS);
   DynamicJsonBuffer jsonBuffer(bufferSize);
 
   JsonObject& root = jsonBuffer.createObject();
   root["lastIrrigEnd"] = data.lastIrrigEnd;
   root["irrigTodaySecs"] = data.irrigTodaySecs;
+  root["irrigLiters"] = data.irrigLiters;
+  root["litersDay"] = data.litersDay;
+  JsonArray& dailyLiters = root.createNestedArray("dailyLiters");
+  for (int i = 0; i < IRRIG_LITERS_DAYS; i++) {
+    dailyLiters.add(data.dailyLiters[i]);
+  }
   root.printTo(irrigFile);
   
   irrigFile.close();
   return true;
 }
 
+void SensorTask::compileMoistureCurves() {
+  for (int i = 0; i < NUM_SENSOR_INPUTS; i++) {
+    moistureCurves[i].setParams(mainCalibParams.mulX[i], mainCalibParams.expFact[i]);
+  }
+}
+
+JsonObject& SensorTask::createJsonFromCalibParams(DynamicJsonBuffer& jsonBuffer) {
+  JsonObject& root = jsonBuffer.createObject();
+  root["refres"] = mainCalibParams.refResistor;
+  JsonArray& mulx = root.createNestedArray("mulx");
+  JsonArray& expfact = root.createNestedArray("expfact");
+  for (int i = 0; i < NUM_SENSOR_INPUTS; i++) {
+    mulx.add(mainCalibParams.mulX[i]);
+    expfact.add(mainCalibParams.expFact[i]);
+  }
+  return root;
+}
+
+void SensorTask::updateCalibParamsFromJson(CalibParams& calibStruct, JsonObject& jsonCalibParamsRoot) {
+  calibStruct.refResistor = jsonCalibParamsRoot["refres"];
+  JsonArray& mulx = jsonCalibParamsRoot["mulx"];
+  JsonArray& expfact = jsonCalibParamsRoot["expfact"];
+  for (int i = 0; i < NUM_SENSOR_INPUTS; i++) {
+    calibStruct.mulX[i] = mulx[i];
+    calibStruct.expFact[i] = expfact[i];
+  }
+}
+
+bool SensorTask::updateCalibParams(const CalibParams &newParams) {
+  if (&newParams != &mainCalibParams) {
+    mainCalibParams = newParams;
+  }
+  compileMoistureCurves();
+  String fileName = String(FPSTR(CALIB_JSON_FILE));
+  File calibFile = SPIFFS.open(fileName, "w");
+  if (!calibFile) return false;
+  DynamicJsonBuffer jsonBuffer(CALIB_JSON_SIZE);
+
+  JsonObject& root = createJsonFromCalibParams(jsonBuffer);
+
+  root.printTo(calibFile);
+  calibFile.flush();
+  calibFile.close();
+
+  return true;
+}
+
+//keeps the defaults of sensor_calibration.h if there is no valid file
+CalibParams *SensorTask::readCalibParams() {
+  CalibParams *result = NULL;
+  if (fsOpen) {
+    String fileName = String(FPSTR(CALIB_JSON_FILE));
+    File calibFile = SPIFFS.open(fileName, "r");
+    if (calibFile) {
+      DynamicJsonBuffer jsonBuffer(CALIB_JSON_SIZE + 200);
+      JsonObject& root = jsonBuffer.parseObject(calibFile);
+      CalibParams readParams;
+      updateCalibParamsFromJson(readParams, root);
+      if (readParams.isAllValid()) {
+        mainCalibParams = readParams;
+        result = &mainCalibParams;
+      }
+      calibFile.close();
+    }
+  }
+  compileMoistureCurves();
+  return result;
+}
+
 ConfParams *SensorTask::readMainConfParams() {
   ConfParams *result = NULL;
   if (fsOpen) {
       String fileName = String(FPSTR(PARAMS_JSON_FILE));
       File confFile = SPIFFS.open(fileName, "r");
       if (!confFile) return NULL;
-      const size_t bufferSize = JSON_ARRAY_SIZE(8) + JSON_OBJECT_SIZE(7) + 170;
+      const size_t bufferSize = CONF_JSON_SIZE + 190;
       DynamicJsonBuffer jsonBuffer(bufferSize);
       JsonObject& root = jsonBuffer.parseObject(confFile);
       updateConfParamsFromJson(mainConfParams, root);
+      compileNoIrrigTimes();
       result = &mainConfParams;
       confFile.close(); 
   }
   return result;
 }
 
-float SensorTask::readMoisture(SensorType sType) {
-  float value = 1;
-  int refVoltage, afterSensorVoltage;
-  for (int i = 0; i < NUM_PROBES; i++) {
-      resistances[i] = -1;
-      refVoltage = readReferenceVoltage(sType, currSensorDirection);
-      afterSensorVoltage = readAfterSensorVoltage(sType, currSensorDirection);
-      #ifdef DEBUG_SENSOR_MODE
-        Serial.print(F("Reference read was: "));
-        Serial.println(refVoltage);
-        Serial.print(F("After sensor voltage was: "));
-        Serial.println(afterSensorVoltage);
-      #endif
-      if (afterSensorVoltage < MINAFTERVOLTAGE_OPENCIRCUIT) {
-        value = AFTERVOLTAGE_OPEN;
-      } else if ((refVoltage - afterSensorVoltage) < SHORTCIRCUIT_SENSOR_MINDIFF){
-        value = SENSOR_SHORTCIRCUIT;
-      } else {
-        resistances[i] = long( double(REFERENCE_RESISTOR) * ( refVoltage - afterSensorVoltage ) / afterSensorVoltage + 0.5 );
-        #ifdef DEBUG_SENSOR_MODE
-          Serial.print(F("Resistance: "));
-          Serial.println(resistances[i]);
-        #endif 
-        switchSensorDirection();
-        this->delay(SIGNAL_DELAY);
-      }
-      yield();
+//GPIO writes of a probe read: decoder output and reference mux input, then
+//the after sensor mux input
+class ProbeAddress {
+public:
+  GpioMasks reference;
+  GpioMasks afterSensor;
+
+  constexpr ProbeAddress(SensorType sType, SensorDirection sDir) :
+      reference(decoderMasks(2*sType + sDir) | muxMasks(SensorInput(2*sType + sDir))),
+      afterSensor(muxMasks(SensorInput(2*sType + (sDir == LEFT ? RIGHT : LEFT)))) { }
+};
+
+static constexpr ProbeAddress PROBE_ADDRESSES[3][2] = {
+  { ProbeAddress(SURFACE, LEFT), ProbeAddress(SURFACE, RIGHT) },
+  { ProbeAddress(MIDDLE, LEFT), ProbeAddress(MIDDLE, RIGHT) },
+  { ProbeAddress(DEEP, LEFT), ProbeAddress(DEEP, RIGHT) }
+};
+
+//resistance of one probe, or -1 with the error kept in errValue
+static long probeResistance(int refVoltage, int afterSensorVoltage, float& errValue) {
+  long resistance = -1;
+  if (afterSensorVoltage < MINAFTERVOLTAGE_OPENCIRCUIT) {
+    errValue = AFTERVOLTAGE_OPEN;
+  } else if ((refVoltage - afterSensorVoltage) < SHORTCIRCUIT_SENSOR_MINDIFF){
+    errValue = SENSOR_SHORTCIRCUIT;
+  } else {
+    resistance = long( double(mainCalibParams.refResistor) * ( refVoltage - afterSensorVoltage ) / afterSensorVoltage + 0.5 );
   }
-  sortResistances();
-  const long medianResistance = resistances[NUM_PROBES/2];
-  if (medianResistance > 0) {
-    value = float(exp((log(MOISTURE_MULX)-log(medianResistance))/(MOISTURE_EXPFACT)));
-    if (value > 1) value = 1;
+  #ifdef DEBUG_SENSOR_MODE
+    Serial.print(F("Reference read was: "));
+    Serial.println(refVoltage);
+    Serial.print(F("After sensor voltage was: "));
+    Serial.println(afterSensorVoltage);
+    Serial.print(F("Resistance: "));
+    Serial.println(resistance);
+  #endif
+  return resistance;
+}
+
+//moisture of one probe in Q16 with the curve of the driven input, or -1
+static long probeMoisture(long resistance, SensorInput drivenInput) {
+  if (resistance <= 0) return -1;
+  const MoistureCurve& curve = moistureCurves[drivenInput];
+  #ifdef DEBUG_SENSOR_MODE
+    Serial.print(F("Moisture (float path): "));
+    Serial.println(curve.toMoistureFloat(resistance));
+  #endif
+  return long(curve.toMoistureQ16(resistance));
+}
+
+//Distribution free confidence interval of about 95% for the median of the
+//first n samples: the order statistics at ranks k and n-1-k, with k from
+//the normal approximation of Binomial(n, 1/2). Reorders the samples.
+static long medianBoundWidth(long samples[], const int n) {
+  const int k = max(0, int((n - 1.96*sqrt(double(n)))/2));
+  const long lower = SelectionKernel<long, MAX_PROBES>::select(samples, 0, n - 1, k);
+  const long upper = SelectionKernel<long, MAX_PROBES>::select(samples, k, n - 1, n - 1 - k);
+  return upper - lower;
+}
+
+float SensorTask::moistureFromSamples(SensorType sType, int numSamples, float errValue) {
+  float value = errValue;
+  const ProbeStats<long> moistureStats = SelectionKernel<long, MAX_PROBES>::quantiles(moistureSamples[sType], numSamples);
+  const long medianMoisture = moistureStats.median;
+  moistureIQRs[sType] = moistureStats.iqr();
+  #ifdef DEBUG_SENSOR_MODE
+    Serial.print(F("Moisture IQR: "));
+    Serial.println(float(moistureIQRs[sType])/MOISTURE_Q16_ONE);
+  #endif
+  if (medianMoisture >= 0) {
+    value = float(medianMoisture)/MOISTURE_Q16_ONE;
   } else if (value > 0) {
     value = MOISTURE_READERROR;
   }
@@ -401,77 +743,60 @@ float SensorTask::readMoisture(SensorType sType) {
   return value;
 }
 
+//Reads the probes of every depth. Each round reads one probe per depth,
+//the reference and after sensor voltages in the same drive period, and the
+//discharge of a depth happens while the next one settles. The direction is
+//switched every round to avoid electrolysis.
+//With a probe tolerance configured, a depth stops being read once the
+//confidence interval of its median is within the tolerance (after
+//MIN_PROBES), or at the maxProbes cap. Otherwise NUM_PROBES are read.
+void SensorTask::scanMoistures(SoilMoisture& frame) {
+  float errValues[3] = {1, 1, 1};
+  int probes[3] = {0, 0, 0};
+  bool done[3] = {false, false, false};
+  const bool adaptive = mainConfParams.probeTolerance > 0;
+  const int maxProbes = (adaptive && mainConfParams.maxProbes > 0) ? min(int(mainConfParams.maxProbes), MAX_PROBES) : NUM_PROBES;
+  const long toleranceQ16 = long(mainConfParams.probeTolerance*MOISTURE_Q16_ONE);
+  int depthsLeft = 3;
+  for (int i = 0; i < maxProbes && depthsLeft > 0; i++) {
+    for (int t = SURFACE; t <= DEEP; t++) {
+      if (done[t]) continue;
+      int refVoltage, afterSensorVoltage;
+      readProbeVoltages(SensorType(t), currSensorDirection, refVoltage, afterSensorVoltage);
+      const long resistance = probeResistance(refVoltage, afterSensorVoltage, errValues[t]);
+      moistureSamples[t][i] = probeMoisture(resistance, SensorInput(2*t + currSensorDirection));
+      probes[t] = i + 1;
+      if ((probes[t] == maxProbes)
+          || (adaptive && probes[t] >= MIN_PROBES && medianBoundWidth(moistureSamples[t], probes[t]) <= toleranceQ16)) {
+        done[t] = true;
+        depthsLeft--;
+      }
+    }
+    switchSensorDirection();
+    yield();
+  }
+  frame.surface = moistureFromSamples(SURFACE, probes[SURFACE], errValues[SURFACE]);
+  frame.middle = moistureFromSamples(MIDDLE, probes[MIDDLE], errValues[MIDDLE]);
+  frame.deep = moistureFromSamples(DEEP, probes[DEEP], errValues[DEEP]);
+  frame.surfaceProbes = probes[SURFACE];
+  frame.middleProbes = probes[MIDDLE];
+  frame.deepProbes = probes[DEEP];
+}
+
 
 
 const char TS_FMT_STR[] PROGMEM = "%04d%02d%02dT%02d%02d%02d"; //yyyymmddThhmmss
-static const char LOGF_FMT_STR[] PROGMEM = "/logs/sensor%04d%02d%02d.txt"; //yyyymmdd
-static const char MSGF_FMT_STR[] PROGMEM = "/logs/msg%04d%02d%02d.txt"; //yyyymmdd
+const char LOGF_FMT_STR[] PROGMEM = "/logs/sensor%04d%02d%02d.txt"; //yyyymmdd
+const char MSGF_FMT_STR[] PROGMEM = "/logs/msg%04d%02d%02d.txt"; //yyyymmdd
 
 
 const char LOG_DIR[] PROGMEM = "/logs";
-static const char SENSORLOG_COMMON_NAME[] PROGMEM = "/logs/sensor";
-static const char MSGLOG_COMMON_NAME[] PROGMEM = "/logs/msg";
 static const char STR_FMT_STR[] PROGMEM = "%s";
 
-bool SensorTask::doFSMaintenance(int keepDays, const String& dirName, const String& commonName) {
-  time_t nowTime = TimeKeeper::tkNow();
-  Dir logDir = SPIFFS.openDir(dirName);
-  tmElements_t timeElements;
-  timeElements.Second = 0;
-  timeElements.Minute = 0;
-  timeElements.Hour = 0;
-  timeElements.Wday = 0;
-    // tm.Second  Seconds   0 to 59
-    // tm.Minute  Minutes   0 to 59
-    // tm.Hour    Hours     0 to 23
-    // tm.Wday    Week Day  0 to 6  (not needed for mktime)
-    // tm.Day     Day       1 to 31
-    // tm.Month   Month     1 to 12
-    // tm.Year    Year      0 to 99 (offset from 1970)  
-  bool allOk = true;
-  while(logDir.next()) {
-    String fileName = logDir.fileName();
-    if (fileName.startsWith(commonName)) {
-      String year = fileName.substring(commonName.length(), commonName.length()+4);
-      String month = fileName.substring(commonName.length()+4, commonName.length()+4+2);
-      String day = fileName.substring(commonName.length()+6, commonName.length()+6+2);
-      int tmYear = (int)year.toInt();
-      if (tmYear == 0) return false;
-      tmYear -= 1970;
-      int tmMonth = (int)month.toInt();
-      if (tmMonth == 0) return false;
-      int tmDay = (int)day.toInt();
-      if (tmDay == 0) return false;
-      timeElements.Year = tmYear;
-      timeElements.Month = tmMonth;
-      timeElements.Day = tmDay;
-      time_t logFileTime = TimeKeeper::tkMakeTime(timeElements);
-      time_t elapsedDays = (nowTime > logFileTime) ? ((nowTime - logFileTime)/(3600ul*24ul)) : 0;
-      Serial.print(F("Days elapsed: "));
-      Serial.print(elapsedDays);
-      Serial.println("");
-      if ((nowTime > logFileTime) && elapsedDays > keepDays) {
-        Serial.print(F("FS maintenance is deleting NOW file: "));
-        Serial.println(fileName);
-        allOk = allOk && SPIFFS.remove(fileName);
-      }
-    }
-  }
-  return allOk; 
-}
-
-bool SensorTask::doFSMaintenance(int keepDays) {
-  return doFSMaintenance(keepDays, String(FPSTR(LOG_DIR)), String(FPSTR(SENSORLOG_COMMON_NAME))) 
-      && doFSMaintenance(keepDays, String(FPSTR(LOG_DIR)), String(FPSTR(MSGLOG_COMMON_NAME)));
-}
-
-File SensorTask::getLogFileWithDate(time_t theDate) {
-  return SensorTask::getFSFileWithDate(theDate, LOGF_FMT_STR, 33);
-}
-
-File SensorTask::getMsgFileWithDate(time_t theDate) {
-  return SensorTask::getFSFileWithDate(theDate, MSGF_FMT_STR, 33);
-}
+LogWriter SensorTask::sensorLog(LOGKIND_SENSOR, LOGF_FMT_STR, SensorTask::beforeLogOpen);
+LogWriter SensorTask::msgLog(LOGKIND_MSG, MSGF_FMT_STR, SensorTask::beforeLogOpen);
+static long sensorLogDay = -1; //elapsedDays() of the file sensorLogBinary is about
+static bool sensorLogBinary = true;
 
 File SensorTask::getMsgFileWithDateForRead(time_t theDate) {
   return SensorTask::getFSFileWithDateForRead(theDate, MSGF_FMT_STR, 33);
@@ -485,6 +810,7 @@ File SensorTask::getLogFileWithDateForRead(time_t theDate) {
 File SensorTask::getFSFileWithDateForRead(time_t aTime, PGM_P fmtStr, const int bufSize) {
   File logFile;
   if (fsOpen) {
+    commitLogs();
     char logFName[bufSize];
     memset(logFName, '\0', bufSize*sizeof(char)); 
     
@@ -496,151 +822,138 @@ File SensorTask::getFSFileWithDateForRead(time_t aTime, PGM_P fmtStr, const int
                   //has been returned    
 }
 
-File SensorTask::getFSFileWithDate(time_t nowTime, PGM_P fmtStr, const int bufSize) {
-  File logFile;
-  if (fsOpen) {
-    char logFName[bufSize];
-    memset(logFName, '\0', bufSize*sizeof(char)); 
-    
-    snprintf_P(logFName, bufSize, fmtStr, TimeKeeper::tkYear(nowTime), TimeKeeper::tkMonth(nowTime), TimeKeeper::tkDay(nowTime));
-
-    if(lastLogWrite == 0) {
-      if (TimeKeeper::isValidTS(nowTime)) {
-        doFSMaintenance(FS_LOG_KEEP_DAYS);
-        Serial.print(F("Opening file: "));
-        Serial.print(logFName);
-        Serial.println(F(" for append"));
-        logFile = SPIFFS.open(logFName, "a+");
-      } else {
-        Serial.print(F("Opening file: "));
-        Serial.print(logFName);
-        Serial.println(F(" for overwrite"));       
-        logFile = SPIFFS.open(logFName, "w+");
-      }
-    } else {
-      if (TimeKeeper::tkDay(nowTime) != TimeKeeper::tkDay(lastLogWrite)) {
-        doFSMaintenance(FS_LOG_KEEP_DAYS);
-        if (TimeKeeper::isValidTS(nowTime)) {
-          Serial.print(F("Opening file: "));
-          Serial.print(logFName);
-          Serial.println(F(" for append"));
-          logFile = SPIFFS.open(logFName, "a+");
-        } else {
-          Serial.print(F("Opening file: "));
-          Serial.print(logFName);
-          Serial.println(F(" for overwrite"));                 
-          logFile = SPIFFS.open(logFName, "w");
-        }
-      } else {
-        Serial.print(F("Opening file: "));
-        Serial.print(logFName);
-        Serial.println(F(" for append"));        
-        logFile = SPIFFS.open(logFName, "a+");
-      }
-    }
+//the new file may need room, the old files are deleted from loop()
+void SensorTask::beforeLogOpen() {
+  logRetention.checkSoon();
+}
+
+//moistures as one binary record, a new file starts with the header. A text
+//log of the same date, from a firmware before the binary log, goes on as text
+bool SensorTask::writeSensorRecord(time_t aTime, bool irrigating) {
+  if (!sensorLog.beginRecord(aTime)) return false;
+  const SensorLogRecord record(aTime, moistures.surface, moistures.middle, moistures.deep, irrigating);
+  const long day = elapsedDays(aTime);
+  if (day != sensorLogDay) {
+    sensorLogDay = day;
+    sensorLogBinary = (sensorLog.getFileSize() == 0) || isBinarySensorLog(sensorLog.getFileName());
+    sensorLog.setRecordSize(sensorLogBinary ? SENSORLOG_HEADER_SIZE : 0, sensorLogBinary ? SENSORLOG_RECORD_SIZE : 0);
   }
-  return logFile; //test if this returned object is true, if false no valid file
-                  //has been returned  
+  if (!sensorLogBinary) {
+    char line[SENSORLOG_LINE_SIZE];
+    sensorLog.write((const uint8_t*)line, record.toCSV(line));
+    return true;
+  }
+  if (sensorLog.getFileSize() == 0) {
+    uint8_t header[SENSORLOG_HEADER_SIZE];
+    SensorLogRecord::encodeHeader(header, SensorLogRecord::baseTimeOf(aTime));
+    sensorLog.write(header, SENSORLOG_HEADER_SIZE);
+  }
+  uint8_t bytes[SENSORLOG_RECORD_SIZE];
+  record.encode(bytes, SensorLogRecord::baseTimeOf(aTime));
+  sensorLog.write(bytes, SENSORLOG_RECORD_SIZE);
+  return true;
 }
 
-File SensorTask::getCurrLogFile(time_t nowTime) {
-  return getFSFileWithDate(nowTime, LOGF_FMT_STR, 33);
+bool SensorTask::isBinarySensorLog(const char* fileName) {
+  File file = SPIFFS.open(fileName, "r");
+  if (!file) return false;
+  const SensorLogStream stream(file);
+  file.close();
+  return stream.isBinary();
 }
 
-File SensorTask::getCurrMsgFile(time_t nowTime) {
-  return getFSFileWithDate(nowTime, MSGF_FMT_STR, 33);
+//records buffered so far go to flash, around a change of the pump or the valves or before a log is read
+void SensorTask::commitLogs() {
+  sensorLog.commit();
+  msgLog.commit();
 }
 
 // the loop function runs over and over again forever
 void SensorTask::loopSensorMode() {
   if (requestLearn) {
     requestLearn = false;
-    learnFlowStatus = LFLOW_INPROGRESS;
-    const bool configureOk = this->waterControl.configureFlow();
-    if (configureOk) {
-      learnFlowStatus = LFLOW_DONE;
-    } else {
-      learnFlowStatus = LFLOW_ERROR;
+    if (learnFlowStatus != LFLOW_INPROGRESS) {
+      commitLogs();
+      learnFlowStatus = this->waterControl.startConfigureFlow() ? LFLOW_INPROGRESS : LFLOW_ERROR;
+    }
+  }
+  zoneScheduler.setNumZones(mainConfParams.numZones);
+  zoneScheduler.setMinInterval(60ul*mainConfParams.irrMIntervMins);
+  const time_t scanTime = this->timeKeeper.tkNow();
+  //each probe read borrows the decoder from the flow sensor, see MuxArbiter
+  //zone 0 last, so the probe statistics left are those of moistures
+  for (int zone = zoneScheduler.getNumZones() - 1; zone >= 0; zone--) {
+    Hal::halWriteMasks(zoneBankMasks(zone));
+    scanMoistures(moistures);
+    moistures.timeStamp = scanTime;
+    zoneMoistures.store(zone, moistures);
+    zoneLevels[zone].update(moistures.surface, moistures.middle, mainConfParams.critLevel, mainConfParams.satLevel, mainConfParams.levelBand());
+    //the zone being watered is not drying
+    if (!irrigData.isIrrigating || zone != zoneScheduler.getCurrZone()) {
+      surfaceDrying[zone].add(scanTime, moistures.surface);
+      middleDrying[zone].add(scanTime, moistures.middle);
     }
   }
-  float moistureSurface = readMoisture(SURFACE);
   Serial.print(">>>> SURFACE Moisture: ");
-  Serial.println(moistureSurface);
-  yield();
-
-  float moistureMiddle = readMoisture(MIDDLE);
+  Serial.println(moistures.surface);
   Serial.print(">>>> MIDDLE Moisture: ");
-  Serial.println(moistureMiddle);
-  yield();
-
-  float moistureDeep = readMoisture(DEEP);
+  Serial.println(moistures.middle);
   Serial.print(">>>> DEEP Moisture: ");
-  Serial.println(moistureDeep);
-  moistures.surface = moistureSurface;
-  moistures.middle = moistureMiddle;
-  moistures.deep = moistureDeep;
+  Serial.println(moistures.deep);
+  Serial.print(">>>> Probes used: ");
+  Serial.print(moistures.surfaceProbes);
+  Serial.print(',');
+  Serial.print(moistures.middleProbes);
+  Serial.print(',');
+  Serial.println(moistures.deepProbes);
 
-  moistures.timeStamp = this->timeKeeper.tkNow();
   //moistures.hasWater = isWithWater();
   //FIXME
   //aqui verificar regra de irrigacao
   const time_t nowTime = TimeKeeper::tkNow();
+  SensorRuleEvaluator ruleEvaluator(*this, nowTime);
+  IrrigRuleCycle ruleCycle(ruleEvaluator);
   if (irrigData.isIrrigating) {
     //is irrigating at this moment
-    const unsigned long irrigTimeSecs = nowTime - irrigData.irrigSince;
-    if (irrigTimeSecs > mainConfParams.irrSlotSeconds) {
-      stopIrrigationAndLog(nowTime, STOPIRRIG_SLOTEND); 
-    } else if (moistures.surface >= mainConfParams.satLevel) {
-      stopIrrigationAndLog(nowTime, STOPIRRIG_SURFACESAT);
-    } else if (moistures.middle >= mainConfParams.satLevel) {
-      stopIrrigationAndLog(nowTime, STOPIRRIG_MIDDLESAT);
-    } else if ((moistures.deep > irrigData.deepAtStartIrrig) && (moistures.deep > (irrigData.deepAtStartIrrig + 0.5*(mainConfParams.satLevel - irrigData.deepAtStartIrrig))) &&
-        moistures.surface > mainConfParams.critLevel && moistures.middle > mainConfParams.critLevel) {
-      stopIrrigationAndLog(nowTime, STOPIRRIG_DEEPINCREASE); //FIXME 0.5 should be conf parameter
-    } else if (irrigTodayRemainingSecs() == 0) {
-      stopIrrigationAndLog(nowTime, STOPIRRIG_MAXTIMEDAY);
+    irrigData.irrigLiters = this->waterControl.pumpedLiters();
+    //zones found dry meanwhile wait for their turn in this same pump run
+    for (uint8_t zone = 0; zone < zoneScheduler.getNumZones(); zone++) {
+      if (zoneNeedsWater(zone, nowTime)) zoneScheduler.request(zone, nowTime);
+    }
+    if (mainConfParams.hasDosing()) this->waterControl.setDoseStopsPump(!zoneScheduler.hasPending());
+    const IrrigPredicate stopPred = ruleCycle.run(mainConfParams.stopRules, irrigTrace);
+    printIrrigTrace(irrigTrace);
+    if (stopPred == PRED_BUDGETOUT) {
+      stopIrrigationAndLog(nowTime, stopReasonOf(stopPred));
+    } else if (stopPred != PRED_NONE) {
+      endZoneIrrigation(nowTime, stopReasonOf(stopPred));
     }
   } else {
     //is not irrigating at this moment
-    const WaterCurrSensorStatus  currWaterStatus = this->waterControl.currStatus();
-    if (currWaterStatus != WATER_CURREMPTY) Serial.println(F("OK currWaterStatus != WATER_CURREMPTY")); else Serial.println(F("ERR currWaterStatus = WATER_CURREMPTY"));
-    if (currWaterStatus != WATER_CURRNOCONF) Serial.println(F("OK currWaterStatus != WATER_CURRNOCONF")); else Serial.println(F("ERR currWaterStatus = WATER_CURRNOCONF"));
-    if (!(TimeKeeper::isValidTS(nowTime) && isInNoIrrigTime(nowTime))) Serial.println(F("OK nowTime TS")); else Serial.println(F("ERR nowTime TS"));
-    if (irrigTodayRemainingSecs() >= 0.2*mainConfParams.irrSlotSeconds) Serial.println(F("OK irrigTodayRemainingSecs")); else Serial.println(F("ERR irrigTodayRemainingSecs"));
-    if (fulfillMinIrrigInterval(nowTime)) Serial.println(F("OK nowTime fulfillMinIrrigationInterval")); else Serial.println(F("ERR fulfillMinIrrigationInterval"));
-    if (moistures.surface <= mainConfParams.critLevel || moistures.middle <= mainConfParams.critLevel) Serial.println(F("OK surface or Middle <= Crit")); else Serial.println(F("ERR surface or Middle <= Crit"));
-    if (moistures.surface < mainConfParams.satLevel && moistures.middle < mainConfParams.satLevel) Serial.println(F("OK moistures < satLevel")); else Serial.println(F("ERR moistures < satLevel"));
-    if ( nowTime > MIN_IRRIG_TS && !(TimeKeeper::isValidTS(nowTime) && isInNoIrrigTime(nowTime)) &&
-         (irrigTodayRemainingSecs() >= 0.2*mainConfParams.irrSlotSeconds) && //FIXME 0.2 should be conf parameter
-         fulfillMinIrrigInterval(nowTime) && 
-         (currWaterStatus != WATER_CURREMPTY) &&
-         (currWaterStatus != WATER_CURRNOCONF) &&
-         (moistures.surface <= mainConfParams.critLevel || moistures.middle <= mainConfParams.critLevel) &&
-         (moistures.surface < mainConfParams.satLevel && moistures.middle < mainConfParams.satLevel)
-        ) 
-      { //fulffil irrigation criteria, turn on irrigation
+    //each zone is ruled on its own readings, the pump starts if any needs water
+    zoneScheduler.clearPending();
+    for (uint8_t zone = 0; zone < zoneScheduler.getNumZones(); zone++) {
+      if (zoneNeedsWater(zone, nowTime)) zoneScheduler.request(zone, nowTime);
+    }
+    const IrrigPredicate blockedBy = ruleCycle.run(mainConfParams.startRules, irrigTrace);
+    printIrrigTrace(irrigTrace);
+    if (blockedBy == PRED_ALLOWEDTIME) {
+      Serial.print(F("No irrigation until "));
+      Serial.println(nextIrrigAllowedTime(nowTime));
+    } else if (blockedBy == PRED_NONE) {
+      //fulffil irrigation criteria, turn on irrigation
+      const PumpHold hold = pumpGovernor.startHold(nowTime, mainConfParams.minRestSecs, mainConfParams.maxStartsPerHour);
+      if (hold == PUMP_HOLD_NONE) {
         Serial.println(F("I'm starting IRRIGATION"));
-        startIrrigationAndLog(nowTime, moistures);
+        startIrrigationAndLog(nowTime, zoneScheduler.takeNext());
+      } else {
+        printPumpHold(hold);
       }
+    }
   }
-  
-  char tsStr[16];
-  snprintf_P(tsStr, 16, TS_FMT_STR, this->timeKeeper.tkYear(moistures.timeStamp), this->timeKeeper.tkMonth(moistures.timeStamp), this->timeKeeper.tkDay(moistures.timeStamp), this->timeKeeper.tkHour(moistures.timeStamp), this->timeKeeper.tkMinute(moistures.timeStamp), this->timeKeeper.tkSecond(moistures.timeStamp));
 
   if ((lastLogWrite == 0)  || ((moistures.timeStamp - lastLogWrite) > FS_LOG_WRITE_INTERVAL)) {
-    File logFile = getCurrLogFile(moistures.timeStamp);
-    if (logFile) {
-      logFile.print(tsStr);
-      logFile.print(',');
-      logFile.print(moistures.surface);
-      logFile.print(',');
-      logFile.print(moistures.middle);
-      logFile.print(',');
-      logFile.print(moistures.deep);
-      logFile.print(',');
-      logFile.println(irrigData.isIrrigating ? '1' : '0');
-      logFile.flush();
-      logFile.close();
+    if (writeSensorRecord(moistures.timeStamp, irrigData.isIrrigating)) {
       lastLogWrite = moistures.timeStamp;
     }
   }  
@@ -656,46 +969,6 @@ void SensorTask::loopSensorMode() {
   Serial.println("");
 }
 
-static const char SELECT_SENSOR_NAME[] PROGMEM =  "SensorTask::selectSensor()";
-void SensorTask::selectSensor(SensorInput sensor) {
-  switch(sensor) {
-    case SURFACE_LEFT:
-       digitalWrite(MULA_PIN, LOW);
-       digitalWrite(MULB_PIN, LOW);
-       digitalWrite(MULC_PIN, LOW);
-       break;
-    case SURFACE_RIGHT:
-       digitalWrite(MULA_PIN, HIGH);
-       digitalWrite(MULB_PIN, LOW);
-       digitalWrite(MULC_PIN, LOW);
-       break;
-    case MIDDLE_LEFT:
-       digitalWrite(MULA_PIN, LOW);
-       digitalWrite(MULB_PIN, HIGH);
-       digitalWrite(MULC_PIN, LOW);
-       break;
-    case MIDDLE_RIGHT:
-       digitalWrite(MULA_PIN, HIGH);
-       digitalWrite(MULB_PIN, HIGH);
-       digitalWrite(MULC_PIN, LOW);
-       break;
-    case DEEP_LEFT:
-       digitalWrite(MULA_PIN, LOW);
-       digitalWrite(MULB_PIN, LOW);
-       digitalWrite(MULC_PIN, HIGH);
-       break;
-    case DEEP_RIGHT:
-       digitalWrite(MULA_PIN, HIGH);
-       digitalWrite(MULB_PIN, LOW);
-       digitalWrite(MULC_PIN, HIGH);
-       break;    
-    default:
-      Serial.print(FPSTR(UNINPLEMENTED_CALL));
-      Serial.println(FPSTR(SELECT_SENSOR_NAME));
-      break;
-  }
-}
-  
 SensorDirection SensorTask::switchSensorDirection() {
   switch(currSensorDirection) {
     case LEFT:
@@ -730,234 +1003,115 @@ bool SensorTask::isWithWater() {
 }
 */
 
-static const char ENABLE_SENSOR_VOLTAGE_NAME[] PROGMEM = "SensorTask::enableSensorVoltage() ";
-static const char SENSORTYPE_NAME[] PROGMEM = "SensorType ";
-static const char SENSORDIRECTION_NAME[] PROGMEM = "SensorDirection ";
-
-void SensorTask::enableSensorVoltage(SensorType sType, SensorDirection sDir) {
-  switch(sType) {
-    case SURFACE:
-      switch(sDir) {
-        case LEFT:
-          digitalWrite(DECOD_A0_PIN, LOW);
-          digitalWrite(DECOD_A1_PIN, LOW);
-          digitalWrite(DECOD_A2_PIN, LOW);
-          break;
-        case RIGHT:
-          digitalWrite(DECOD_A0_PIN, HIGH);
-          digitalWrite(DECOD_A1_PIN, LOW);
-          digitalWrite(DECOD_A2_PIN, LOW);
-          break;  
-        default:
-          Serial.print(FPSTR(UNINPLEMENTED_CALL));
-          Serial.print(FPSTR(ENABLE_SENSOR_VOLTAGE_NAME));
-          Serial.println(FPSTR(SENSORDIRECTION_NAME));
-          break;
-      }
-      break;
-    case MIDDLE:
-      switch(sDir) {
-        case LEFT:
-          digitalWrite(DECOD_A0_PIN, LOW);
-          digitalWrite(DECOD_A1_PIN, HIGH);
-          digitalWrite(DECOD_A2_PIN, LOW);
-          break;
-        case RIGHT:
-          digitalWrite(DECOD_A0_PIN, HIGH);
-          digitalWrite(DECOD_A1_PIN, HIGH);
-          digitalWrite(DECOD_A2_PIN, LOW);
-          break;  
-        default:
-          Serial.print(FPSTR(UNINPLEMENTED_CALL));
-          Serial.print(FPSTR(ENABLE_SENSOR_VOLTAGE_NAME));
-          Serial.println(FPSTR(SENSORDIRECTION_NAME));
-          break;
-      }
-      break;
-    case DEEP:
-      switch(sDir) {
-        case LEFT:
-          digitalWrite(DECOD_A0_PIN, LOW);
-          digitalWrite(DECOD_A1_PIN, LOW);
-          digitalWrite(DECOD_A2_PIN, HIGH);
-          break;
-        case RIGHT:
-          digitalWrite(DECOD_A0_PIN, HIGH);
-          digitalWrite(DECOD_A1_PIN, LOW);
-          digitalWrite(DECOD_A2_PIN, HIGH);
-          break;  
-        default:
-          Serial.print(FPSTR(UNINPLEMENTED_CALL));
-          Serial.print(FPSTR(ENABLE_SENSOR_VOLTAGE_NAME));
-          Serial.println(FPSTR(SENSORDIRECTION_NAME));
-          break;
-      }
-      break;
-      
-    default:
-      Serial.print(FPSTR(UNINPLEMENTED_CALL));
-      Serial.print(FPSTR(ENABLE_SENSOR_VOLTAGE_NAME));
-      Serial.println(FPSTR(SENSORTYPE_NAME));
-      break;
-  }
-}
-
-static const char READ_REFERENCE_VOLTAGE_NAME[] PROGMEM = "SensorTask::readReferenceVoltage() ";  
-
-int SensorTask::readVoltage(SensorType sType, SensorDirection sDirection, SensorInput sensorInput) {
-  int readVal;
-  enableSensorVoltage(sType, sDirection);
-  selectSensor(sensorInput);
-  enableMulAndDecod();
-  this->delay(SIGNAL_DELAY);
-  readVal = analogRead(ANALOG_PIN);
-  disableMulAndDecod();
-  this->delay(SIGNAL_DELAY);        
-  return readVal;
-}
-
-int SensorTask::readReferenceVoltage(SensorType sType, SensorDirection sDir) {
-  int readVal = -1;
-  switch(sType) {
-    case SURFACE:
-      switch(sDir) {
-        case LEFT:
-          readVal = readVoltage(SURFACE, LEFT, SURFACE_LEFT);
-          break;
-        case RIGHT:
-          readVal = readVoltage(SURFACE, RIGHT, SURFACE_RIGHT);
-          break;
-      }
-      break;
-    case MIDDLE:
-      switch(sDir) {
-        case LEFT:
-          readVal = readVoltage(MIDDLE, LEFT, MIDDLE_LEFT);
-          break;
-        case RIGHT:
-          readVal = readVoltage(MIDDLE, RIGHT, MIDDLE_RIGHT);
-          break;
-      }
-      break;
-    case DEEP:
-      switch(sDir) {
-        case LEFT:
-          readVal = readVoltage(DEEP, LEFT, DEEP_LEFT);
-          break;
-        case RIGHT:
-          readVal = readVoltage(DEEP, RIGHT, DEEP_RIGHT);
-          break;
-      }
-      break;      
-    default:
-      Serial.print(FPSTR(UNINPLEMENTED_CALL));
-      Serial.println(FPSTR(READ_REFERENCE_VOLTAGE_NAME));
-      break; 
+//drives sType from sDir and reads the reference and the after sensor inputs
+//in one lease of the decoder, the probe discharges after the release
+void SensorTask::readProbeVoltages(SensorType sType, SensorDirection sDir, int& refVoltage, int& afterSensorVoltage) {
+  const ProbeAddress& address = PROBE_ADDRESSES[sType][sDir];
+  while (!MuxArbiter::acquire(MUX_PROBES, address.reference)) {
+    //the flow sensor has not had its slice yet
+    taskDelay(MuxArbiter::waitMs(MUX_PROBES));
   }
-  return readVal;
-}
-
-static const char READ_AFTERSENSOR_VOLTAGE_NAME[] PROGMEM = "SensorTask::readAfterSensorVoltage() ";    
-int SensorTask::readAfterSensorVoltage(SensorType sType, SensorDirection sDir) {
-  int readVal = -1;
-  switch(sType) {
-    case SURFACE:
-      switch(sDir) {
-        case LEFT:
-          readVal = readVoltage(SURFACE, LEFT, SURFACE_RIGHT); //should enable reference at left but read at right
-          break;
-        case RIGHT:
-          readVal = readVoltage(SURFACE, RIGHT, SURFACE_LEFT);
-          break;
-      }
-      break;
-    case MIDDLE:
-      switch(sDir) {
-        case LEFT:
-          readVal = readVoltage(MIDDLE, LEFT, MIDDLE_RIGHT);
-          break;
-        case RIGHT:
-          readVal = readVoltage(MIDDLE, RIGHT, MIDDLE_LEFT);
-          break;
-      }
-      break;
-    case DEEP:
-      switch(sDir) {
-        case LEFT:
-          readVal = readVoltage(DEEP, LEFT, DEEP_RIGHT);
-          break;
-        case RIGHT:
-          readVal = readVoltage(DEEP, RIGHT, DEEP_LEFT);
-          break;
-      }
-      break;
-    default:
-      Serial.print(FPSTR(UNINPLEMENTED_CALL));
-      Serial.println(FPSTR(READ_AFTERSENSOR_VOLTAGE_NAME));
-      break; 
-  }
-  return readVal;
+  taskDelay(SIGNAL_DELAY);
+  refVoltage = Hal::halAnalogRead(ANALOG_PIN);
+  MuxArbiter::select(MUX_PROBES, address.afterSensor);
+  taskDelay(MUX_SETTLE_DELAY);
+  afterSensorVoltage = Hal::halAnalogRead(ANALOG_PIN);
+  MuxArbiter::release(MUX_PROBES);
 }
 
 void SensorTask::loop()  {
   loopSensorMode();
-  unsigned long timeBeforeTest = millis();
+  sensorLog.commitDue(Hal::halMillis());
+  const bool wasBlocked = logRetention.getBlockedBytes() > 0;
+  logRetention.step(mainConfParams, FS_LOG_KEEP_DAYS, TimeKeeper::tkNow(), Hal::halMillis());
+  if (!wasBlocked && logRetention.getBlockedBytes() > 0) {
+    logFSWarning(TimeKeeper::tkNow(), MSG_LOGS_BLOCKED, logRetention.getBlockedBytes());
+  }
+  if (LogCatalog::dropped() > uncatalogedLogged) {
+    logFSWarning(TimeKeeper::tkNow(), MSG_LOGS_UNCATALOGED, LogCatalog::dropped());
+  }
+  uncatalogedLogged = LogCatalog::dropped();
+  msgLog.commitDue(Hal::halMillis());
+  unsigned long timeBeforeTest = Hal::halMillis();
   if (irrigData.isIrrigating) {
-    while((millis() - timeBeforeTest) < SENSOR_READ_DELAY) {
+    while(irrigData.isIrrigating && (Hal::halMillis() - timeBeforeTest) < SENSOR_READ_DELAY) {
       //esperando 60 segundos para comecar a verificar status da agua
       //verificando status da irrigacao
-      const unsigned long irrigTimeSecs = TimeKeeper::tkNow() - irrigData.irrigSince;
-      if (irrigTimeSecs > 60) { //FIXME 60 should be conf param
+      //each zone settles on its own, a switch may have restarted the pump
+      const unsigned long zoneTimeSecs = TimeKeeper::tkNow() - zoneScheduler.getZoneSince();
+      if (this->waterControl.isDoseReached()) {
+        //the flow ISR already stopped the pump on the last pulse of the dose, unless another zone is queued
+        endZoneIrrigation(TimeKeeper::tkNow(), STOPIRRIG_DOSEREACHED);
+      } else if (zoneTimeSecs > mainConfParams.flowSettleSecs || this->waterControl.isFlowCollapsed()) {
+        //a collapse of the flow is reported at once, the rate only after the flow settles
         WaterCurrSensorStatus statusWater = this->waterControl.currStatus();
         if(statusWater != WATER_CURRFLOWING) {
           //something wrong, log it
           time_t timeStamp = TimeKeeper::tkNow();
           char tsStr[16];
           snprintf_P(tsStr, 16, TS_FMT_STR, this->timeKeeper.tkYear(timeStamp), this->timeKeeper.tkMonth(timeStamp), this->timeKeeper.tkDay(timeStamp), this->timeKeeper.tkHour(timeStamp), this->timeKeeper.tkMinute(timeStamp), this->timeKeeper.tkSecond(timeStamp));
-          File logFile = getCurrMsgFile(timeStamp);
-          if (logFile) {
-            logFile.print(tsStr);
-            logFile.print(',');
-            logFile.print(MSG_ERR);
-            logFile.print(',');
-            logFile.print(MSG_INCONSIST_WATER_CURRSTATUS);
-            logFile.print(',');
-            logFile.print(statusWater); //status was this
-            logFile.print(',');
-            logFile.println(WATER_CURRFLOWING); //but should be that
-            logFile.flush();
-            logFile.close();
+          if (msgLog.beginRecord(timeStamp)) {
+            msgLog.print(tsStr);
+            msgLog.print(',');
+            msgLog.print(MSG_ERR);
+            msgLog.print(',');
+            msgLog.print(MSG_INCONSIST_WATER_CURRSTATUS);
+            msgLog.print(',');
+            msgLog.print(statusWater); //status was this
+            msgLog.print(',');
+            msgLog.println(WATER_CURRFLOWING); //but should be that
           }
           stopIrrigationAndLog(timeStamp, STOPIRRIG_WATEREMPTY);
         }
-      } else yield();
+      }
+      if (learnFlowStatus == LFLOW_INPROGRESS) stepLearnFlow();
+      taskDelay(IRRIG_CHECK_DELAY);
       //LIGAR O RESULTADO DE SE TEM AGUA NO MULTIPLEXADOR DE ENTRADA E LIBERAR O PINO
       //QUE ESTA SENDO USADO PARA LIGAR A BOMBA
       //ALEM DISSO TEM  O D8 QUE SERA USADO PARA LIGAR O SENSOR
       //LIGAR O SENSOR SEPARADO DA BOMBA PERMITE VERIFICAR SE ELA DESLIGOU DE VERDADE
       //VERIFICAR COMO DEVE SER A LIGAÇÃO DO RELE DE ESTADO SOLIDO, TENSAO, CORRENTE ETC.
     }
+  } else if (learnFlowStatus == LFLOW_INPROGRESS) {
+    while(learnFlowStatus == LFLOW_INPROGRESS && (Hal::halMillis() - timeBeforeTest) < SENSOR_READ_DELAY) {
+      stepLearnFlow();
+      taskDelay(FLOW_LEARN_STEP_MS);
+    }
+    if ((Hal::halMillis() - timeBeforeTest) < SENSOR_READ_DELAY) {
+      taskDelay(SENSOR_READ_DELAY - (Hal::halMillis() - timeBeforeTest));
+    }
   } else {
-    this->delay(SENSOR_READ_DELAY);
+    taskDelay(SENSOR_READ_DELAY);
   }
   this->timeKeeper.syncTime();
 }
 
+void SensorTask::stepLearnFlow() {
+  switch (this->waterControl.stepConfigureFlow()) {
+    case FLEARN_DONE:
+      learnFlowStatus = LFLOW_DONE;
+      break;
+    case FLEARN_ERROR:
+    case FLEARN_IDLE:
+      learnFlowStatus = LFLOW_ERROR;
+      break;
+    default:
+      break;
+  }
+}
+
+float SensorTask::getMoistureIQR(SensorType sType) {
+  return float(moistureIQRs[sType])/MOISTURE_Q16_ONE;
+}
+
 SensorTask::SensorTask() : Task() {
 //  pinMode(NOWATER_SWITCH_PIN, INPUT);
-  pinMode(FLOWSIGNAL_PIN, INPUT);
-  pinMode(PUMP_PIN, OUTPUT);
-  digitalWrite(PUMP_PIN, LOW);
-  pinMode(DECOD_A0_PIN, OUTPUT);
-  pinMode(DECOD_A1_PIN, OUTPUT);
-  pinMode(DECOD_A2_PIN, OUTPUT);
+  Hal::halPinMode(FLOWSIGNAL_PIN, INPUT);
+  Hal::halPinMode(PUMP_PIN, OUTPUT);
+  Hal::halDigitalWrite(PUMP_PIN, LOW);
+  MuxArbiter::begin();
   
   currSensorDirection = LEFT;
-  pinMode(MUL_DECOD_INHIB_PIN, OUTPUT);
-  disableMulAndDecod();
-  pinMode(MULA_PIN, OUTPUT);
-  pinMode(MULB_PIN, OUTPUT);
-  pinMode(MULC_PIN, OUTPUT);
   if (!fsOpen) {
     Serial.println(F("WARNING: filesystem open failed!"));
   } else {
@@ -984,6 +1138,13 @@ SensorTask::SensorTask() : Task() {
       Serial.println(F("ERROR: Unable to read main configuration parameters"));
     }
 
+    CalibParams *calibReadParams = readCalibParams();
+    if (calibReadParams != NULL) {
+      Serial.println(F("INFO: Calibration parameters successfully read"));
+    } else {
+      Serial.println(F("WARNING: Unable to read calibration parameters, using defaults"));
+    }
+
     if (!readFSIrrigData(irrigData)) {
       Serial.println(F("WARNING: Unable to read irrigData"));
     } else {
@@ -992,15 +1153,15 @@ SensorTask::SensorTask() : Task() {
   }
   requestLearn = false;
   learnFlowStatus = LFLOW_NOTREQUESTED;
+  flowLearner = &this->waterControl.getFlowLearner();
   static NTPClient::DelayHandlerFunction delayHandler = std::bind(SensorTask::multiTaskDelay, this, std::placeholders::_1);
   this->timeKeeper.setDelayFunction(delayHandler);
-  this->waterControl.setDelayFunction(delayHandler);
   
   Serial.println(F("SETUP SENSOR MODE"));
 }
 
 void SensorTask::multiTaskDelay(SensorTask *taskServer, unsigned long ms) {
-  taskServer->delay(ms);
+  taskServer->taskDelay(ms);
 }
 
 void SensorTask::asyncLearnNormalFlow() {
@@ -1011,21 +1172,49 @@ AsyncLearnFlowStatus SensorTask::getLastLearnFlowStatus() {
   return learnFlowStatus;
 }
 
+const FlowLearner& SensorTask::getFlowLearner() {
+  return *flowLearner;
+}
+
 void SensorTask::resetLearnFlowStatus() {
-  learnFlowStatus = LFLOW_NOTREQUESTED;
+  //a learning in progress still owns the pump, it ends by itself
+  if (learnFlowStatus != LFLOW_INPROGRESS) learnFlowStatus = LFLOW_NOTREQUESTED;
 }
 
-bool SensorTask::startIrrigationAndLog(time_t aTime, const SoilMoisture& moist) {
+void SensorTask::beginZoneIrrigation(time_t aTime, uint8_t zone) {
+  irrigData.surfaceAtStartIrrig = zoneMoistures.surface[zone];
+  irrigData.middleAtStartIrrig = zoneMoistures.middle[zone];
+  irrigData.deepAtStartIrrig = zoneMoistures.deep[zone];
+  irrigData.irrigZone = zone;
+  zoneScheduler.beginZone(zone, aTime);
+  surfaceDrying[zone].reset();
+  middleDrying[zone].reset();
+  zoneSlotSeconds = mainConfParams.irrSlotSeconds;
+  if (mainConfParams.hasDosing()) {
+    const float liters = doseLiters(zone);
+    this->waterControl.setDoseLiters(liters, !zoneScheduler.hasPending());
+    //the slot is stretched to the whole dose at the normal flow, one larger slot instead of several
+    if (mainConfParams.normalPulsesPerSec > 0) {
+      const unsigned long doseSeconds = liters*mainConfParams.pulsesPerLiter/mainConfParams.normalPulsesPerSec;
+      if (doseSeconds > zoneSlotSeconds) zoneSlotSeconds = doseSeconds;
+    }
+  }
+}
+
+bool SensorTask::startIrrigationAndLog(time_t aTime, uint8_t zone) {
+    commitLogs();
+    this->waterControl.selectZone(zone);
     const WaterStartStatus startResult = this->waterControl.startWater();
     MessageTypes msgType;
     if (startResult == WATER_STARTOK) {
-      irrigData.surfaceAtStartIrrig = moist.surface;
-      irrigData.middleAtStartIrrig = moist.middle;
-      irrigData.deepAtStartIrrig = moist.deep;
       irrigData.isIrrigating = true;
       irrigData.irrigSince = aTime;
+      irrigData.irrigLiters = 0;
+      pumpGovernor.started(aTime);
+      beginZoneIrrigation(aTime, zone);
       msgType = MSG_INFO;
     } else {
+      zoneScheduler.clearPending();
       msgType = MSG_WARN;
     }
 
@@ -1033,39 +1222,26 @@ bool SensorTask::startIrrigationAndLog(time_t aTime, const SoilMoisture& moist)
   snprintf_P(tsStr, 16, TS_FMT_STR, this->timeKeeper.tkYear(aTime), this->timeKeeper.tkMonth(aTime), this->timeKeeper.tkDay(aTime), this->timeKeeper.tkHour(aTime), this->timeKeeper.tkMinute(aTime), this->timeKeeper.tkSecond(aTime));
 
   { //write to messages
-    File logFile = getCurrMsgFile(aTime);
-    if (logFile) {
-      logFile.print(tsStr);
-      logFile.print(',');
-      logFile.print(msgType);
-      logFile.print(',');
-      logFile.print(MSG_STARTED_IRRIG);
-      logFile.print(',');
-      logFile.print(WATER_STARTOK); 
-      logFile.print(',');
-      logFile.println(startResult); 
-      logFile.flush();
-      logFile.close();
+    if (msgLog.beginRecord(aTime)) {
+      msgLog.print(tsStr);
+      msgLog.print(',');
+      msgLog.print(msgType);
+      msgLog.print(',');
+      msgLog.print(MSG_STARTED_IRRIG);
+      msgLog.print(',');
+      msgLog.print(WATER_STARTOK); 
+      msgLog.print(',');
+      msgLog.println(startResult); 
     }
   }
 
   { //write moistures to log
-    File logFile = getCurrLogFile(aTime);
-    if (logFile) {
-      logFile.print(tsStr);
-      logFile.print(',');
-      logFile.print(moist.surface);
-      logFile.print(',');
-      logFile.print(moist.middle);
-      logFile.print(',');
-      logFile.print(moist.deep);
-      logFile.print(',');
-      logFile.println(irrigData.isIrrigating ? '1' : '0');
-      logFile.flush();
-      logFile.close();
+    if (writeSensorRecord(aTime, irrigData.isIrrigating)) {
       lastLogWrite = aTime;
     }
   }
+  commitLogs(); //a brown-out from the pump inrush does not lose the start
+  return startResult == WATER_STARTOK;
 }
 
 bool SensorTask::stopIrrigationAndLog(time_t aTime, StopIrrigReason reason) {
@@ -1075,9 +1251,13 @@ bool SensorTask::stopIrrigationAndLog(time_t aTime, StopIrrigReason reason) {
   } else {
     irrigData.irrigTodaySecs = irrigTimeSecs;
   }
+  irrigData.irrigLiters = this->waterControl.pumpedLiters();
+  irrigData.addLiters(aTime, irrigData.irrigLiters);
 
   irrigData.lastIrrigEnd = aTime;
   irrigData.isIrrigating = false;
+  zoneScheduler.endZone(aTime);
+  zoneScheduler.clearPending();
 
   char tsStr[16];
   snprintf_P(tsStr, 16, TS_FMT_STR, this->timeKeeper.tkYear(aTime), this->timeKeeper.tkMonth(aTime), this->timeKeeper.tkDay(aTime), this->timeKeeper.tkHour(aTime), this->timeKeeper.tkMinute(aTime), this->timeKeeper.tkSecond(aTime));
@@ -1085,38 +1265,25 @@ bool SensorTask::stopIrrigationAndLog(time_t aTime, StopIrrigReason reason) {
   const bool updateFSResult = updateFSIrrigData(irrigData);
   
   { //write to messages
-    File logFile = getCurrMsgFile(aTime);
-    if (logFile) {
-      logFile.print(tsStr);
-      logFile.print(',');
-      logFile.print(updateFSResult ? MSG_INFO : MSG_WARN);
-      logFile.print(',');
-      logFile.print(MSG_STOPPED_IRRIG);
-      logFile.print(',');
-      logFile.print(reason); 
-      logFile.print(',');
-      logFile.println(updateFSResult ? 1 : 0); 
-      logFile.flush();
-      logFile.close();
+    if (msgLog.beginRecord(aTime)) {
+      msgLog.print(tsStr);
+      msgLog.print(',');
+      msgLog.print(updateFSResult ? MSG_INFO : MSG_WARN);
+      msgLog.print(',');
+      msgLog.print(MSG_STOPPED_IRRIG);
+      msgLog.print(',');
+      msgLog.print(reason); 
+      msgLog.print(',');
+      msgLog.println(updateFSResult ? 1 : 0); 
     }
   }
 
+  commitLogs(); //the stop record too
   this->waterControl.stopWater();
+  pumpGovernor.stopped(aTime);
 
   { //write moistures to log
-    File logFile = getCurrLogFile(aTime);
-    if (logFile) {
-      logFile.print(tsStr);
-      logFile.print(',');
-      logFile.print(moistures.surface);
-      logFile.print(',');
-      logFile.print(moistures.middle);
-      logFile.print(',');
-      logFile.print(moistures.deep);
-      logFile.print(',');
-      logFile.println('0');
-      logFile.flush();
-      logFile.close();
+    if (writeSensorRecord(aTime, false)) {
       lastLogWrite = aTime;
     }
   }
@@ -1124,3 +1291,46 @@ bool SensorTask::stopIrrigationAndLog(time_t aTime, StopIrrigReason reason) {
   
   return updateFSResult;
 }
+
+void SensorTask::logFSWarning(time_t aTime, MessageCodes code, unsigned long value) {
+  char tsStr[16];
+  snprintf_P(tsStr, 16, TS_FMT_STR, this->timeKeeper.tkYear(aTime), this->timeKeeper.tkMonth(aTime), this->timeKeeper.tkDay(aTime), this->timeKeeper.tkHour(aTime), this->timeKeeper.tkMinute(aTime), this->timeKeeper.tkSecond(aTime));
+  if (!msgLog.beginRecord(aTime)) return;
+  msgLog.print(tsStr);
+  msgLog.print(',');
+  msgLog.print(MSG_WARN);
+  msgLog.print(',');
+  msgLog.print(code);
+  msgLog.print(',');
+  msgLog.println(value);
+}
+
+bool SensorTask::switchZoneAndLog(time_t aTime, uint8_t zone, StopIrrigReason reason) {
+  const int prevZone = zoneScheduler.getCurrZone();
+  commitLogs(); //the valves change and the pump may start again
+  const WaterStartStatus zoneResult = this->waterControl.selectZone(zone);
+  if (zoneResult == WATER_STARTEMPTY) {
+    //the flow collapsed at the end of the previous zone
+    stopIrrigationAndLog(aTime, STOPIRRIG_WATEREMPTY);
+    return false;
+  }
+  if (zoneResult == WATER_STARTOK) pumpGovernor.started(aTime); //the dose of the previous zone had stopped it
+  beginZoneIrrigation(aTime, zone);
+
+  char tsStr[16];
+  snprintf_P(tsStr, 16, TS_FMT_STR, this->timeKeeper.tkYear(aTime), this->timeKeeper.tkMonth(aTime), this->timeKeeper.tkDay(aTime), this->timeKeeper.tkHour(aTime), this->timeKeeper.tkMinute(aTime), this->timeKeeper.tkSecond(aTime));
+  if (!msgLog.beginRecord(aTime)) return false;
+  msgLog.print(tsStr);
+  msgLog.print(',');
+  msgLog.print(MSG_INFO);
+  msgLog.print(',');
+  msgLog.print(MSG_SWITCHED_ZONE);
+  msgLog.print(',');
+  msgLog.print(reason); //why the previous zone ended
+  msgLog.print(',');
+  msgLog.print(prevZone);
+  msgLog.print(',');
+  msgLog.println(zone);
+  commitLogs(); //a brown-out from the pump inrush does not lose the switch
+  return true;
+}
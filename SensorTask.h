@@ -24,10 +24,20 @@
 #include "FS.h"
 #include <ArduinoJson.h>
 #include "ConfParams.h"
+#include "CalibParams.h"
 #include "WaterController.h"
 #include "global_funcs.h"
+#include "Hal.h"
+#include "ZoneScheduler.h"
+#include "IrrigRules.h"
+#include "PumpGovernor.h"
+#include "LogWriter.h"
+#include "LogRetention.h"
 
 #define MIN_IRRIG_TS 300
+#define IRRIG_CHECK_DELAY 100
+#define CALIB_JSON_SIZE (2*JSON_ARRAY_SIZE(NUM_SENSOR_INPUTS) + JSON_OBJECT_SIZE(3))
+#define CONF_JSON_SIZE (JSON_ARRAY_SIZE(2*MAX_NOIRR_WINDOWS) + JSON_ARRAY_SIZE(MAX_NOIRR_WINDOWS) + 2*JSON_ARRAY_SIZE(MAX_RULE_OPS) + JSON_OBJECT_SIZE(29))
 
 enum StopIrrigReason {
   STOPIRRIG_SLOTEND,
@@ -35,7 +45,9 @@ enum StopIrrigReason {
   STOPIRRIG_MIDDLESAT,
   STOPIRRIG_DEEPINCREASE,
   STOPIRRIG_MAXTIMEDAY,
-  STOPIRRIG_WATEREMPTY
+  STOPIRRIG_WATEREMPTY,
+  STOPIRRIG_MAXVOLUMEDAY,
+  STOPIRRIG_DOSEREACHED
 };
 
 enum MessageTypes {
@@ -50,7 +62,10 @@ enum MessageCodes {
                                  // current status, but another was found. First it
                                  // is logged the status found and after the one expected
   MSG_STOPPED_IRRIG, // this means that we stopped irrigating. It may be just informational.
-  MSG_STARTED_IRRIG 
+  MSG_STARTED_IRRIG,
+  MSG_SWITCHED_ZONE, // the pump went on to another zone. Logged the stop reason of the previous one, then the zones
+  MSG_LOGS_BLOCKED, // log retention cannot free the FS, the cloud has not acknowledged the files. Logged the bytes waiting
+  MSG_LOGS_UNCATALOGED // the log catalog is full and left out its oldest files. Logged how many
 };
 
 enum AsyncLearnFlowStatus {
@@ -61,57 +76,86 @@ enum AsyncLearnFlowStatus {
 };
 
 class SensorTask : public Task {
+#ifdef HOST_BUILD
+  friend class SoilSimulator;
+#endif
+  friend class SensorRuleEvaluator;
 private:
-  float readMoisture(SensorType sType);
+  void scanMoistures(SoilMoisture& frame);
+
+  float moistureFromSamples(SensorType sType, int numSamples, float errValue);
+
+  void readProbeVoltages(SensorType sType, SensorDirection sDir, int& refVoltage, int& afterSensorVoltage);
+
+  //one step of the flow learning, updates the learn flow status
+  void stepLearnFlow();
 
   // the loop function runs over and over again forever
   void loopSensorMode();
   
-  void selectSensor(SensorInput sensor);
-  
   SensorDirection switchSensorDirection();
   
   //bool isWithWater();
   
-  void enableSensorVoltage(SensorType sType, SensorDirection sDir);
-  
-  int readReferenceVoltage(SensorType sType, SensorDirection sDir);
-  
-  int readAfterSensorVoltage(SensorType sType, SensorDirection sDir);
-
-  int readVoltage(SensorType sType, SensorDirection sDirection, SensorInput sensorInput);
-
   static void multiTaskDelay(SensorTask *taskServer, unsigned long ms);
 
-  File getCurrLogFile(time_t nowTime);
-  File getCurrMsgFile(time_t nowTime);
-  static File getFSFileWithDate(time_t nowTime, PGM_P fmtStr, const int bufSize);
+  //task delay, on the host simulator this advances the virtual clock
+  inline void taskDelay(unsigned long ms) {
+#ifdef HOST_BUILD
+    Hal::halDelay(ms);
+#else
+    this->delay(ms);
+#endif
+  }
+
+  static LogWriter sensorLog;
+  static LogWriter msgLog;
+  static void beforeLogOpen();
+  static bool writeSensorRecord(time_t aTime, bool irrigating);
+  static bool isBinarySensorLog(const char* fileName);
 
-  static bool doFSMaintenance(int keepDays);
-  static bool doFSMaintenance(int keepDays, const String& dirName, const String& commonName);
 
   ConfParams *readMainConfParams();
 
-  static time_t toConfTimet(time_t aTime_t);
+  CalibParams *readCalibParams();
 
-  static time_t confParamTime2Timet(const char* timeStr);
+  static void compileMoistureCurves();
 
-  static bool isInNoIrrigTime(time_t aTime);
+  static void compileNoIrrigTimes();
 
-  static bool isInHHMMConfInterval(time_t aTimeInConfTimet, time_t initHHMM, time_t endHHMM);  
+  static int confParamMinute(const char* timeStr);
+
+  static bool isInNoIrrigTime(time_t aTime);
 
   static unsigned int irrigTodayRemainingSecs();
 
+  static float irrigTodayRemainingLiters();
+
+  static bool hasIrrigTodayBudget(float slotFraction);
+
+  static float doseLiters(uint8_t zone);
+
+  static long secsToCritLevel(uint8_t zone, long maxSecs);
+  static bool zoneDueSoon(uint8_t zone, time_t aTime);
+  static bool zoneNeedsWater(uint8_t zone, time_t aTime);
+  int takeNextDryZone();
+  void beginZoneIrrigation(time_t aTime, uint8_t zone);
+  void endZoneIrrigation(time_t aTime, StopIrrigReason reason);
+  bool switchZoneAndLog(time_t aTime, uint8_t zone, StopIrrigReason reason);
+  void logFSWarning(time_t aTime, MessageCodes code, unsigned long value);
+
   bool fulfillMinIrrigInterval(time_t aTime);
 
   TimeKeeper timeKeeper;
 
   WellPumpWaterController waterControl;
 
+  ZoneScheduler zoneScheduler;
+
   inline static bool isValidMoisture(float percent) { return (percent >= 0) && (percent <= 100); }
 
   bool stopIrrigationAndLog(time_t aTime, enum StopIrrigReason);
-  bool startIrrigationAndLog(time_t aTime, const SoilMoisture& moist);
+  bool startIrrigationAndLog(time_t aTime, uint8_t zone);
   static File getFSFileWithDateForRead(time_t aTime, PGM_P fmtStr, const int bufSize);
 
 protected:
@@ -124,15 +168,29 @@ public:
     static bool updateConfParams(const ConfParams &newParams);
     static void asyncLearnNormalFlow();
     static AsyncLearnFlowStatus getLastLearnFlowStatus();
+    //samples, mean and stddev of the last flow learning
+    static const FlowLearner& getFlowLearner();
     static void resetLearnFlowStatus();
-    static File getLogFileWithDate(time_t theDate);
-    static File getMsgFileWithDate(time_t theDate);
+    //aTime itself or the start of the first minute after it out of the no irrigation times, 0 if there is none
+    static time_t nextIrrigAllowedTime(time_t aTime);
+    //aTime itself or the start of the last minute before it out of the no irrigation times, 0 if there is none
+    static time_t lastIrrigAllowedTime(time_t aTime);
+    //predicates looked at by the last run of the irrigation rules
+    static const IrrigTrace& getLastIrrigTrace();
+    static const PumpGovernor& getPumpGovernor();
+    static const LogRetention& getLogRetention();
+    static void commitLogs();
     static bool isLogFileName(const String& str);
     static bool isMsgFileName(const String& str);
     static bool getLogfileDMY(const String& logStr, int& day, int& month, int&year);
     static bool getMsgfileDMY(const String& msgStr, int& day, int& month, int&year);
     static File getMsgFileWithDateForRead(time_t theDate);
     static File getLogFileWithDateForRead(time_t theDate);
+    //interquartile range of the moisture samples in the last read of sType
+    static float getMoistureIQR(SensorType sType);
+    static JsonObject& createJsonFromCalibParams(DynamicJsonBuffer& jsonBuffer);
+    static void updateCalibParamsFromJson(CalibParams& calibStruct, JsonObject& jsonCalibParamsRoot);
+    static bool updateCalibParams(const CalibParams &newParams);
 };
 
 
@@ -25,6 +25,8 @@
 #include <NTPClient.h>
 #include "TimeKeeper.h"
 #include "SensorTask.h"
+#include "SensorLog.h"
+#include "LogCatalog.h"
 #include "DirStream.h"
 #include "WiFiTask.h"
 #include "CloudTask.h"
@@ -56,6 +58,8 @@ static const char JSON_F_RESETWATERFSTATUS[] PROGMEM = "/v100/resetWaterFStatus"
 
 static const char JSON_F_MAINCONFPARAMS[] PROGMEM = "/v100/getMainConfParams";
 static const char JSON_F_UPDATEMAINCONFPARAMS[] PROGMEM = "/v100/updateMainConfParams";
+static const char JSON_F_CALIBPARAMS[] PROGMEM = "/v100/getCalibParams";
+static const char JSON_F_UPDATECALIBPARAMS[] PROGMEM = "/v100/updateCalibParams";
 static const char JSON_F_GETLOGDIRCONTENTS[] PROGMEM = "/v100/getLogDirContents";
 static const char JSON_F_GETCSVFILE[] PROGMEM = "/v100/getCSVFile";
 static const char JSON_F_GETSOILMOISTURE[] PROGMEM = "/v100/getSoilMoisture";
@@ -183,8 +187,13 @@ void ServerTask::handleGetMyUTCTime(ServerTask *taskServer) {
 }
 
 void ServerTask::handleGetIrrigData(ServerTask *taskServer) {
-  const size_t bufferSize = JSON_OBJECT_SIZE(7);
+  const size_t bufferSize = JSON_OBJECT_SIZE(19);
   DynamicJsonBuffer jsonBuffer(bufferSize);
+  const time_t nowTime = TimeKeeper::tkNow();
+  const IrrigTrace& trace = SensorTask::getLastIrrigTrace();
+  const PumpGovernor& governor = SensorTask::getPumpGovernor();
+  const String rulePred = (trace.decisive != PRED_NONE) ? String(FPSTR(IrrigProgram::predicateName(trace.decisive))) : String();
+  const float currLiters = irrigData.isIrrigating ? irrigData.irrigLiters : 0;
   
   JsonObject& root = jsonBuffer.createObject();
   root["surfacestirr"] = irrigData.surfaceAtStartIrrig;
@@ -194,6 +203,21 @@ void ServerTask::handleGetIrrigData(ServerTask *taskServer) {
   root["irrigsince"] = irrigData.irrigSince;
   root["lstirrigend"] = irrigData.lastIrrigEnd;
   root["irrigtdaysecs"] = irrigData.irrigTodaySecs;  
+  root["irrigliters"] = irrigData.irrigLiters;
+  root["litersday"] = irrigData.litersOnDate(nowTime) + currLiters;
+  root["liters7days"] = irrigData.litersLastDays(nowTime) + currLiters;
+  root["irrigzone"] = irrigData.irrigZone;
+  //start: rulepred blocked irrigation, stop: rulepred ended the zone. Bit per predicate of the rules
+  root["ruleprog"] = int(trace.kind);
+  root["rulepred"] = rulePred;
+  root["ruleeval"] = trace.evaluated;
+  root["ruletrue"] = trace.values;
+  //pump starts in the last hour and since boot, and what the governor last held (PumpHold)
+  root["startshour"] = governor.startsLastHour(nowTime);
+  root["pumpstarts"] = governor.getTotalStarts();
+  root["pumphold"] = int(governor.getLastHold());
+  //log bytes the FS needs freed but the cloud has not acknowledged, 0 when none
+  root["logblocked"] = (unsigned long)SensorTask::getLogRetention().getBlockedBytes();
   String jsonStr;
   root.printTo(jsonStr);
   String jsonMime = String(FPSTR(WWW_MIME_JSON));
@@ -201,13 +225,28 @@ void ServerTask::handleGetIrrigData(ServerTask *taskServer) {
 }
 
 void ServerTask::handleGetSoilMoisture(ServerTask *taskServer) {
-  const size_t bufferSize = JSON_OBJECT_SIZE(4);
+  const size_t bufferSize = 4*JSON_ARRAY_SIZE(MAX_ZONES) + JSON_ARRAY_SIZE(3) + JSON_OBJECT_SIZE(8);
   DynamicJsonBuffer jsonBuffer(bufferSize);
   JsonObject& root = jsonBuffer.createObject();
+  //zone 0 at the top level, as before the zones
   root["surface"] = moistures.surface;
   root["middle"] = moistures.middle;
   root["deep"] = moistures.deep;
   root["ts"] = moistures.timeStamp;
+  JsonArray& probes = root.createNestedArray("probes");
+  probes.add(moistures.surfaceProbes);
+  probes.add(moistures.middleProbes);
+  probes.add(moistures.deepProbes);
+  JsonArray& zsurface = root.createNestedArray("zsurface");
+  JsonArray& zmiddle = root.createNestedArray("zmiddle");
+  JsonArray& zdeep = root.createNestedArray("zdeep");
+  JsonArray& zts = root.createNestedArray("zts");
+  for (unsigned int zone = 0; zone < mainConfParams.numZones; zone++) {
+    zsurface.add(zoneMoistures.surface[zone]);
+    zmiddle.add(zoneMoistures.middle[zone]);
+    zdeep.add(zoneMoistures.deep[zone]);
+    zts.add(zoneMoistures.timeStamp[zone]);
+  }
   String jsonStr;
   root.printTo(jsonStr);
   String jsonMime = String(FPSTR(WWW_MIME_JSON));
@@ -215,7 +254,7 @@ void ServerTask::handleGetSoilMoisture(ServerTask *taskServer) {
 }
 
 void ServerTask::handleGetMainConfParams(ServerTask *taskServer) {
-  const size_t bufferSize = JSON_ARRAY_SIZE(8) + JSON_OBJECT_SIZE(7);
+  const size_t bufferSize = CONF_JSON_SIZE;
   DynamicJsonBuffer jsonBuffer(bufferSize);
   JsonObject& root = SensorTask::createJsonFromConfParams(jsonBuffer);
   String jsonStr;
@@ -224,14 +263,28 @@ void ServerTask::handleGetMainConfParams(ServerTask *taskServer) {
   return server.send(HTTP_OK, jsonMime.c_str(), jsonStr);
 }
 
+void ServerTask::handleGetCalibParams(ServerTask *taskServer) {
+  DynamicJsonBuffer jsonBuffer(CALIB_JSON_SIZE);
+  JsonObject& root = SensorTask::createJsonFromCalibParams(jsonBuffer);
+  String jsonStr;
+  root.printTo(jsonStr);
+  String jsonMime = String(FPSTR(WWW_MIME_JSON));
+  return server.send(HTTP_OK, jsonMime.c_str(), jsonStr);
+}
+
 void ServerTask::handleGetLogDirContents(ServerTask *taskServer) {
   if (!fsOpen) {
     return sendJsonWithStatusOnly(SERVERTASK_HANDLE_GETLOGDIRCONTENTS_FSNOTOPEN, HTTP_INTERNAL_ERROR);
   }
-  String logDir = String(FPSTR(LOG_DIR));
-  std::shared_ptr<Dir> logDirPtr(new Dir(SPIFFS.openDir(logDir)));
-  DirStream dStream(logDirPtr);
-  streamCSV(dStream);
+  SensorTask::commitLogs(); //sizes with the records still in RAM
+  if (LogCatalog::dropped() > 0) {
+    //the catalog left files out, the directory has them all
+    std::shared_ptr<Dir> logDirPtr(new Dir(SPIFFS.openDir(String(FPSTR(LOG_DIR)))));
+    DirStream dStream(logDirPtr);
+    return streamCSV(dStream);
+  }
+  LogCatalogStream catalogStream;
+  streamCSV(catalogStream);
 }
 
 void ServerTask::handleGetCloudConf(ServerTask *taskServer) {
@@ -259,11 +312,14 @@ void ServerTask::handleGetCSVFile(ServerTask *taskServer) {
     return sendJsonWithStatusOnly(SERVERTASK_HANDLE_GETCSVFILE_NOPARAM_FILE, HTTP_BAD_REQUEST);
   }
   const String fileName = server.arg(fileParamStr);
+  SensorTask::commitLogs();
   File file = SPIFFS.open(fileName, "r");
   if (!file) {
     return sendJsonWithStatusOnly(SERVERTASK_HANDLE_GETCSVFILE_FILENOTFOUND, HTTP_NOT_FOUND);
   }
-  return streamCSV(file, file.size());
+  //binary sensor logs are sent as the CSV they render to, other files as they are
+  SensorLogStream csvStream(file);
+  return streamCSV(csvStream, csvStream.csvSize());
 }
 
 void ServerTask::handleWifiConnectStatus(ServerTask *taskServer) {
@@ -282,7 +338,19 @@ void ServerTask::handleLearnWaterFStatus(ServerTask *taskServer) {
   StaticJsonBuffer<200> jsonBuffer;
   JsonObject& root = jsonBuffer.createObject();
   String jsonStatusName = String(FPSTR(JSON_STATUS));
-  root[jsonStatusName.c_str()] = (int)SensorTask::getLastLearnFlowStatus();
+  const AsyncLearnFlowStatus learnStatus = SensorTask::getLastLearnFlowStatus();
+  root[jsonStatusName.c_str()] = (int)learnStatus;
+  String progressName = String(F("progress"));
+  String samplesName = String(F("samples"));
+  String meanName = String(F("mean"));
+  String stdDevName = String(F("stddev"));
+  if (learnStatus == LFLOW_INPROGRESS || learnStatus == LFLOW_DONE) {
+    const FlowLearner& learner = SensorTask::getFlowLearner();
+    root[progressName.c_str()] = learner.getProgress();
+    root[samplesName.c_str()] = learner.getNumSamples();
+    root[meanName.c_str()] = learner.getMean();
+    root[stdDevName.c_str()] = learner.getStdDev();
+  }
   String jsonStr;
   root.printTo(jsonStr);
 
@@ -343,7 +411,7 @@ void ServerTask::updateUTCTime(ServerTask *taskServer) {
 }
 
 void ServerTask::handleUpdateMainConfParams(ServerTask *taskServer) {
-  const size_t bufferSize = JSON_ARRAY_SIZE(8) + JSON_OBJECT_SIZE(7);
+  const size_t bufferSize = CONF_JSON_SIZE;
   DynamicJsonBuffer jsonBuffer(bufferSize);
   JsonObject& root = jsonBuffer.parseObject(server.arg("plain"));
   ConfParams newParams;
@@ -358,6 +426,20 @@ void ServerTask::handleUpdateMainConfParams(ServerTask *taskServer) {
   
 }
 
+void ServerTask::handleUpdateCalibParams(ServerTask *taskServer) {
+  DynamicJsonBuffer jsonBuffer(CALIB_JSON_SIZE + 200);
+  JsonObject& root = jsonBuffer.parseObject(server.arg("plain"));
+  CalibParams newParams;
+  SensorTask::updateCalibParamsFromJson(newParams, root);
+  if (!newParams.isAllValid()) {
+    return sendJsonWithStatusOnly(SERVERTASK_HANDLE_UPDATECALIBPARAMS_INVALIDPARAMS, HTTP_BAD_REQUEST);
+  }
+  if (!SensorTask::updateCalibParams(newParams)) {
+    return sendJsonWithStatusOnly(SERVERTASK_HANDLE_UPDATECALIBPARAMS_ERRORWRITEJSON, HTTP_INTERNAL_ERROR);
+  }
+  return sendJsonWithStatusOnly(SERVERTASK_OK, HTTP_OK);
+}
+
 void ServerTask::handleUpdateCloudConf(ServerTask *taskServer) {
     DynamicJsonBuffer jsonBuffer(CloudTask::jsonBufferCapacity);
     JsonObject& root = jsonBuffer.parseObject(server.arg("plain"));
@@ -564,6 +646,12 @@ ServerTask::ServerTask() : Task() {
   static ESP8266WebServer::THandlerFunction myHandleUpdateMainConfParams = std::bind(ServerTask::authenticateAndExecute, this, ServerTask::handleUpdateMainConfParams);
   server.on(String(FPSTR(JSON_F_UPDATEMAINCONFPARAMS)), HTTP_POST, myHandleUpdateMainConfParams);
 
+  static ESP8266WebServer::THandlerFunction myHandleGetCalibParams = std::bind(ServerTask::authenticateAndExecute, this, ServerTask::handleGetCalibParams);
+  server.on(String(FPSTR(JSON_F_CALIBPARAMS)), HTTP_GET, myHandleGetCalibParams);
+
+  static ESP8266WebServer::THandlerFunction myHandleUpdateCalibParams = std::bind(ServerTask::authenticateAndExecute, this, ServerTask::handleUpdateCalibParams);
+  server.on(String(FPSTR(JSON_F_UPDATECALIBPARAMS)), HTTP_POST, myHandleUpdateCalibParams);
+
   static ESP8266WebServer::THandlerFunction myHandleGetLogDirContents = std::bind(ServerTask::authenticateAndExecute, this, ServerTask::handleGetLogDirContents);
   server.on(String(FPSTR(JSON_F_GETLOGDIRCONTENTS)), HTTP_GET, myHandleGetLogDirContents);
 
@@ -58,7 +58,9 @@ enum ServerTaskStatusCodes {
   SERVERTASK_HANDLE_GETCLOUDCONF_NOCONF = -17,
   SERVERTASK_HANDLE_GETCLOUDCONF_FSNOTOPEN = -18,
   CLOUDTASK_HANDLE_UPDATECONFPARAMS_INVALIDPARAMS = -19,
-  CLOUDTASK_HANDLE_UPDATECONFPARAMS_ERRORWRITEJSON = -20
+  CLOUDTASK_HANDLE_UPDATECONFPARAMS_ERRORWRITEJSON = -20,
+  SERVERTASK_HANDLE_UPDATECALIBPARAMS_INVALIDPARAMS = -21,
+  SERVERTASK_HANDLE_UPDATECALIBPARAMS_ERRORWRITEJSON = -22
 };
 
 enum HTTPStatus {
@@ -82,6 +84,8 @@ private:
   static void handleWifiConnectStatus(ServerTask *taskServer);
   static void handleGetMainConfParams(ServerTask *taskServer);
   static void handleUpdateMainConfParams(ServerTask *taskServer);
+  static void handleGetCalibParams(ServerTask *taskServer);
+  static void handleUpdateCalibParams(ServerTask *taskServer);
   static void handleGetLogDirContents(ServerTask *taskServer);
   static void handleGetCSVFile(ServerTask *taskServer);
   static void handleLearnWaterFlow(ServerTask *taskServer);
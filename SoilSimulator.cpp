@@ -0,0 +1,272 @@
+/**
+ * IIRR -- Intelligent Irrigator Based on ESP8266
+    Copyright (C) 2016--2019  Sergio Queiroz <srmq@cin.ufpe.br>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "SoilSimulator.h"
+
+#ifdef HOST_BUILD
+
+#include "SensorTask.h"
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+
+#define SIM_STEP_US 100000ull
+#define MIN_SIM_MOISTURE 0.005
+
+SimParams::SimParams() : evapPerHour(0.03), uptakePerHour(0.005), pumpLitersPerMin(10),
+    pulsesPerLiter(450), wellLiters(2000), wellRechargePerMin(5), adcReference(1000),
+    adcNoise(4), startTime(1546300800), seed(1) { //2019-01-01 00:00:00 UTC
+  const double initial[3] = {0.5, 0.6, 0.7};
+  const double capacity[3] = {0.7, 0.75, 0.8};
+  const double drain[3] = {0.5, 0.3, 0.1};
+  const double liters[3] = {20, 40, 60};
+  for (int i = 0; i < 3; i++) {
+    initialMoisture[i] = initial[i];
+    fieldCapacity[i] = capacity[i];
+    drainPerHour[i] = drain[i];
+    layerLiters[i] = liters[i];
+  }
+}
+
+SoilSimulator::SoilSimulator(const SimParams& params) : simParams(params), stats(), nowUs(0),
+    timeOffset(0), flowISR(NULL), wellLiters(params.wellLiters), pulsePhase(0),
+    physicsPendingSecs(0), critLevel(0), cycleStartUs(0), waterSinceUs(0), waterPending(false),
+    rngState(params.seed != 0 ? params.seed : 1) {
+  memset(pinLevels, 0, sizeof(pinLevels));
+  pinLevels[MUL_DECOD_INHIB_PIN] = HIGH;
+  for (int i = 0; i < 3; i++) {
+    moist[i] = params.initialMoisture[i];
+  }
+}
+
+SoilSimulator::~SoilSimulator() {
+}
+
+void SoilSimulator::pinMode(uint8_t pin, uint8_t mode) {
+}
+
+void SoilSimulator::digitalWrite(uint8_t pin, uint8_t val) {
+  if (pin >= HAL_NUM_PINS) return;
+  const uint8_t newLevel = (val == LOW) ? LOW : HIGH;
+  if (pin == PUMP_PIN && newLevel == HIGH && pinLevels[pin] == LOW) {
+    stats.pumpStarts++;
+    if (!irrigData.isIrrigating) {
+      //a start of the rules, asked for by an earlier cycle or by this one
+      const double latencySecs = (nowUs - (waterPending ? waterSinceUs : cycleStartUs))/1e6;
+      stats.decisions++;
+      stats.sumDecisionLatencySecs += latencySecs;
+      stats.maxDecisionLatencySecs = std::max(stats.maxDecisionLatencySecs, latencySecs);
+      if (moist[SURFACE] > critLevel && moist[MIDDLE] > critLevel) stats.earlyStarts++;
+      waterPending = false;
+    }
+  }
+  pinLevels[pin] = newLevel;
+}
+
+int SoilSimulator::digitalRead(uint8_t pin) {
+  return (pin < HAL_NUM_PINS) ? pinLevels[pin] : LOW;
+}
+
+int SoilSimulator::decoderOutput() const {
+  if (pinLevels[MUL_DECOD_INHIB_PIN] == HIGH) return -1;
+  return pinLevels[DECOD_A0_PIN] | (pinLevels[DECOD_A1_PIN] << 1) | (pinLevels[DECOD_A2_PIN] << 2);
+}
+
+int SoilSimulator::muxInput() const {
+  if (pinLevels[MUL_DECOD_INHIB_PIN] == HIGH) return -1;
+  return pinLevels[MULA_PIN] | (pinLevels[MULB_PIN] << 1) | (pinLevels[MULC_PIN] << 2);
+}
+
+bool SoilSimulator::pumpIsOn() const {
+  return pinLevels[PUMP_PIN] == HIGH;
+}
+
+bool SoilSimulator::flowSensorIsOn() const {
+  return decoderOutput() == FLOWSENSOR_DECODER_OUTPUT;
+}
+
+//inverse of the default calibration curve of sensor_calibration.h
+double SoilSimulator::resistance(int depth) const {
+  const double m = std::max(moist[depth], MIN_SIM_MOISTURE);
+  return MOISTURE_MULX/pow(m, MOISTURE_EXPFACT);
+}
+
+int SoilSimulator::noise() {
+  rngState ^= (rngState << 13) & 0xFFFFFFFFul;
+  rngState ^= rngState >> 17;
+  rngState ^= (rngState << 5) & 0xFFFFFFFFul;
+  if (simParams.adcNoise <= 0) return 0;
+  return (int)(rngState % (simParams.adcNoise + 1)) - simParams.adcNoise/2;
+}
+
+int SoilSimulator::analogRead(uint8_t pin) {
+  if (pin != ANALOG_PIN) return 0;
+  const int driven = decoderOutput();
+  const int selected = muxInput();
+  double volts = 0;
+  if (driven >= 0 && driven < 6 && selected >= 0 && selected < 6 && (driven/2) == (selected/2)) {
+    //decoder outputs and mux inputs follow SensorType*2 + SensorDirection
+    volts = simParams.adcReference;
+    if ((driven % 2) != (selected % 2)) {
+      volts = volts*REFERENCE_RESISTOR/(REFERENCE_RESISTOR + resistance(driven/2));
+    }
+  }
+  const int readVal = (int)(volts + 0.5) + noise();
+  return std::min(1023, std::max(0, readVal));
+}
+
+unsigned long SoilSimulator::millis() {
+  return (unsigned long)(nowUs/1000ull);
+}
+
+unsigned long SoilSimulator::micros() {
+  return (unsigned long)nowUs;
+}
+
+void SoilSimulator::delay(unsigned long ms) {
+  advance(ms*1000ull);
+}
+
+time_t SoilSimulator::now() {
+  return simParams.startTime + timeOffset + (time_t)(nowUs/1000000ull);
+}
+
+void SoilSimulator::setNow(time_t aTime) {
+  timeOffset = aTime - simParams.startTime - (time_t)(nowUs/1000000ull);
+}
+
+void SoilSimulator::attachInterrupt(uint8_t pin, HalISR isr, int mode) {
+  if (pin == FLOWSIGNAL_PIN) flowISR = isr;
+}
+
+void SoilSimulator::detachInterrupt(uint8_t pin) {
+  if (pin == FLOWSIGNAL_PIN) flowISR = NULL;
+}
+
+double SoilSimulator::currFlowLitersPerMin() const {
+  return (pumpIsOn() && wellLiters > 0) ? simParams.pumpLitersPerMin : 0;
+}
+
+void SoilSimulator::advance(unsigned long long us) {
+  const unsigned long long endUs = nowUs + us;
+  while (nowUs < endUs) {
+    const unsigned long long stepUs = std::min(endUs - nowUs, SIM_STEP_US);
+    const unsigned long long stepEnd = nowUs + stepUs;
+    emitPulses(stepUs);
+    nowUs = stepEnd;
+    physicsPendingSecs += stepUs/1e6;
+    if (physicsPendingSecs >= 1.0) {
+      stepPhysics(physicsPendingSecs);
+      physicsPendingSecs = 0;
+    }
+  }
+}
+
+//fires the flow ISR at the virtual time of each pulse
+void SoilSimulator::emitPulses(unsigned long long stepUs) {
+  const double rate = flowSensorIsOn() ? currFlowLitersPerMin()/60.0*simParams.pulsesPerLiter : 0;
+  if (rate <= 0) return;
+  const unsigned long long startUs = nowUs;
+  const double secs = stepUs/1e6;
+  double elapsed = 0;
+  double toNext = (1.0 - pulsePhase)/rate;
+  while (elapsed + toNext <= secs) {
+    elapsed += toNext;
+    pulsePhase = 0;
+    nowUs = startUs + (unsigned long long)(elapsed*1e6);
+    if (flowISR != NULL) flowISR();
+    toNext = 1.0/rate;
+  }
+  pulsePhase += (secs - elapsed)*rate;
+}
+
+void SoilSimulator::stepPhysics(double secs) {
+  const double hours = secs/3600.0;
+  double water = 0;
+  if (pumpIsOn()) {
+    stats.pumpOnSecs += secs;
+    water = std::min(simParams.pumpLitersPerMin*secs/60.0, wellLiters);
+    if (water <= 0) stats.dryRunSecs += secs;
+    wellLiters -= water;
+    stats.litersUsed += water;
+  }
+  wellLiters = std::min(simParams.wellLiters, wellLiters + simParams.wellRechargePerMin*secs/60.0);
+
+  //infiltration from the surface down, excess over saturation goes to the next layer
+  for (int i = 0; i < 3 && water > 0; i++) {
+    const double absorbed = std::min((1.0 - moist[i])*simParams.layerLiters[i], water);
+    moist[i] += absorbed/simParams.layerLiters[i];
+    water -= absorbed;
+  }
+
+  for (int i = 0; i < 3; i++) {
+    const double excess = moist[i] - simParams.fieldCapacity[i];
+    if (excess > 0) {
+      const double moved = excess*std::min(1.0, simParams.drainPerHour[i]*hours);
+      moist[i] -= moved;
+      if (i < 2) moist[i+1] += moved*simParams.layerLiters[i]/simParams.layerLiters[i+1];
+    }
+  }
+
+  //evaporation follows the sun, roots take water from middle and deep
+  const double hourOfDay = (now() % 86400)/3600.0;
+  const double sun = std::max(0.0, sin(M_PI*(hourOfDay - 6.0)/12.0));
+  moist[SURFACE] -= moist[SURFACE]*std::min(1.0, simParams.evapPerHour*sun*hours);
+  moist[MIDDLE] -= moist[MIDDLE]*std::min(1.0, simParams.uptakePerHour*hours);
+  moist[DEEP] -= moist[DEEP]*std::min(1.0, 0.5*simParams.uptakePerHour*hours);
+  for (int i = 0; i < 3; i++) {
+    moist[i] = std::min(1.0, std::max(0.0, moist[i]));
+  }
+}
+
+//decision latency: from the first sensor cycle where the controller found a
+//zone in need of water, on its own readings or forecast, until the pump
+//starts. The start is held meanwhile by the pump governor or a no
+//irrigation time
+void SoilSimulator::checkWaterRequest(SensorTask& task) {
+  if (pumpIsOn() || irrigData.isIrrigating) {
+    waterPending = false;
+    return;
+  }
+  bool needsWater = false;
+  for (uint8_t zone = 0; zone < task.zoneScheduler.getNumZones(); zone++) {
+    if (SensorTask::zoneNeedsWater(zone, now())) needsWater = true;
+  }
+  if (!needsWater) {
+    waterPending = false;
+  } else if (!waterPending) {
+    waterPending = true;
+    waterSinceUs = cycleStartUs;
+  }
+}
+
+const SimStats& SoilSimulator::run(SensorTask& task, const ConfParams& params, unsigned long days) {
+  mainConfParams = params;
+  SensorTask::compileNoIrrigTimes();
+  critLevel = params.critLevel;
+  const unsigned long long endUs = nowUs + days*86400ull*1000000ull;
+  while (nowUs < endUs) {
+    cycleStartUs = nowUs;
+    task.loop();
+    stats.sensorCycles++;
+    checkWaterRequest(task);
+  }
+  return stats;
+}
+
+#endif
@@ -0,0 +1,133 @@
+/**
+ * IIRR -- Intelligent Irrigator Based on ESP8266
+    Copyright (C) 2016--2019  Sergio Queiroz <srmq@cin.ufpe.br>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef _SOIL_SIMULATOR_H_
+#define _SOIL_SIMULATOR_H_
+
+#include "Hal.h"
+
+#ifdef HOST_BUILD
+
+#include "sensor_calibration.h"
+#include "ConfParams.h"
+
+class SensorTask;
+
+//Physical parameters of the simulated plot, well and pump.
+//Soil water is kept as relative saturation (0 to 1) per depth.
+class SimParams {
+public:
+  double initialMoisture[3];
+  double fieldCapacity[3];     //above this, water drains to the layer below
+  double drainPerHour[3];      //fraction of the excess that drains per hour
+  double layerLiters[3];       //liters that take a layer from dry to saturated
+  double evapPerHour;          //surface evaporation at noon, fraction per hour
+  double uptakePerHour;        //root uptake from middle and deep
+  double pumpLitersPerMin;
+  double pulsesPerLiter;
+  double wellLiters;           //water available in the well when full
+  double wellRechargePerMin;   //liters per minute flowing back into the well
+  int adcReference;            //ADC reading at the driven side of a probe
+  int adcNoise;                //peak to peak noise added to every ADC read
+  time_t startTime;
+  unsigned long seed;
+
+  SimParams();
+};
+
+class SimStats {
+public:
+  unsigned long sensorCycles;
+  unsigned long pumpStarts;
+  double pumpOnSecs;
+  double dryRunSecs;
+  double litersUsed;
+  unsigned long decisions;     //pump starts of the irrigation rules, not restarts for the next zone
+  double sumDecisionLatencySecs; //from the sensor cycle that first asked for water to the start
+  double maxDecisionLatencySecs;
+  unsigned long earlyStarts;   //decisions with the true levels still above critLevel
+
+  SimStats() : sensorCycles(0), pumpStarts(0), pumpOnSecs(0), dryRunSecs(0), litersUsed(0),
+               decisions(0), sumDecisionLatencySecs(0), maxDecisionLatencySecs(0), earlyStarts(0) { }
+};
+
+//HAL backend with a virtual clock that models the three probe depths,
+//the well pump on PUMP_PIN and the flow sensor on FLOWSIGNAL_PIN.
+//Usage:
+//  SoilSimulator sim(simParams);
+//  Hal::setBackend(&sim);
+//  SensorTask sensorTask;
+//  sim.run(sensorTask, confParams, 30);
+//  //then look at sim.getStats()
+class SoilSimulator : public HalBackend {
+public:
+  SoilSimulator(const SimParams& params);
+  virtual ~SoilSimulator();
+
+  virtual void pinMode(uint8_t pin, uint8_t mode) override;
+  virtual void digitalWrite(uint8_t pin, uint8_t val) override;
+  virtual int digitalRead(uint8_t pin) override;
+  virtual int analogRead(uint8_t pin) override;
+  virtual unsigned long millis() override;
+  virtual unsigned long micros() override;
+  virtual void delay(unsigned long ms) override;
+  virtual time_t now() override;
+  virtual void setNow(time_t aTime) override;
+  virtual void attachInterrupt(uint8_t pin, HalISR isr, int mode) override;
+  virtual void detachInterrupt(uint8_t pin) override;
+
+  //runs SensorTask::loop() cycles until days of virtual time have elapsed
+  const SimStats& run(SensorTask& task, const ConfParams& params, unsigned long days);
+
+  void advance(unsigned long long us);
+  inline double moisture(SensorType sType) const { return moist[sType]; }
+  inline double wellLevel() const { return wellLiters; }
+  inline const SimStats& getStats() const { return stats; }
+
+private:
+  SimParams simParams;
+  SimStats stats;
+  unsigned long long nowUs;
+  time_t timeOffset;
+  uint8_t pinLevels[HAL_NUM_PINS];
+  HalISR flowISR;
+  double moist[3];
+  double wellLiters;
+  double pulsePhase;
+  double physicsPendingSecs;
+  double critLevel;
+  unsigned long long cycleStartUs;
+  unsigned long long waterSinceUs;
+  bool waterPending;
+  unsigned long rngState;
+
+  bool pumpIsOn() const;
+  bool flowSensorIsOn() const;
+  int decoderOutput() const;
+  int muxInput() const;
+  double resistance(int depth) const;
+  double currFlowLitersPerMin() const;
+  void stepPhysics(double secs);
+  void emitPulses(unsigned long long stepUs);
+  void checkWaterRequest(SensorTask& task);
+  int noise();
+};
+
+#endif
+
+#endif
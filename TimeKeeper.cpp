@@ -82,7 +82,7 @@ time_t TimeKeeper::syncTime() {
   }
   if (ntpUpdated || httpUpdated) {
     if (ntpUpdated) newTime = this->ntpTimeClient.getEpochTime();
-    setTime(newTime);
+    tkSetTime(newTime);
   }
   return tkNow();
 }
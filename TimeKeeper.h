@@ -24,6 +24,7 @@
 #include <NTPClient.h>
 #include <TimeLib.h>
 #include <Time.h>
+#include "Hal.h"
 
 
 class TimeKeeper {
@@ -34,20 +35,20 @@ private:
 public:
   TimeKeeper();
   static inline int tkYear() {
-    return year();
+    return year(tkNow());
   }
   static inline int tkYear(time_t ts) {
     return year(ts);
   }
   static inline int tkMonth() {
-    return month();
+    return month(tkNow());
   }
   static inline int tkMonth(time_t ts) {
     return month(ts);
   }
 
   static inline int tkDay() {
-    return day();    
+    return day(tkNow());    
   }
   
   static inline int tkDay(time_t ts) {
@@ -55,7 +56,7 @@ public:
   }
   
   static inline int tkHour() {
-    return hour();
+    return hour(tkNow());
   }
 
   static inline int tkHour(time_t ts) {
@@ -63,14 +64,14 @@ public:
   }
 
   static inline int tkMinute() {
-    return minute();
+    return minute(tkNow());
   }
   static inline int tkMinute(time_t ts) {
     return minute(ts);
   }
   
   static inline int tkSecond() {
-    return second();
+    return second(tkNow());
   }
 
   static inline int tkSecond(time_t ts) {
@@ -79,7 +80,7 @@ public:
 
   
   static inline time_t tkNow() {
-    return now();
+    return Hal::halNow();
   }
 
   inline void setDelayFunction(NTPClient::DelayHandlerFunction delayHandler) {
@@ -100,7 +101,7 @@ public:
   }
 
   static inline void tkSetTime(int aYear, int aMonth, int aDay, int aHour, int aMin, int aSec) {
-    setTime(aHour, aMin, aSec, aDay, aMonth, aYear);
+    tkSetTime(tkMakeTime(aYear, aMonth, aDay, aHour, aMin, aSec));
   }
 
   static inline time_t tkMakeTime(int aYear, int aMonth, int aDay, int aHour, int aMin, int aSec) {
@@ -115,7 +116,7 @@ public:
   }
 
   static inline void tkSetTime(time_t aTime) {
-    setTime(aTime);
+    Hal::halSetNow(aTime);
   }
 
 
@@ -21,26 +21,33 @@
 #include "sensor_calibration.h"
 #include "SensorTask.h"
 #include "global_funcs.h"
-
-static unsigned long pulseCount;
-
-static void ICACHE_RAM_ATTR handleInterrupt() {
-  pulseCount++;
-}
+#include "Hal.h"
+#include "MuxAddress.h"
+#include "MuxArbiter.h"
 
 WaterStartStatus WellPumpWaterController::startWater(bool ignoreNoConf) {
  if(!ignoreNoConf && this->noConfStatus()) return WATER_STARTNOCONF;
  if(this->emptyTriggered) return WATER_STARTEMPTY;
  if(pumpIsOn) return WATER_STARTNOACTION;
 
- digitalWrite(PUMP_PIN, HIGH);
+ FlowMonitor::armCollapseGuard(acceptedMinFlowPerc*mainConfParams.normalPulsesPerSec, GpioMasks(0, pinBit(PUMP_PIN)));
+ Hal::halDigitalWrite(PUMP_PIN, HIGH);
  this->pumpIsOn = true;
+ this->runStartPulses = FlowMonitor::totalPulses();
+ this->carriedPulses = 0;
+ this->dosePulses = 0;
+ turnOnSensor();
  return WATER_STARTOK;
 }
 
 void WellPumpWaterController::stopWater() {
- digitalWrite(PUMP_PIN, LOW);
+ if (this->pumpIsOn) this->runPulses = runTotalPulses();
+ FlowMonitor::disarmDoseStop();
+ this->dosePulses = 0;
+ Hal::halDigitalWrite(PUMP_PIN, LOW);
  this->pumpIsOn = false;
+ turnOffSensor();
+ Hal::halWriteMasks(zoneValveMasks(ZONE_PIN_NONE)); //all closed
 }
 
 WellPumpWaterController::~WellPumpWaterController() {
@@ -51,13 +58,15 @@ WellPumpWaterController::~WellPumpWaterController() {
 WaterCurrSensorStatus WellPumpWaterController::currStatus() {
   if (this->emptyTriggered) return WATER_CURREMPTY;
   if (this->noConfStatus()) return WATER_CURRNOCONF;
-  double avgPulsesSec;
-  turnOnSensor();
-  avgSensorPulsesPerSec();
-  avgPulsesSec = 0.5*avgSensorPulsesPerSec();
-  avgPulsesSec += 0.5*avgSensorPulsesPerSec(); //we call three times, ignoring the first and taking the avg of the last two.
-  turnOffSensor();
-  bool noFlow = (avgPulsesSec <= (acceptedMinFlowPerc*mainConfParams.normalPulsesPerSec));
+  if (this->pumpIsOn && FlowMonitor::hasCollapsed()) {
+    //the guard already cut the pump from the flow ISR
+    stopWater();
+    this->emptyTriggered = true;
+    return WATER_CURREMPTY;
+  }
+  //the flow sensor is powered while the pump is on, until then there is no reading
+  if (!FlowMonitor::hasEstimate()) return this->pumpIsOn ? WATER_CURRFLOWING : WATER_CURRSTOP;
+  bool noFlow = (FlowMonitor::pulsesPerSec() <= (acceptedMinFlowPerc*mainConfParams.normalPulsesPerSec));
   if (!noFlow) {
     return WATER_CURRFLOWING;
   }
@@ -74,62 +83,147 @@ WaterCurrSensorStatus WellPumpWaterController::currStatus() {
   }
 }
 
+bool WellPumpWaterController::isFlowCollapsed() {
+  return this->pumpIsOn && FlowMonitor::hasCollapsed();
+}
+
 void WellPumpWaterController::resetEmpty() {
   this->emptyTriggered = false;
 }
 
-bool WellPumpWaterController::configureFlow() {
-  double avgPulsesSec;
-
-  bool pumpWasOn = this->pumpIsOn;
-  if (!pumpWasOn) {
+bool WellPumpWaterController::startConfigureFlow() {
+  if (flowLearner.isRunning()) return false;
+  this->pumpWasOnBeforeLearn = this->pumpIsOn;
+  if (!pumpWasOnBeforeLearn) {
     if (this->startWater(true) != WATER_STARTOK) {
       return false;
     }
   }
-  delayHandler(30000);
-  this->turnOnSensor();
-  delayHandler(1000);
-  avgSensorPulsesPerSec();
-  avgPulsesSec = 0.5*avgSensorPulsesPerSec();
-  avgPulsesSec += 0.5*avgSensorPulsesPerSec(); //we call three times, ignoring the first and taking the avg of the last two.
-  this->turnOffSensor();
-  if (!pumpWasOn) {
-    this->stopWater();
+  flowLearner.begin(Hal::halMillis());
+  return true;
+}
+
+FlowLearnState WellPumpWaterController::stepConfigureFlow() {
+  if (!flowLearner.isRunning()) return flowLearner.getState();
+  if (!this->pumpIsOn) {
+    //stopped by someone else, or by the collapse guard
+    flowLearner.fail();
+    return flowLearner.getState();
   }
-  mainConfParams.normalPulsesPerSec = (unsigned long)avgPulsesSec;
-  return SensorTask::updateConfParams(mainConfParams);
+  const FlowLearnState learnState = flowLearner.step(Hal::halMillis());
+  if (learnState == FLEARN_DONE || learnState == FLEARN_ERROR) {
+    if (!pumpWasOnBeforeLearn) {
+      this->stopWater();
+    }
+    if (learnState == FLEARN_DONE) {
+      mainConfParams.normalPulsesPerSec = (unsigned long)(flowLearner.getMean() + 0.5);
+      if (!SensorTask::updateConfParams(mainConfParams)) {
+        flowLearner.fail();
+        return FLEARN_ERROR;
+      }
+    }
+  }
+  return learnState;
 }
 
+//the flow sensor is powered through the decoder, probe reads borrow it meanwhile
 void WellPumpWaterController::turnOnSensor() {
-  digitalWrite(DECOD_A0_PIN, LOW);
-  digitalWrite(DECOD_A1_PIN, HIGH);
-  digitalWrite(DECOD_A2_PIN, HIGH);
-  enableMulAndDecod();
+  FlowMonitor::startCoverage();
+  if (!MuxArbiter::acquire(MUX_FLOW, decoderMasks(FLOWSENSOR_DECODER_OUTPUT), flowHandover)) {
+    FlowMonitor::pauseCoverage();
+  }
 }
 
 void WellPumpWaterController::turnOffSensor() {
-  disableMulAndDecod();
+  MuxArbiter::release(MUX_FLOW);
+  FlowMonitor::stopCoverage();
 }
 
+void WellPumpWaterController::flowHandover(bool hasMux) {
+  if (hasMux) {
+    FlowMonitor::resumeCoverage();
+  } else {
+    FlowMonitor::pauseCoverage();
+  }
+}
 
-double WellPumpWaterController::avgSensorPulsesPerSec() {
-  pulseCount = 0;
-  //XXX  chamar codigo de ligar o sensor antes de chamar essa funcao
-  
-  attachInterrupt(digitalPinToInterrupt(FLOWSIGNAL_PIN), handleInterrupt, FALLING);
-  unsigned long startTime = millis();
-  do {
-    delayHandler(50);
-  } while ((millis() - startTime) < 1000);
-  detachInterrupt(digitalPinToInterrupt(FLOWSIGNAL_PIN));
-  double pulsesPerSec = (1000.0/(millis() - startTime))*pulseCount;
-  return pulsesPerSec;
+void WellPumpWaterController::setDoseLiters(float liters, bool stopPump) {
+  this->doseStopsPump = stopPump;
+  if (!this->pumpIsOn || liters <= 0 || mainConfParams.pulsesPerLiter <= 0) {
+    this->dosePulses = 0;
+    FlowMonitor::disarmDoseStop();
+    return;
+  }
+  this->dosePulses = currRunPulses() + liters*mainConfParams.pulsesPerLiter;
+  armDose();
+}
+
+void WellPumpWaterController::setDoseStopsPump(bool stopPump) {
+  if (this->doseStopsPump == stopPump) return;
+  this->doseStopsPump = stopPump;
+  if (this->dosePulses > 0 && !FlowMonitor::isDoseReached()) armDose();
+}
+
+bool WellPumpWaterController::isDoseReached() {
+  return this->pumpIsOn && FlowMonitor::isDoseReached();
+}
+
+void WellPumpWaterController::armDose() {
+  FlowMonitor::armDoseStop(this->runStartPulses + (unsigned long)(this->dosePulses + 0.5),
+                           GpioMasks(0, this->doseStopsPump ? pinBit(PUMP_PIN) : 0));
+}
+
+WaterStartStatus WellPumpWaterController::selectZone(uint8_t zone) {
+  const GpioMasks valveMasks = zoneValveMasks(zone);
+  //the new valve opens before the others close, the pump never runs against closed valves
+  Hal::halWriteMasks(GpioMasks(valveMasks.setMask, 0));
+  Hal::halWriteMasks(valveMasks);
+  if (!this->pumpIsOn) return WATER_STARTOK;
+  if (FlowMonitor::hasCollapsed()) {
+    //the guard cut the pump from the flow ISR, the well is empty
+    stopWater();
+    this->emptyTriggered = true;
+    return WATER_STARTEMPTY;
+  }
+  if (!FlowMonitor::isDoseReached() || Hal::halDigitalRead(PUMP_PIN) == HIGH) return WATER_STARTNOACTION;
+  //the dose of the previous zone stopped it, a new start as in startWater(): the
+  //rate window of the old coverage would read the stop as no flow. The run goes
+  //on, its pulses so far are kept. The dose of the new zone is set by the caller
+  turnOffSensor();
+  FlowMonitor::disarmDoseStop();
+  this->dosePulses = 0;
+  this->carriedPulses += currRunPulses();
+  this->runStartPulses = FlowMonitor::totalPulses();
+  FlowMonitor::armCollapseGuard(acceptedMinFlowPerc*mainConfParams.normalPulsesPerSec, GpioMasks(0, pinBit(PUMP_PIN)));
+  Hal::halDigitalWrite(PUMP_PIN, HIGH);
+  turnOnSensor();
+  return WATER_STARTOK;
+}
+
+float WellPumpWaterController::currRunPulses() {
+  return FlowMonitor::totalPulses() - this->runStartPulses;
+}
+
+float WellPumpWaterController::runTotalPulses() {
+  return this->carriedPulses + currRunPulses();
+}
+
+float WellPumpWaterController::pumpedLiters() {
+  if (mainConfParams.pulsesPerLiter <= 0) return 0;
+  return (this->pumpIsOn ? runTotalPulses() : this->runPulses)/mainConfParams.pulsesPerLiter;
 }
 
 WellPumpWaterController::WellPumpWaterController() : WaterController(), 
     pumpIsOn(false), 
-    emptyTriggered(false){ 
+    emptyTriggered(false),
+    flowLearner(),
+    pumpWasOnBeforeLearn(false),
+    runStartPulses(0),
+    carriedPulses(0),
+    runPulses(0),
+    dosePulses(0),
+    doseStopsPump(true){ 
       
-  digitalWrite(PUMP_PIN, LOW);
+  Hal::halDigitalWrite(PUMP_PIN, LOW);
+  FlowMonitor::begin();
 }
@@ -21,6 +21,10 @@
 
 #include "TimeKeeper.h"
 #include "ConfParams.h"
+#include "Hal.h"
+#include "FlowMonitor.h"
+#include "FlowLearner.h"
+#include "ZoneScheduler.h"
 
 enum WaterStartStatus {
   WATER_STARTOK = 0,
@@ -42,7 +46,21 @@ public:
   virtual void stopWater() = 0;
   virtual WaterCurrSensorStatus currStatus() = 0;
   virtual void resetEmpty() = 0;
-  virtual bool configureFlow() = 0; 
+  //learning of normalPulsesPerSec, stepConfigureFlow() is called from the loop until it returns done or error
+  virtual bool startConfigureFlow() = 0;
+  virtual FlowLearnState stepConfigureFlow() = 0;
+  //cheap check, meant to be polled often while watering
+  virtual bool isFlowCollapsed() = 0;
+  //reached after liters more of the running pump, 0 cancels. With stopPump
+  //the pump stops on the last pulse, else it keeps running for another zone
+  virtual void setDoseLiters(float liters, bool stopPump = true) = 0;
+  virtual void setDoseStopsPump(bool stopPump) = 0;
+  virtual bool isDoseReached() = 0;
+  //opens the valve of zone, a running pump keeps running (WATER_STARTNOACTION),
+  //restarted if the dose of the previous zone stopped it (WATER_STARTOK, as
+  //with the pump off). WATER_STARTEMPTY if the collapse guard stopped it
+  //instead, the pump is then left off
+  virtual WaterStartStatus selectZone(uint8_t zone) = 0;
 
   virtual ~WaterController() = 0;
 };
@@ -55,19 +73,37 @@ public:
   virtual void stopWater() override;
   virtual WaterCurrSensorStatus currStatus() override;
   virtual void resetEmpty() override;
-  virtual bool configureFlow() override;
+  virtual bool startConfigureFlow() override;
+  virtual FlowLearnState stepConfigureFlow() override;
+  virtual bool isFlowCollapsed() override;
+  virtual void setDoseLiters(float liters, bool stopPump = true) override;
+  virtual void setDoseStopsPump(bool stopPump) override;
+  virtual bool isDoseReached() override;
+  virtual WaterStartStatus selectZone(uint8_t zone) override;
   virtual ~WellPumpWaterController();
   WellPumpWaterController();
-  inline void setDelayFunction(NTPClient::DelayHandlerFunction delayFunction) { this->delayHandler = delayFunction; }
+  inline const FlowLearner& getFlowLearner() const { return flowLearner; }
+  //liters of the current pump run, or of the last one when the pump is off. Pulses
+  //lost while a probe read has the decoder are bridged, see FlowMonitor
+  float pumpedLiters();
 
 private:
-  NTPClient::DelayHandlerFunction delayHandler = delay;
   bool pumpIsOn;
   inline bool noConfStatus() {return mainConfParams.normalPulsesPerSec > 0 ? false : true;}
   bool emptyTriggered;
+  FlowLearner flowLearner;
+  bool pumpWasOnBeforeLearn;
+  unsigned long runStartPulses; //of the run, or of its last restart by selectZone()
+  float carriedPulses; //of the run before its last restart
+  float runPulses; //of the last run, after stopWater()
+  float currRunPulses();
+  float runTotalPulses();
+  float dosePulses; //from the start of the run, 0 without a dose
+  bool doseStopsPump;
+  void armDose();
   void turnOnSensor();
   void turnOffSensor();
-  double avgSensorPulsesPerSec();
+  static void flowHandover(bool hasMux);
   const double acceptedMinFlowPerc = 0.3;
 };
 
@@ -0,0 +1,70 @@
+/**
+ * IIRR -- Intelligent Irrigator Based on ESP8266
+    Copyright (C) 2016--2018  Sergio Queiroz <srmq@cin.ufpe.br>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "WeekMinuteMap.h"
+#include <cstring>
+
+#define WEEK_MINUTE_WORDS (MINUTES_PER_WEEK/32)
+
+WeekMinuteMap::WeekMinuteMap() {
+  clear();
+}
+
+void WeekMinuteMap::clear() {
+  memset(bits, 0, sizeof(bits));
+}
+
+void WeekMinuteMap::setRange(uint16_t first, uint16_t last) {
+  for (uint32_t i = first; i <= last && i < first + MINUTES_PER_WEEK; i++) {
+    const uint16_t minute = i % MINUTES_PER_WEEK;
+    bits[minute >> 5] |= 1ul << (minute & 31);
+  }
+}
+
+//a word at a time, the clear bits of the first word below minute are looked at last
+uint16_t WeekMinuteMap::nextClear(uint16_t minute) const {
+  const uint16_t firstWord = minute >> 5;
+  uint32_t clearBits = ~bits[firstWord] & (0xFFFFFFFFul << (minute & 31));
+  for (uint16_t i = 0; i <= WEEK_MINUTE_WORDS; i++) {
+    if (clearBits != 0) {
+      const uint16_t word = (firstWord + i) % WEEK_MINUTE_WORDS;
+      return (word << 5) + __builtin_ctz(clearBits);
+    }
+    const uint16_t next = (firstWord + i + 1) % WEEK_MINUTE_WORDS;
+    clearBits = ~bits[next];
+    if (i + 1 == WEEK_MINUTE_WORDS) clearBits &= ~(0xFFFFFFFFul << (minute & 31));
+  }
+  return WEEK_MINUTE_NONE;
+}
+
+//as nextClear() going back, the clear bits of the first word above minute are looked at last
+uint16_t WeekMinuteMap::prevClear(uint16_t minute) const {
+  const uint16_t firstWord = minute >> 5;
+  const uint32_t upToMinute = 0xFFFFFFFFul >> (31 - (minute & 31));
+  uint32_t clearBits = ~bits[firstWord] & upToMinute;
+  for (uint16_t i = 0; i <= WEEK_MINUTE_WORDS; i++) {
+    if (clearBits != 0) {
+      const uint16_t word = (firstWord + WEEK_MINUTE_WORDS - i) % WEEK_MINUTE_WORDS;
+      return (word << 5) + 31 - __builtin_clz(clearBits);
+    }
+    const uint16_t prev = (firstWord + 2*WEEK_MINUTE_WORDS - i - 1) % WEEK_MINUTE_WORDS;
+    clearBits = ~bits[prev];
+    if (i + 1 == WEEK_MINUTE_WORDS) clearBits &= ~upToMinute;
+  }
+  return WEEK_MINUTE_NONE;
+}
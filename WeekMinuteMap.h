@@ -0,0 +1,63 @@
+/**
+ * IIRR -- Intelligent Irrigator Based on ESP8266
+    Copyright (C) 2016--2018  Sergio Queiroz <srmq@cin.ufpe.br>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef _WEEK_MINUTE_MAP_H_
+#define _WEEK_MINUTE_MAP_H_
+
+#include <Arduino.h>
+#include <TimeLib.h>
+
+#define MINUTES_PER_DAY 1440
+#define MINUTES_PER_WEEK (MINUTES_PER_DAY*DAYS_PER_WEEK)
+#define WEEK_MINUTE_NONE 0xFFFF
+
+//One bit per minute of the week from Sunday 00:00 (1260 bytes). Built when
+//the configuration changes, so a lookup is a shift and a mask, with no
+//time formatting.
+class WeekMinuteMap {
+public:
+  WeekMinuteMap();
+
+  void clear();
+
+  //first to last, both included, first < MINUTES_PER_WEEK. A last past
+  //the end of the week goes on from Sunday 00:00
+  void setRange(uint16_t first, uint16_t last);
+
+  inline bool test(uint16_t minute) const {
+    return (bits[minute >> 5] >> (minute & 31)) & 1;
+  }
+
+  //first minute not set from minute on, wrapping around the week, WEEK_MINUTE_NONE if every minute is set
+  uint16_t nextClear(uint16_t minute) const;
+  //last minute not set up to minute, wrapping back around the week, WEEK_MINUTE_NONE if every minute is set
+  uint16_t prevClear(uint16_t minute) const;
+
+  static inline uint16_t minuteOfDay(time_t aTime) {
+    return elapsedSecsToday(aTime)/SECS_PER_MIN;
+  }
+
+  static inline uint16_t minuteOfWeek(time_t aTime) {
+    return (dayOfWeek(aTime) - 1)*MINUTES_PER_DAY + minuteOfDay(aTime);
+  }
+
+private:
+  uint32_t bits[MINUTES_PER_WEEK/32];
+};
+
+#endif
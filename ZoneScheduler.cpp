@@ -0,0 +1,86 @@
+/**
+ * IIRR -- Intelligent Irrigator Based on ESP8266
+    Copyright (C) 2016--2018  Sergio Queiroz <srmq@cin.ufpe.br>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "ZoneScheduler.h"
+#include <cstring>
+
+//zone 0 alone is the probe set on the decoder and mux, watered by the pump
+static const ZoneHardware ZONE_HARDWARE[ZONES_ON_BOARD] = {ZONE_PINS};
+
+GpioMasks zoneBankMasks(uint8_t zone) {
+  uint32_t setMask = 0;
+  uint32_t clearMask = 0;
+  for (uint8_t z = 0; z < ZONES_ON_BOARD; z++) {
+    const uint8_t pin = ZONE_HARDWARE[z].bankPin;
+    if (pin == ZONE_PIN_NONE) continue;
+    if (z == zone) clearMask |= (1ul << pin); else setMask |= (1ul << pin);
+  }
+  return GpioMasks(setMask, clearMask);
+}
+
+GpioMasks zoneValveMasks(uint8_t zone) {
+  uint32_t setMask = 0;
+  uint32_t clearMask = 0;
+  for (uint8_t z = 0; z < ZONES_ON_BOARD; z++) {
+    const uint8_t pin = ZONE_HARDWARE[z].valvePin;
+    if (pin == ZONE_PIN_NONE) continue;
+    if (z == zone) setMask |= (1ul << pin); else clearMask |= (1ul << pin);
+  }
+  return GpioMasks(setMask, clearMask);
+}
+
+ZoneScheduler::ZoneScheduler() : numZones(1), pending(0), currZone(NO_ZONE),
+    lastZone(NO_ZONE), zoneSince(0), minIntervalSecs(0) {
+  memset(zoneEnd, 0, sizeof(zoneEnd));
+}
+
+void ZoneScheduler::setNumZones(uint8_t n) {
+  numZones = (n < 1) ? 1 : ((n > ZONES_ON_BOARD) ? ZONES_ON_BOARD : n);
+  pending &= (1 << numZones) - 1;
+}
+
+void ZoneScheduler::request(uint8_t zone, time_t aTime) {
+  if (zone >= numZones || int(zone) == currZone) return;
+  //same rule as SensorTask::fulfillMinIrrigInterval, per zone
+  if (zoneEnd[zone] != 0 && zoneEnd[zone] < aTime && (unsigned long)(aTime - zoneEnd[zone]) <= minIntervalSecs) return;
+  pending |= (1 << zone);
+}
+
+int ZoneScheduler::takeNext() {
+  for (int i = 1; i <= numZones; i++) {
+    const int zone = (lastZone + i + numZones) % numZones;
+    if (isPending(zone)) {
+      pending &= ~(1 << zone);
+      return zone;
+    }
+  }
+  return NO_ZONE;
+}
+
+void ZoneScheduler::beginZone(uint8_t zone, time_t aTime) {
+  if (currZone != NO_ZONE) zoneEnd[currZone] = aTime;
+  currZone = zone;
+  lastZone = zone;
+  zoneSince = aTime;
+}
+
+void ZoneScheduler::endZone(time_t aTime) {
+  if (currZone != NO_ZONE) zoneEnd[currZone] = aTime;
+  currZone = NO_ZONE;
+}
@@ -0,0 +1,84 @@
+/**
+ * IIRR -- Intelligent Irrigator Based on ESP8266
+    Copyright (C) 2016--2018  Sergio Queiroz <srmq@cin.ufpe.br>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef _ZONE_SCHEDULER_H_
+#define _ZONE_SCHEDULER_H_
+
+#include "Hal.h"
+#include "sensor_calibration.h"
+
+#define NO_ZONE -1
+
+static_assert(MAX_ZONES <= 8, "pending zones are kept in one byte");
+static_assert(ZONES_ON_BOARD >= 1 && ZONES_ON_BOARD <= MAX_ZONES, "zone 0 is always on board");
+
+//Zones share the decoder and mux address lines, each one has its own
+//probe bank behind an enable pin (active LOW), and its own valve (HIGH
+//opens) after the single pump. ZONE_PIN_NONE means always connected,
+//only right for a single zone.
+class ZoneHardware {
+public:
+  uint8_t bankPin;
+  uint8_t valvePin;
+};
+
+//masks that connect the probe bank of zone and disconnect the others
+GpioMasks zoneBankMasks(uint8_t zone);
+//masks that open the valve of zone and close the others
+GpioMasks zoneValveMasks(uint8_t zone);
+
+//Sequences the zones that need water behind one pump. Zones found dry
+//are queued, and are watered one after the other in round robin order
+//from the last one watered, switching valves with the pump running, so
+//a pump start serves every zone that needs water at that moment. A zone
+//is not queued again until the minimum interval from its own end, so two
+//dry zones can not take turns behind the pump forever.
+class ZoneScheduler {
+public:
+  ZoneScheduler();
+
+  void setNumZones(uint8_t n);
+  inline uint8_t getNumZones() const { return numZones; }
+
+  inline void setMinInterval(unsigned long secs) { minIntervalSecs = secs; }
+  void request(uint8_t zone, time_t aTime);
+  inline void clearPending() { pending = 0; }
+  inline bool isPending(uint8_t zone) const { return (pending & (1 << zone)) != 0; }
+  inline bool hasPending() const { return pending != 0; }
+  //dequeues the next zone to water, NO_ZONE when none is pending
+  int takeNext();
+
+  void beginZone(uint8_t zone, time_t aTime);
+  void endZone(time_t aTime);
+  inline int getCurrZone() const { return currZone; }
+  inline time_t getZoneSince() const { return zoneSince; }
+  //when zone was last watered up to, 0 if not since the boot
+  inline time_t getZoneEnd(uint8_t zone) const { return zoneEnd[zone]; }
+
+private:
+  uint8_t numZones;
+  uint8_t pending;
+  int currZone;
+  int lastZone;
+  time_t zoneSince;
+  time_t zoneEnd[MAX_ZONES];
+  unsigned long minIntervalSecs;
+};
+
+#endif
@@ -19,13 +19,14 @@
 #include "global_funcs.h"
 #include "sensor_calibration.h"
 #include <Arduino.h>
+#include "Hal.h"
 
 void disableMulAndDecod() {
-  digitalWrite(MUL_DECOD_INHIB_PIN, HIGH);
+  Hal::halDigitalWrite(MUL_DECOD_INHIB_PIN, HIGH);
 }
 
 void enableMulAndDecod() {
-  digitalWrite(MUL_DECOD_INHIB_PIN, LOW);
+  Hal::halDigitalWrite(MUL_DECOD_INHIB_PIN, LOW);
 }
 
 bool isNumber(const String& str) {
@@ -40,3 +41,31 @@ bool isNumber(const String& str) {
   return (i == str.length());
 }
 
+
+void IrrigData::addLiters(time_t aTime, float liters) {
+  const unsigned long day = elapsedDays(aTime);
+  if (day > litersDay) {
+    //days without irrigation since the newest entry
+    for (unsigned long d = litersDay + 1; d <= day && d <= litersDay + IRRIG_LITERS_DAYS; d++) {
+      dailyLiters[d % IRRIG_LITERS_DAYS] = 0;
+    }
+    litersDay = day;
+  } else if ((litersDay - day) >= IRRIG_LITERS_DAYS) {
+    return; //older than what is kept
+  }
+  dailyLiters[day % IRRIG_LITERS_DAYS] += liters;
+}
+
+float IrrigData::litersOnDate(time_t aTime) const {
+  const unsigned long day = elapsedDays(aTime);
+  if (day > litersDay || (litersDay - day) >= IRRIG_LITERS_DAYS) return 0;
+  return dailyLiters[day % IRRIG_LITERS_DAYS];
+}
+
+float IrrigData::litersLastDays(time_t aTime) const {
+  float total = 0;
+  for (int i = 0; i < IRRIG_LITERS_DAYS; i++) {
+    total += litersOnDate(aTime - i*SECS_PER_DAY);
+  }
+  return total;
+}
@@ -22,6 +22,7 @@
 #include <WString.h>
 #include <TimeLib.h>
 #include <Time.h>
+#include "sensor_calibration.h"
 
 
 void disableMulAndDecod();
@@ -35,8 +36,36 @@ typedef struct soil_moisture {
   float deep;
   //bool hasWater;
   time_t timeStamp;
+  uint8_t surfaceProbes; //probes used in the last read of each depth
+  uint8_t middleProbes;
+  uint8_t deepProbes;
 } SoilMoisture;
 
+//last readings of every zone, one array per depth
+class ZoneMoistures {
+public:
+  float surface[MAX_ZONES];
+  float middle[MAX_ZONES];
+  float deep[MAX_ZONES];
+  time_t timeStamp[MAX_ZONES];
+
+  ZoneMoistures() {
+    for (int i = 0; i < MAX_ZONES; i++) {
+      surface[i] = middle[i] = deep[i] = 0;
+      timeStamp[i] = 0;
+    }
+  }
+
+  inline void store(uint8_t zone, const SoilMoisture& frame) {
+    surface[zone] = frame.surface;
+    middle[zone] = frame.middle;
+    deep[zone] = frame.deep;
+    timeStamp[zone] = frame.timeStamp;
+  }
+};
+
+#define IRRIG_LITERS_DAYS 7
+
 class IrrigData {
 public:
   float surfaceAtStartIrrig;
@@ -47,17 +76,40 @@ public:
   //guardar lastIrrigEnd e irrigTodaySecs para o caso de faltar energia.
   time_t lastIrrigEnd;
   unsigned long irrigTodaySecs;
+  float irrigLiters; //current irrigation while isIrrigating, else the last one
+  unsigned long litersDay; //day number (elapsedDays) of the newest entry of dailyLiters
+  float dailyLiters[IRRIG_LITERS_DAYS]; //liters of finished irrigations, by day number modulo IRRIG_LITERS_DAYS
+  int8_t irrigZone; //zone being watered, or the last one
   
   IrrigData() : surfaceAtStartIrrig(0), middleAtStartIrrig(0), deepAtStartIrrig(0), isIrrigating(false), 
-                irrigSince(0), lastIrrigEnd(0), irrigTodaySecs(0) {}
+                irrigSince(0), lastIrrigEnd(0), irrigTodaySecs(0), irrigLiters(0), litersDay(0), irrigZone(0) {
+    for (int i = 0; i < IRRIG_LITERS_DAYS; i++) dailyLiters[i] = 0;
+  }
+
+  void addLiters(time_t aTime, float liters);
+  //finished irrigations only, the current one is in irrigLiters
+  float litersOnDate(time_t aTime) const;
+  //the IRRIG_LITERS_DAYS days up to the date of aTime
+  float litersLastDays(time_t aTime) const;
 };
 
 extern SoilMoisture moistures;
 
+extern ZoneMoistures zoneMoistures;
+
 extern IrrigData irrigData;
 
+//SPIFFS has at most this many files open at a time. Kept open across task
+//switches: the files of the sensor and message LogWriters, the log a
+//CloudTask send reads and the one a ServerTask download streams. That
+//leaves one for the running task, opened and closed before it yields: a
+//LogIndex file, a LogCatalog read of record times, a conf or /var file.
+#define FS_MAX_OPEN_FILES 5
+
 extern const char LOG_DIR[] PROGMEM;
 extern const char TS_FMT_STR[] PROGMEM; //yyyymmddThhmmss
+extern const char LOGF_FMT_STR[] PROGMEM;
+extern const char MSGF_FMT_STR[] PROGMEM;
 
 extern bool fsOpen;
 
@@ -0,0 +1,196 @@
+/**
+ * IIRR -- Intelligent Irrigator Based on ESP8266
+    Copyright (C) 2016--2019  Sergio Queiroz <srmq@cin.ufpe.br>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef _HOST_ARDUINO_H_
+#define _HOST_ARDUINO_H_
+
+//Arduino core API for the host build. Pins, clock and interrupts go to
+//the Hal backend, so a harness drives them through Hal::setBackend().
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <ctype.h>
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include "WString.h"
+#include "pgmspace.h"
+
+//the sketch has struct members named errno, the C library has it as a macro
+#undef errno
+
+#define ICACHE_RAM_ATTR
+#define IRAM_ATTR
+
+#define HIGH 0x1
+#define LOW 0x0
+
+#define INPUT 0x00
+#define OUTPUT 0x01
+#define INPUT_PULLUP 0x02
+
+#define RISING 0x01
+#define FALLING 0x02
+#define CHANGE 0x03
+
+static const uint8_t D0 = 16;
+static const uint8_t D1 = 5;
+static const uint8_t D2 = 4;
+static const uint8_t D3 = 0;
+static const uint8_t D4 = 2;
+static const uint8_t D5 = 14;
+static const uint8_t D6 = 12;
+static const uint8_t D7 = 13;
+static const uint8_t D8 = 15;
+static const uint8_t A0 = 17;
+
+#define digitalPinToInterrupt(p) (p)
+
+using std::min;
+using std::max;
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int digitalRead(uint8_t pin);
+int analogRead(uint8_t pin);
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void yield();
+void attachInterrupt(uint8_t pin, void (*isr)(void), int mode);
+void detachInterrupt(uint8_t pin);
+
+inline void noInterrupts() { }
+inline void interrupts() { }
+
+class Print;
+
+class Printable {
+public:
+  virtual size_t printTo(Print& p) const = 0;
+  virtual ~Printable() { }
+};
+
+class Print {
+public:
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t *buffer, size_t size);
+  size_t write(const char *str) { return (str != NULL) ? write((const uint8_t *)str, strlen(str)) : 0; }
+  size_t write(const char *buffer, size_t size) { return write((const uint8_t *)buffer, size); }
+  virtual void flush() { }
+
+  size_t printf(const char *format, ...);
+  size_t print(const __FlashStringHelper *str);
+  size_t print(const String& str);
+  size_t print(const char *str);
+  size_t print(char c);
+  size_t print(unsigned char value, int base = 10);
+  size_t print(int value, int base = 10);
+  size_t print(unsigned int value, int base = 10);
+  size_t print(long value, int base = 10);
+  size_t print(unsigned long value, int base = 10);
+  size_t print(double value, int digits = 2);
+  size_t print(const Printable& printable);
+
+  size_t println(const __FlashStringHelper *str);
+  size_t println(const String& str);
+  size_t println(const char *str);
+  size_t println(char c);
+  size_t println(unsigned char value, int base = 10);
+  size_t println(int value, int base = 10);
+  size_t println(unsigned int value, int base = 10);
+  size_t println(long value, int base = 10);
+  size_t println(unsigned long value, int base = 10);
+  size_t println(double value, int digits = 2);
+  size_t println(const Printable& printable);
+  size_t println();
+
+  virtual ~Print() { }
+
+private:
+  size_t printNumber(unsigned long value, int base);
+};
+
+class Stream : public Print {
+public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+
+  Stream() : timeout(1000) { }
+  void setTimeout(unsigned long newTimeout) { timeout = newTimeout; }
+  virtual size_t readBytes(char *buffer, size_t length);
+  size_t readBytes(uint8_t *buffer, size_t length) { return readBytes((char *)buffer, length); }
+  size_t readBytesUntil(char terminator, char *buffer, size_t length);
+  size_t readBytesUntil(char terminator, uint8_t *buffer, size_t length) {
+    return readBytesUntil(terminator, (char *)buffer, length);
+  }
+  String readString();
+  String readStringUntil(char terminator);
+
+protected:
+  //a host stream has no data still on its way, timeout is kept for the API only
+  unsigned long timeout;
+};
+
+//Serial output goes to stdout once begin() was called, harnesses that
+//do not call it run quiet
+class HardwareSerial : public Stream {
+public:
+  HardwareSerial() : started(false) { }
+  void begin(unsigned long baud);
+  virtual int available() override { return 0; }
+  virtual int read() override { return -1; }
+  virtual int peek() override { return -1; }
+  virtual size_t write(uint8_t c) override;
+  virtual size_t write(const uint8_t *buffer, size_t size) override;
+  using Print::write;
+
+private:
+  bool started;
+};
+
+extern HardwareSerial Serial;
+
+class IPAddress : public Printable {
+public:
+  IPAddress() : address(0) { }
+  IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : address(a | (b << 8) | (c << 16) | ((uint32_t)d << 24)) { }
+  String toString() const;
+  virtual size_t printTo(Print& p) const override;
+
+private:
+  uint32_t address;
+};
+
+//the host network never connects, so digest authentication is not reached
+class MD5Builder {
+public:
+  void begin() { }
+  void add(const String& str) { }
+  void calculate() { }
+  String toString() const { return String(); }
+};
+
+#endif
@@ -0,0 +1,138 @@
+/**
+ * IIRR -- Intelligent Irrigator Based on ESP8266
+    Copyright (C) 2016--2019  Sergio Queiroz <srmq@cin.ufpe.br>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef _HOST_ARDUINOJSON_H_
+#define _HOST_ARDUINOJSON_H_
+
+//ArduinoJson 5 API for the host build, without a JSON engine. Created
+//objects and arrays accept and drop every value, parsing always fails,
+//so the modules keep the defaults they use when a file cannot be read.
+
+#include <Arduino.h>
+
+#define JSON_ARRAY_SIZE(NUMBER_OF_ELEMENTS) (8 + (NUMBER_OF_ELEMENTS)*16)
+#define JSON_OBJECT_SIZE(NUMBER_OF_ELEMENTS) (8 + (NUMBER_OF_ELEMENTS)*24)
+
+class JsonArray;
+class JsonObject;
+
+class JsonVariant {
+public:
+  JsonVariant() { }
+  template<typename T> JsonVariant(const T& value) { }
+
+  template<typename T> operator T() const { return T(); }
+  operator JsonArray&() const;
+  operator JsonObject&() const;
+  template<typename T> T as() const { return T(); }
+  template<typename T> bool is() const { return false; }
+  bool success() const { return false; }
+
+  JsonVariant operator[](size_t index) const { return JsonVariant(); }
+  JsonVariant operator[](const char *key) const { return JsonVariant(); }
+};
+
+class JsonObjectSubscript : public JsonVariant {
+public:
+  template<typename T> JsonObjectSubscript& operator=(const T& value) { return *this; }
+  JsonObjectSubscript& operator=(const char *value) { return *this; }
+};
+
+class JsonArraySubscript : public JsonVariant {
+public:
+  template<typename T> JsonArraySubscript& operator=(const T& value) { return *this; }
+  JsonArraySubscript& operator=(const char *value) { return *this; }
+};
+
+class JsonArray {
+public:
+  JsonArray(bool valid) : valid(valid) { }
+
+  static JsonArray& empty() { static JsonArray array(true); return array; }
+  static JsonArray& invalid() { static JsonArray array(false); return array; }
+
+  bool success() const { return valid; }
+  size_t size() const { return 0; }
+  template<typename T> bool add(const T& value) { return valid; }
+  bool add(const char *value) { return valid; }
+  JsonArraySubscript operator[](size_t index) { return JsonArraySubscript(); }
+  JsonVariant operator[](size_t index) const { return JsonVariant(); }
+  void remove(size_t index) { }
+  JsonArray& createNestedArray();
+  JsonObject& createNestedObject();
+
+  size_t printTo(Print& out) const { return valid ? out.print("[]") : 0; }
+  size_t printTo(String& out) const { if (valid) out += "[]"; return out.length(); }
+  size_t printTo(char *buffer, size_t size) const { return snprintf(buffer, size, "%s", valid ? "[]" : ""); }
+  size_t measureLength() const { return valid ? 2 : 0; }
+
+private:
+  bool valid;
+};
+
+class JsonObject {
+public:
+  JsonObject(bool valid) : valid(valid) { }
+
+  static JsonObject& empty() { static JsonObject object(true); return object; }
+  static JsonObject& invalid() { static JsonObject object(false); return object; }
+
+  bool success() const { return valid; }
+  size_t size() const { return 0; }
+  bool containsKey(const char *key) const { return false; }
+  JsonObjectSubscript operator[](const char *key) { return JsonObjectSubscript(); }
+  JsonObjectSubscript operator[](const String& key) { return JsonObjectSubscript(); }
+  JsonVariant operator[](const char *key) const { return JsonVariant(); }
+  template<typename T> T get(const char *key) const { return T(); }
+  template<typename T> bool set(const char *key, const T& value) { return valid; }
+  void remove(const char *key) { }
+  JsonArray& createNestedArray(const char *key) { return valid ? JsonArray::empty() : JsonArray::invalid(); }
+  JsonObject& createNestedObject(const char *key) { return valid ? JsonObject::empty() : invalid(); }
+
+  size_t printTo(Print& out) const { return valid ? out.print("{}") : 0; }
+  size_t printTo(String& out) const { if (valid) out += "{}"; return out.length(); }
+  size_t printTo(char *buffer, size_t size) const { return snprintf(buffer, size, "%s", valid ? "{}" : ""); }
+  size_t measureLength() const { return valid ? 2 : 0; }
+
+private:
+  bool valid;
+};
+
+inline JsonArray& JsonArray::createNestedArray() { return valid ? JsonArray::empty() : invalid(); }
+inline JsonObject& JsonArray::createNestedObject() { return valid ? JsonObject::empty() : JsonObject::invalid(); }
+inline JsonVariant::operator JsonArray&() const { return JsonArray::invalid(); }
+inline JsonVariant::operator JsonObject&() const { return JsonObject::invalid(); }
+
+class DynamicJsonBuffer {
+public:
+  DynamicJsonBuffer(size_t initialSize = 256) { }
+
+  JsonObject& createObject() { return JsonObject::empty(); }
+  JsonArray& createArray() { return JsonArray::empty(); }
+  JsonObject& parseObject(const String& json) { return JsonObject::invalid(); }
+  JsonObject& parseObject(const char *json) { return JsonObject::invalid(); }
+  JsonObject& parseObject(Stream& json) { return JsonObject::invalid(); }
+  JsonArray& parseArray(const String& json) { return JsonArray::invalid(); }
+  JsonArray& parseArray(Stream& json) { return JsonArray::invalid(); }
+};
+
+template<size_t CAPACITY>
+class StaticJsonBuffer : public DynamicJsonBuffer {
+};
+
+#endif
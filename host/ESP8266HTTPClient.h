@@ -0,0 +1,74 @@
+/**
+ * IIRR -- Intelligent Irrigator Based on ESP8266
+    Copyright (C) 2016--2019  Sergio Queiroz <srmq@cin.ufpe.br>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef _HOST_ESP8266HTTPCLIENT_H_
+#define _HOST_ESP8266HTTPCLIENT_H_
+
+//HTTP client for the host build, every request fails to connect
+
+#include <ESP8266WiFi.h>
+
+#define HTTPC_ERROR_CONNECTION_REFUSED (-1)
+#define HTTPC_ERROR_SEND_HEADER_FAILED (-2)
+#define HTTPC_ERROR_SEND_PAYLOAD_FAILED (-3)
+#define HTTPC_ERROR_NOT_CONNECTED (-4)
+#define HTTPC_ERROR_CONNECTION_LOST (-5)
+#define HTTPC_ERROR_NO_STREAM (-6)
+#define HTTPC_ERROR_NO_HTTP_SERVER (-7)
+
+typedef enum {
+  HTTP_CODE_OK = 200,
+  HTTP_CODE_ACCEPTED = 202,
+  HTTP_CODE_NO_CONTENT = 204,
+  HTTP_CODE_BAD_REQUEST = 400,
+  HTTP_CODE_UNAUTHORIZED = 401,
+  HTTP_CODE_NOT_FOUND = 404,
+  HTTP_CODE_INTERNAL_SERVER_ERROR = 500
+} t_http_codes;
+
+class HTTPClient {
+public:
+  HTTPClient() : _client(NULL) { }
+  virtual ~HTTPClient() { }
+
+  bool begin(WiFiClient& client, const String& url) { _client = &client; return true; }
+  bool begin(WiFiClient& client, const char *url) { _client = &client; return true; }
+  void end() { _client = NULL; }
+  void setReuse(bool reuse) { }
+
+  void addHeader(const String& name, const String& value) { }
+  void collectHeaders(const char *headerKeys[], const size_t headerKeysCount) { }
+  String header(const char *name) { return String(); }
+
+  int GET() { return sendRequest("GET"); }
+  int POST(const String& payload) { return sendRequest("POST"); }
+  int sendRequest(const char *type) { return returnError(HTTPC_ERROR_CONNECTION_REFUSED); }
+
+  int getSize() { return -1; }
+  String getString() { return String(); }
+
+protected:
+  bool connect() { return false; }
+  bool sendHeader(const char *type) { return false; }
+  int handleHeaderResponse() { return HTTPC_ERROR_CONNECTION_LOST; }
+  int returnError(int error) { return error; }
+
+  WiFiClient *_client;
+};
+
+#endif
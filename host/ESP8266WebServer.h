@@ -0,0 +1,57 @@
+/**
+ * IIRR -- Intelligent Irrigator Based on ESP8266
+    Copyright (C) 2016--2019  Sergio Queiroz <srmq@cin.ufpe.br>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef _HOST_ESP8266WEBSERVER_H_
+#define _HOST_ESP8266WEBSERVER_H_
+
+//Web server for the host build: routes are registered but no client
+//ever arrives, so handleClient() returns at once
+
+#include <ESP8266WiFi.h>
+
+#define CONTENT_LENGTH_UNKNOWN ((size_t) -1)
+
+enum HTTPMethod { HTTP_ANY, HTTP_GET, HTTP_POST, HTTP_PUT, HTTP_PATCH, HTTP_DELETE, HTTP_OPTIONS };
+enum HTTPAuthMethod { BASIC_AUTH, DIGEST_AUTH };
+
+class ESP8266WebServer {
+public:
+  typedef std::function<void(void)> THandlerFunction;
+
+  ESP8266WebServer(int port = 80) { }
+
+  void begin() { }
+  void handleClient() { }
+  void on(const String& uri, THandlerFunction handler) { }
+  void on(const String& uri, HTTPMethod method, THandlerFunction handler) { }
+
+  bool authenticate(const char *username, const char *password) { return false; }
+  void requestAuthentication(HTTPAuthMethod mode = BASIC_AUTH, const char *realm = NULL, const String& authFailMsg = String("")) { }
+
+  String arg(const String& name) { return String(); }
+  String arg(const char *name) { return String(); }
+  bool hasArg(const String& name) { return false; }
+
+  void setContentLength(const size_t contentLength) { }
+  void send(int code, const char *contentType = NULL, const String& content = String("")) { }
+  void send(int code, const String& contentType, const String& content) { }
+  void sendContent(const String& content) { }
+  template<typename T> size_t streamFile(T& file, const String& contentType) { return 0; }
+};
+
+#endif
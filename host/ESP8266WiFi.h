@@ -0,0 +1,87 @@
+/**
+ * IIRR -- Intelligent Irrigator Based on ESP8266
+    Copyright (C) 2016--2019  Sergio Queiroz <srmq@cin.ufpe.br>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef _HOST_ESP8266WIFI_H_
+#define _HOST_ESP8266WIFI_H_
+
+//WiFi for the host build: there is no radio, the station never connects,
+//scans find no networks and the soft AP only records its settings.
+
+#include <Arduino.h>
+#include <WiFiClient.h>
+
+typedef enum {
+  WL_IDLE_STATUS = 0,
+  WL_NO_SSID_AVAIL = 1,
+  WL_SCAN_COMPLETED = 2,
+  WL_CONNECTED = 3,
+  WL_CONNECT_FAILED = 4,
+  WL_CONNECTION_LOST = 5,
+  WL_DISCONNECTED = 6
+} wl_status_t;
+
+typedef enum WiFiMode {
+  WIFI_OFF = 0,
+  WIFI_STA = 1,
+  WIFI_AP = 2,
+  WIFI_AP_STA = 3
+} WiFiMode_t;
+
+#define WIFI_SCAN_RUNNING (-1)
+#define WIFI_SCAN_FAILED (-2)
+
+struct WiFiEventStationModeDisconnected {
+  String ssid;
+  uint8_t reason;
+};
+
+typedef std::shared_ptr<std::function<void(const WiFiEventStationModeDisconnected&)> > WiFiEventHandler;
+
+class ESP8266WiFiClass {
+public:
+  ESP8266WiFiClass() : currMode(WIFI_OFF) { }
+
+  wl_status_t begin(const char *ssid, const char *passphrase = NULL);
+  bool disconnect(bool wifiOff = false);
+  wl_status_t status();
+  IPAddress localIP();
+  void macAddress(uint8_t *mac);
+
+  bool mode(WiFiMode_t newMode);
+  WiFiMode_t getMode() { return currMode; }
+  bool enableAP(bool enable);
+  bool softAP(const char *ssid, const char *passphrase = NULL);
+  IPAddress softAPIP();
+
+  int8_t scanNetworks(bool async = false);
+  int8_t scanComplete();
+  void scanDelete() { }
+  String SSID(uint8_t networkItem) { return String(); }
+  int32_t RSSI(uint8_t networkItem) { return 0; }
+  int32_t channel(uint8_t networkItem) { return 0; }
+  uint8_t encryptionType(uint8_t networkItem) { return 0; }
+
+  WiFiEventHandler onStationModeDisconnected(std::function<void(const WiFiEventStationModeDisconnected&)> handler);
+
+private:
+  WiFiMode_t currMode;
+};
+
+extern ESP8266WiFiClass WiFi;
+
+#endif
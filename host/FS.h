@@ -0,0 +1,126 @@
+/**
+ * IIRR -- Intelligent Irrigator Based on ESP8266
+    Copyright (C) 2016--2019  Sergio Queiroz <srmq@cin.ufpe.br>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef _HOST_FS_H_
+#define _HOST_FS_H_
+
+//SPIFFS for the host build: files live in memory, sizes are counted in
+//pages and at most HOST_FS_MAX_OPEN_FILES files can be open at a time,
+//as on the board. A write to a full FS writes the pages that fit. HostFS resizes or empties it between harness runs.
+
+#include <Arduino.h>
+#include <map>
+#include <string>
+
+#define HOST_FS_TOTAL_BYTES (3*1024*1024)
+#define HOST_FS_PAGE_SIZE 256
+#define HOST_FS_BLOCK_SIZE 8192
+#define HOST_FS_MAX_OPEN_FILES 5
+#define HOST_FS_MAX_PATH_LENGTH 32
+
+enum SeekMode {
+  SeekSet = 0,
+  SeekCur = 1,
+  SeekEnd = 2
+};
+
+class HostFileHandle;
+
+class File : public Stream {
+public:
+  File() { }
+  File(std::shared_ptr<HostFileHandle> handle) : handle(handle) { }
+
+  virtual size_t write(uint8_t c) override;
+  virtual size_t write(const uint8_t *buffer, size_t size) override;
+  using Print::write;
+  virtual int available() override;
+  virtual int read() override;
+  virtual int peek() override;
+  virtual void flush() override { }
+  size_t read(uint8_t *buffer, size_t size);
+  size_t readBytes(char *buffer, size_t length) override { return read((uint8_t *)buffer, length); }
+  bool seek(uint32_t pos, SeekMode mode);
+  bool seek(uint32_t pos) { return seek(pos, SeekSet); }
+  size_t position() const;
+  size_t size() const;
+  bool truncate(uint32_t size);
+  void close();
+  const char *name() const;
+  operator bool() const;
+
+private:
+  std::shared_ptr<HostFileHandle> handle;
+};
+
+class Dir {
+public:
+  Dir() : started(false) { }
+  Dir(const String& prefix) : prefix(prefix.c_str()), started(false) { }
+
+  File openFile(const char *mode);
+  String fileName();
+  size_t fileSize();
+  bool next();
+
+private:
+  std::string prefix;
+  std::string curr;
+  bool started;
+};
+
+struct FSInfo {
+  size_t totalBytes;
+  size_t usedBytes;
+  size_t blockSize;
+  size_t pageSize;
+  size_t maxOpenFiles;
+  size_t maxPathLength;
+};
+
+class FS {
+public:
+  bool begin();
+  void end();
+  bool format();
+  bool info(FSInfo& info);
+  File open(const char *path, const char *mode);
+  File open(const String& path, const char *mode) { return open(path.c_str(), mode); }
+  bool exists(const char *path);
+  bool exists(const String& path) { return exists(path.c_str()); }
+  Dir openDir(const char *path) { return Dir(String(path)); }
+  Dir openDir(const String& path) { return Dir(path); }
+  bool remove(const char *path);
+  bool remove(const String& path) { return remove(path.c_str()); }
+  bool rename(const char *pathFrom, const char *pathTo);
+  bool rename(const String& pathFrom, const String& pathTo) { return rename(pathFrom.c_str(), pathTo.c_str()); }
+};
+
+extern FS SPIFFS;
+
+//host side controls of SPIFFS
+class HostFS {
+public:
+  //empties the file system and sets its capacity
+  static void reset(size_t totalBytes = HOST_FS_TOTAL_BYTES);
+  static unsigned int openFiles();
+  //most files that were open at the same time since the last reset
+  static unsigned int maxOpenFilesSeen();
+};
+
+#endif
@@ -0,0 +1,389 @@
+/**
+ * IIRR -- Intelligent Irrigator Based on ESP8266
+    Copyright (C) 2016--2019  Sergio Queiroz <srmq@cin.ufpe.br>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <Arduino.h>
+#include <TimeLib.h>
+#include <Scheduler.h>
+#include <stdarg.h>
+#include "../Hal.h"
+
+HardwareSerial Serial;
+SchedulerClass Scheduler;
+
+void pinMode(uint8_t pin, uint8_t mode) { Hal::halPinMode(pin, mode); }
+void digitalWrite(uint8_t pin, uint8_t val) { Hal::halDigitalWrite(pin, val); }
+int digitalRead(uint8_t pin) { return Hal::halDigitalRead(pin); }
+int analogRead(uint8_t pin) { return Hal::halAnalogRead(pin); }
+unsigned long millis() { return Hal::halMillis(); }
+unsigned long micros() { return Hal::halMicros(); }
+void delay(unsigned long ms) { Hal::halDelay(ms); }
+void yield() { }
+void attachInterrupt(uint8_t pin, void (*isr)(void), int mode) { Hal::halAttachInterrupt(pin, isr, mode); }
+void detachInterrupt(uint8_t pin) { Hal::halDetachInterrupt(pin); }
+
+void delayMicroseconds(unsigned int us) {
+  const unsigned long start = micros();
+  while (micros() - start < us) { }
+}
+
+size_t Print::write(const uint8_t *buffer, size_t size) {
+  size_t n = 0;
+  while (size--) {
+    if (write(*buffer++) == 0) break;
+    n++;
+  }
+  return n;
+}
+
+size_t Print::printf(const char *format, ...) {
+  char buf[256];
+  va_list args;
+  va_start(args, format);
+  const int len = vsnprintf(buf, sizeof(buf), format, args);
+  va_end(args);
+  if (len < 0) return 0;
+  return write((const uint8_t *)buf, std::min((size_t)len, sizeof(buf) - 1));
+}
+
+size_t Print::printNumber(unsigned long value, int base) {
+  char buf[8*sizeof(long) + 1];
+  char *str = &buf[sizeof(buf) - 1];
+  *str = '\0';
+  if (base < 2) base = 10;
+  do {
+    const char digit = value % base;
+    value /= base;
+    *--str = (digit < 10) ? digit + '0' : digit + 'A' - 10;
+  } while (value);
+  return write(str);
+}
+
+size_t Print::print(const __FlashStringHelper *str) { return write(reinterpret_cast<const char *>(str)); }
+size_t Print::print(const String& str) { return write(str.c_str(), str.length()); }
+size_t Print::print(const char *str) { return write(str); }
+size_t Print::print(char c) { return write((uint8_t)c); }
+size_t Print::print(unsigned char value, int base) { return print((unsigned long)value, base); }
+size_t Print::print(int value, int base) { return print((long)value, base); }
+size_t Print::print(unsigned int value, int base) { return print((unsigned long)value, base); }
+size_t Print::print(unsigned long value, int base) { return printNumber(value, base); }
+size_t Print::print(const Printable& printable) { return printable.printTo(*this); }
+
+size_t Print::print(long value, int base) {
+  if (base == 10 && value < 0) {
+    return print('-') + printNumber(-(unsigned long)value, 10);
+  }
+  return printNumber((unsigned long)value, base);
+}
+
+//as printFloat() of the ESP8266 core, through its dtostrf(): half a unit of
+//the last digit is added and the digits are taken off one by one. Unlike
+//printf, -0.0 prints without a sign and .5 always rounds up
+size_t Print::print(double value, int digits) {
+  if (isnan(value)) return print("nan");
+  if (isinf(value)) return print("inf");
+  char buf[64];
+  char *out = buf;
+  if (value < 0.0) {
+    *out++ = '-';
+    value = -value;
+  }
+  double rounding = 2.0;
+  for (int i = 0; i < digits; i++) rounding *= 10.0;
+  value += 1.0/rounding;
+  double tenpow = 1.0;
+  int digitCount = 1;
+  while (value >= 10.0*tenpow && digitCount < 40) {
+    tenpow *= 10.0;
+    digitCount++;
+  }
+  value /= tenpow;
+  digitCount += digits;
+  while (digitCount-- > 0) {
+    int digit = (int)value;
+    if (digit > 9) digit = 9;
+    *out++ = (char)('0' | digit);
+    if (digitCount == digits && digits > 0) *out++ = '.';
+    value -= digit;
+    value *= 10.0;
+  }
+  *out = '\0';
+  return print(buf);
+}
+
+size_t Print::println() { return write("\r\n"); }
+size_t Print::println(const __FlashStringHelper *str) { return print(str) + println(); }
+size_t Print::println(const String& str) { return print(str) + println(); }
+size_t Print::println(const char *str) { return print(str) + println(); }
+size_t Print::println(char c) { return print(c) + println(); }
+size_t Print::println(unsigned char value, int base) { return print(value, base) + println(); }
+size_t Print::println(int value, int base) { return print(value, base) + println(); }
+size_t Print::println(unsigned int value, int base) { return print(value, base) + println(); }
+size_t Print::println(long value, int base) { return print(value, base) + println(); }
+size_t Print::println(unsigned long value, int base) { return print(value, base) + println(); }
+size_t Print::println(double value, int digits) { return print(value, digits) + println(); }
+size_t Print::println(const Printable& printable) { return print(printable) + println(); }
+
+size_t Stream::readBytes(char *buffer, size_t length) {
+  size_t count = 0;
+  while (count < length) {
+    const int c = read();
+    if (c < 0) break;
+    buffer[count++] = (char)c;
+  }
+  return count;
+}
+
+size_t Stream::readBytesUntil(char terminator, char *buffer, size_t length) {
+  size_t count = 0;
+  while (count < length) {
+    const int c = read();
+    if (c < 0 || c == terminator) break;
+    buffer[count++] = (char)c;
+  }
+  return count;
+}
+
+String Stream::readString() {
+  String result;
+  int c;
+  while ((c = read()) >= 0) result += (char)c;
+  return result;
+}
+
+String Stream::readStringUntil(char terminator) {
+  String result;
+  int c;
+  while ((c = read()) >= 0 && c != terminator) result += (char)c;
+  return result;
+}
+
+void HardwareSerial::begin(unsigned long baud) {
+  started = true;
+}
+
+size_t HardwareSerial::write(uint8_t c) {
+  if (!started) return 1;
+  return fwrite(&c, 1, 1, stdout);
+}
+
+size_t HardwareSerial::write(const uint8_t *buffer, size_t size) {
+  if (!started) return size;
+  return fwrite(buffer, 1, size, stdout);
+}
+
+String IPAddress::toString() const {
+  char buf[16];
+  snprintf(buf, sizeof(buf), "%u.%u.%u.%u", address & 0xFF, (address >> 8) & 0xFF,
+           (address >> 16) & 0xFF, address >> 24);
+  return String(buf);
+}
+
+size_t IPAddress::printTo(Print& p) const {
+  return p.print(toString());
+}
+
+static String formatNumber(const char *format, long long value) {
+  char buf[24];
+  snprintf(buf, sizeof(buf), format, value);
+  return String(buf);
+}
+
+static String formatUnsigned(unsigned long long value, unsigned char base) {
+  char buf[8*sizeof(long long) + 1];
+  char *str = &buf[sizeof(buf) - 1];
+  *str = '\0';
+  if (base < 2) base = 10;
+  do {
+    const char digit = value % base;
+    value /= base;
+    *--str = (digit < 10) ? digit + '0' : digit + 'a' - 10;
+  } while (value);
+  return String(str);
+}
+
+String::String(unsigned char value, unsigned char base) : String(formatUnsigned(value, base)) { }
+String::String(unsigned int value, unsigned char base) : String(formatUnsigned(value, base)) { }
+String::String(unsigned long value, unsigned char base) : String(formatUnsigned(value, base)) { }
+
+String::String(int value, unsigned char base) :
+    String((base == 10) ? formatNumber("%lld", value) : formatUnsigned((unsigned int)value, base)) { }
+
+String::String(long value, unsigned char base) :
+    String((base == 10) ? formatNumber("%lld", value) : formatUnsigned((unsigned long)value, base)) { }
+
+String::String(float value, unsigned char decimalPlaces) : String((double)value, decimalPlaces) { }
+
+String::String(double value, unsigned char decimalPlaces) {
+  char buf[64];
+  snprintf(buf, sizeof(buf), "%.*f", decimalPlaces, value);
+  str = buf;
+}
+
+bool String::equalsIgnoreCase(const String& s) const {
+  return (str.length() == s.str.length()) && (strcasecmp(str.c_str(), s.str.c_str()) == 0);
+}
+
+bool String::startsWith(const String& prefix, unsigned int offset) const {
+  return (offset <= str.length()) && (str.compare(offset, prefix.str.length(), prefix.str) == 0);
+}
+
+bool String::endsWith(const String& suffix) const {
+  return (suffix.str.length() <= str.length())
+      && (str.compare(str.length() - suffix.str.length(), suffix.str.length(), suffix.str) == 0);
+}
+
+void String::toCharArray(char *buf, unsigned int bufsize, unsigned int index) const {
+  if (bufsize == 0) return;
+  if (index >= str.length()) {
+    buf[0] = '\0';
+    return;
+  }
+  const unsigned int len = std::min((unsigned int)str.length() - index, bufsize - 1);
+  memcpy(buf, str.c_str() + index, len);
+  buf[len] = '\0';
+}
+
+int String::indexOf(char c, unsigned int fromIndex) const {
+  const size_t pos = str.find(c, fromIndex);
+  return (pos == std::string::npos) ? -1 : (int)pos;
+}
+
+int String::indexOf(const String& s, unsigned int fromIndex) const {
+  const size_t pos = str.find(s.str, fromIndex);
+  return (pos == std::string::npos) ? -1 : (int)pos;
+}
+
+int String::lastIndexOf(char c) const {
+  const size_t pos = str.rfind(c);
+  return (pos == std::string::npos) ? -1 : (int)pos;
+}
+
+String String::substring(unsigned int beginIndex, unsigned int endIndex) const {
+  if (beginIndex > endIndex) std::swap(beginIndex, endIndex);
+  if (beginIndex >= str.length()) return String();
+  if (endIndex > str.length()) endIndex = str.length();
+  return String(str.substr(beginIndex, endIndex - beginIndex));
+}
+
+void String::replace(const String& find, const String& replacement) {
+  if (find.str.empty()) return;
+  size_t pos = 0;
+  while ((pos = str.find(find.str, pos)) != std::string::npos) {
+    str.replace(pos, find.str.length(), replacement.str);
+    pos += replacement.str.length();
+  }
+}
+
+void String::toLowerCase() {
+  for (size_t i = 0; i < str.length(); i++) str[i] = tolower((unsigned char)str[i]);
+}
+
+void String::toUpperCase() {
+  for (size_t i = 0; i < str.length(); i++) str[i] = toupper((unsigned char)str[i]);
+}
+
+void String::trim() {
+  const size_t begin = str.find_first_not_of(" \t\r\n");
+  if (begin == std::string::npos) {
+    str.clear();
+    return;
+  }
+  str = str.substr(begin, str.find_last_not_of(" \t\r\n") - begin + 1);
+}
+
+static inline struct tm gmTime(time_t t) {
+  struct tm result;
+  gmtime_r(&t, &result);
+  return result;
+}
+
+int hour() { return hour(now()); }
+int hour(time_t t) { return gmTime(t).tm_hour; }
+int minute() { return minute(now()); }
+int minute(time_t t) { return gmTime(t).tm_min; }
+int second() { return second(now()); }
+int second(time_t t) { return gmTime(t).tm_sec; }
+int day() { return day(now()); }
+int day(time_t t) { return gmTime(t).tm_mday; }
+int weekday() { return weekday(now()); }
+int weekday(time_t t) { return gmTime(t).tm_wday + 1; }
+int month() { return month(now()); }
+int month(time_t t) { return gmTime(t).tm_mon + 1; }
+int year() { return year(now()); }
+int year(time_t t) { return gmTime(t).tm_year + 1900; }
+
+time_t now() { return Hal::halNow(); }
+void setTime(time_t t) { Hal::halSetNow(t); }
+
+void setTime(int hr, int min, int sec, int dy, int mnth, int yr) {
+  tmElements_t tm;
+  tm.Year = (yr > 99) ? yr - 1970 : yr + 30;
+  tm.Month = mnth;
+  tm.Day = dy;
+  tm.Hour = hr;
+  tm.Minute = min;
+  tm.Second = sec;
+  setTime(makeTime(tm));
+}
+
+void breakTime(time_t time, tmElements_t& tm) {
+  const struct tm t = gmTime(time);
+  tm.Second = t.tm_sec;
+  tm.Minute = t.tm_min;
+  tm.Hour = t.tm_hour;
+  tm.Wday = t.tm_wday + 1;
+  tm.Day = t.tm_mday;
+  tm.Month = t.tm_mon + 1;
+  tm.Year = t.tm_year - 70;
+}
+
+time_t makeTime(const tmElements_t& tm) {
+  struct tm t;
+  memset(&t, 0, sizeof(t));
+  t.tm_sec = tm.Second;
+  t.tm_min = tm.Minute;
+  t.tm_hour = tm.Hour;
+  t.tm_mday = tm.Day;
+  t.tm_mon = tm.Month - 1;
+  t.tm_year = tm.Year + 70;
+  return timegm(&t);
+}
+
+void Task::delay(unsigned long ms) {
+  Hal::halDelay(ms);
+}
+
+void SchedulerClass::start(Task *task) {
+  if (numTasks < SCHEDULER_MAX_TASKS) tasks[numTasks++] = task;
+}
+
+bool SchedulerClass::runOnce() {
+  for (uint8_t i = 0; i < numTasks; i++) {
+    Task *task = tasks[i];
+    if (!task->setupDone) {
+      task->setup();
+      task->setupDone = true;
+    }
+    if (task->shouldRun()) task->loop();
+  }
+  return numTasks > 0;
+}
+
+void SchedulerClass::begin() {
+  while (runOnce()) { }
+}
@@ -0,0 +1,266 @@
+/**
+ * IIRR -- Intelligent Irrigator Based on ESP8266
+    Copyright (C) 2016--2019  Sergio Queiroz <srmq@cin.ufpe.br>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <FS.h>
+#include <vector>
+
+FS SPIFFS;
+
+class HostFileHandle {
+public:
+  std::string path;
+  size_t pos;
+  bool readable;
+  bool writable;
+  bool append;
+  bool open;
+};
+
+static std::map<std::string, std::string> hostFiles;
+static std::vector<std::weak_ptr<HostFileHandle> > openHandles;
+static size_t hostTotalBytes = HOST_FS_TOTAL_BYTES;
+static bool mounted = false;
+static unsigned int maxOpenSeen = 0;
+
+static size_t pagesOf(size_t bytes) {
+  return (bytes + HOST_FS_PAGE_SIZE - 1)/HOST_FS_PAGE_SIZE;
+}
+
+static size_t usedBytes() {
+  size_t used = 0;
+  for (std::map<std::string, std::string>::const_iterator it = hostFiles.begin(); it != hostFiles.end(); ++it) {
+    used += (1 + pagesOf(it->second.size()))*HOST_FS_PAGE_SIZE; //plus the object header page
+  }
+  return used;
+}
+
+static unsigned int countOpen() {
+  unsigned int count = 0;
+  for (size_t i = 0; i < openHandles.size(); i++) {
+    std::shared_ptr<HostFileHandle> handle = openHandles[i].lock();
+    if (handle && handle->open) count++;
+  }
+  return count;
+}
+
+static void dropClosed() {
+  std::vector<std::weak_ptr<HostFileHandle> > stillOpen;
+  for (size_t i = 0; i < openHandles.size(); i++) {
+    std::shared_ptr<HostFileHandle> handle = openHandles[i].lock();
+    if (handle && handle->open) stillOpen.push_back(handle);
+  }
+  openHandles.swap(stillOpen);
+}
+
+void HostFS::reset(size_t totalBytes) {
+  hostFiles.clear();
+  openHandles.clear();
+  hostTotalBytes = totalBytes;
+  maxOpenSeen = 0;
+}
+
+unsigned int HostFS::openFiles() {
+  return countOpen();
+}
+
+unsigned int HostFS::maxOpenFilesSeen() {
+  return maxOpenSeen;
+}
+
+bool FS::begin() {
+  mounted = true;
+  return true;
+}
+
+void FS::end() {
+  mounted = false;
+}
+
+bool FS::format() {
+  hostFiles.clear();
+  return true;
+}
+
+bool FS::info(FSInfo& info) {
+  if (!mounted) return false;
+  info.totalBytes = hostTotalBytes;
+  info.usedBytes = usedBytes();
+  info.blockSize = HOST_FS_BLOCK_SIZE;
+  info.pageSize = HOST_FS_PAGE_SIZE;
+  info.maxOpenFiles = HOST_FS_MAX_OPEN_FILES;
+  info.maxPathLength = HOST_FS_MAX_PATH_LENGTH;
+  return true;
+}
+
+//modes as in fopen: r, r+, w, w+, a, a+
+File FS::open(const char *path, const char *mode) {
+  if (!mounted || path == NULL || mode == NULL) return File();
+  if (strlen(path) >= HOST_FS_MAX_PATH_LENGTH) return File();
+  dropClosed();
+  if (openHandles.size() >= HOST_FS_MAX_OPEN_FILES) return File();
+  const bool plus = (strchr(mode, '+') != NULL);
+  std::map<std::string, std::string>::iterator it = hostFiles.find(path);
+  if (mode[0] == 'r') {
+    if (it == hostFiles.end()) return File();
+  } else if (mode[0] == 'w') {
+    hostFiles[path].clear();
+  } else if (mode[0] == 'a') {
+    if (it == hostFiles.end()) hostFiles[path];
+  } else {
+    return File();
+  }
+  std::shared_ptr<HostFileHandle> handle = std::make_shared<HostFileHandle>();
+  handle->path = path;
+  handle->readable = (mode[0] == 'r') || plus;
+  handle->writable = (mode[0] != 'r') || plus;
+  handle->append = (mode[0] == 'a');
+  handle->pos = handle->append ? hostFiles[path].size() : 0;
+  handle->open = true;
+  openHandles.push_back(handle);
+  maxOpenSeen = std::max(maxOpenSeen, (unsigned int)openHandles.size());
+  return File(handle);
+}
+
+bool FS::exists(const char *path) {
+  return mounted && hostFiles.count(path) > 0;
+}
+
+bool FS::remove(const char *path) {
+  return mounted && hostFiles.erase(path) > 0;
+}
+
+bool FS::rename(const char *pathFrom, const char *pathTo) {
+  if (!mounted || hostFiles.count(pathFrom) == 0 || hostFiles.count(pathTo) > 0) return false;
+  hostFiles[pathTo].swap(hostFiles[pathFrom]);
+  hostFiles.erase(pathFrom);
+  return true;
+}
+
+static std::string *contentsOf(const std::shared_ptr<HostFileHandle>& handle) {
+  if (!handle || !handle->open) return NULL;
+  std::map<std::string, std::string>::iterator it = hostFiles.find(handle->path);
+  return (it != hostFiles.end()) ? &it->second : NULL;
+}
+
+size_t File::write(uint8_t c) {
+  return write(&c, 1);
+}
+
+size_t File::write(const uint8_t *buffer, size_t size) {
+  std::string *contents = contentsOf(handle);
+  if (contents == NULL || !handle->writable) return 0;
+  if (handle->append) handle->pos = contents->size();
+  //as SPIFFS, up to the end of the last page that fits
+  const size_t used = usedBytes();
+  const size_t freePages = (used < hostTotalBytes) ? (hostTotalBytes - used)/HOST_FS_PAGE_SIZE : 0;
+  const size_t maxEnd = (pagesOf(contents->size()) + freePages)*HOST_FS_PAGE_SIZE;
+  if (handle->pos >= maxEnd) return 0;
+  size = std::min(size, maxEnd - handle->pos);
+  if (contents->size() < handle->pos + size) contents->resize(handle->pos + size);
+  memcpy(&(*contents)[handle->pos], buffer, size);
+  handle->pos += size;
+  return size;
+}
+
+int File::available() {
+  std::string *contents = contentsOf(handle);
+  if (contents == NULL || handle->pos >= contents->size()) return 0;
+  return contents->size() - handle->pos;
+}
+
+int File::read() {
+  uint8_t c;
+  return (read(&c, 1) == 1) ? c : -1;
+}
+
+int File::peek() {
+  std::string *contents = contentsOf(handle);
+  if (contents == NULL || !handle->readable || handle->pos >= contents->size()) return -1;
+  return (uint8_t)(*contents)[handle->pos];
+}
+
+size_t File::read(uint8_t *buffer, size_t size) {
+  std::string *contents = contentsOf(handle);
+  if (contents == NULL || !handle->readable || handle->pos >= contents->size()) return 0;
+  const size_t count = std::min(size, contents->size() - handle->pos);
+  memcpy(buffer, contents->data() + handle->pos, count);
+  handle->pos += count;
+  return count;
+}
+
+bool File::seek(uint32_t pos, SeekMode mode) {
+  std::string *contents = contentsOf(handle);
+  if (contents == NULL) return false;
+  size_t newPos = pos;
+  if (mode == SeekCur) newPos = handle->pos + pos;
+  else if (mode == SeekEnd) newPos = contents->size() + (int32_t)pos;
+  if (newPos > contents->size()) return false;
+  handle->pos = newPos;
+  return true;
+}
+
+size_t File::position() const {
+  return (contentsOf(handle) != NULL) ? handle->pos : 0;
+}
+
+size_t File::size() const {
+  std::string *contents = contentsOf(handle);
+  return (contents != NULL) ? contents->size() : 0;
+}
+
+bool File::truncate(uint32_t size) {
+  std::string *contents = contentsOf(handle);
+  if (contents == NULL || !handle->writable || size > contents->size()) return false;
+  contents->resize(size);
+  handle->pos = std::min(handle->pos, (size_t)size);
+  return true;
+}
+
+void File::close() {
+  if (handle) handle->open = false;
+  handle.reset();
+}
+
+const char *File::name() const {
+  return handle ? handle->path.c_str() : "";
+}
+
+File::operator bool() const {
+  return contentsOf(handle) != NULL;
+}
+
+File Dir::openFile(const char *mode) {
+  return started ? SPIFFS.open(curr.c_str(), mode) : File();
+}
+
+String Dir::fileName() {
+  return String(curr);
+}
+
+size_t Dir::fileSize() {
+  std::map<std::string, std::string>::const_iterator it = hostFiles.find(curr);
+  return (it != hostFiles.end()) ? it->second.size() : 0;
+}
+
+bool Dir::next() {
+  std::map<std::string, std::string>::const_iterator it = started ? hostFiles.upper_bound(curr) : hostFiles.lower_bound(prefix);
+  started = true;
+  if (it == hostFiles.end() || it->first.compare(0, prefix.size(), prefix) != 0) return false;
+  curr = it->first;
+  return true;
+}
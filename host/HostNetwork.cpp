@@ -0,0 +1,81 @@
+/**
+ * IIRR -- Intelligent Irrigator Based on ESP8266
+    Copyright (C) 2016--2019  Sergio Queiroz <srmq@cin.ufpe.br>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <ESP8266WiFi.h>
+
+ESP8266WiFiClass WiFi;
+
+wl_status_t ESP8266WiFiClass::begin(const char *ssid, const char *passphrase) {
+  return WL_NO_SSID_AVAIL;
+}
+
+bool ESP8266WiFiClass::disconnect(bool wifiOff) {
+  if (wifiOff) currMode = WIFI_OFF;
+  return true;
+}
+
+wl_status_t ESP8266WiFiClass::status() {
+  return WL_DISCONNECTED;
+}
+
+IPAddress ESP8266WiFiClass::localIP() {
+  return IPAddress();
+}
+
+void ESP8266WiFiClass::macAddress(uint8_t *mac) {
+  const uint8_t hostMac[6] = {0x02, 0x00, 0x00, 0x00, 0x00, 0x01};
+  memcpy(mac, hostMac, sizeof(hostMac));
+}
+
+bool ESP8266WiFiClass::mode(WiFiMode_t newMode) {
+  currMode = newMode;
+  return true;
+}
+
+bool ESP8266WiFiClass::enableAP(bool enable) {
+  if (enable) {
+    currMode = (currMode == WIFI_STA || currMode == WIFI_AP_STA) ? WIFI_AP_STA : WIFI_AP;
+  } else {
+    currMode = (currMode == WIFI_AP_STA || currMode == WIFI_STA) ? WIFI_STA : WIFI_OFF;
+  }
+  return true;
+}
+
+bool ESP8266WiFiClass::softAP(const char *ssid, const char *passphrase) {
+  return enableAP(true);
+}
+
+IPAddress ESP8266WiFiClass::softAPIP() {
+  return IPAddress(192, 168, 4, 1);
+}
+
+int8_t ESP8266WiFiClass::scanNetworks(bool async) {
+  return 0;
+}
+
+int8_t ESP8266WiFiClass::scanComplete() {
+  return 0;
+}
+
+WiFiEventHandler ESP8266WiFiClass::onStationModeDisconnected(std::function<void(const WiFiEventStationModeDisconnected&)> handler) {
+  return std::make_shared<std::function<void(const WiFiEventStationModeDisconnected&)> >(handler);
+}
+
+size_t WiFiClient::write(Stream& stream) {
+  return 0;
+}
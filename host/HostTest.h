@@ -0,0 +1,60 @@
+/**
+ * IIRR -- Intelligent Irrigator Based on ESP8266
+    Copyright (C) 2016--2019  Sergio Queiroz <srmq@cin.ufpe.br>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef _HOST_TEST_H_
+#define _HOST_TEST_H_
+
+//Checks of the host tests, one test program per file. A failed check is
+//printed and counted, the exit code of the program is the verdict.
+//Usage:
+//  int main() {
+//    beginTest(&backend);
+//    check(..., "what it means");
+//    return endTest("name");
+//  }
+
+#include "Hal.h"
+#include <FS.h>
+#include <cstdio>
+
+extern bool fsOpen;
+
+static int failures = 0;
+
+static inline void check(bool condition, const char *what) {
+  if (!condition) {
+    printf("FAILED: %s\n", what);
+    failures++;
+  }
+}
+
+//backend becomes the HAL, on an empty SPIFFS just mounted
+static inline void beginTest(HalBackend *backend) {
+  Hal::setBackend(backend);
+  HostFS::reset();
+  fsOpen = SPIFFS.begin();
+}
+
+//the exit code of the test program
+static inline int endTest(const char *testName) {
+  Hal::setBackend(NULL);
+  if (failures == 0) printf("%s: all checks passed\n", testName);
+  return (failures == 0) ? 0 : 1;
+}
+
+#endif
@@ -0,0 +1,40 @@
+/**
+ * IIRR -- Intelligent Irrigator Based on ESP8266
+    Copyright (C) 2016--2019  Sergio Queiroz <srmq@cin.ufpe.br>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef _HOST_NTPCLIENT_H_
+#define _HOST_NTPCLIENT_H_
+
+//NTP client for the host build, updates always fail as there is no network
+
+#include <Arduino.h>
+#include <WiFiUdp.h>
+
+class NTPClient {
+public:
+  typedef std::function<void(unsigned long)> DelayHandlerFunction;
+
+  NTPClient(WiFiUDP& udp, const char *poolServerName, long timeOffset, unsigned long updateInterval) { }
+
+  bool update() { return false; }
+  bool forceUpdate() { return false; }
+  bool shouldUpdate() { return true; }
+  unsigned long getEpochTime() { return 0; }
+  void setDelayFunction(DelayHandlerFunction delayFunction) { }
+};
+
+#endif
@@ -0,0 +1,63 @@
+/**
+ * IIRR -- Intelligent Irrigator Based on ESP8266
+    Copyright (C) 2016--2019  Sergio Queiroz <srmq@cin.ufpe.br>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef _HOST_SCHEDULER_H_
+#define _HOST_SCHEDULER_H_
+
+//Cooperative Scheduler for the host build. begin() runs the tasks in
+//turn, a task gives way only by returning from loop().
+
+#include <Arduino.h>
+
+#define SCHEDULER_MAX_TASKS 8
+
+class SchedulerClass;
+
+class Task {
+  friend class SchedulerClass;
+public:
+  Task() : setupDone(false) { }
+  virtual ~Task() { }
+
+  void delay(unsigned long ms);
+
+protected:
+  virtual void setup() { }
+  virtual void loop() = 0;
+  virtual bool shouldRun() { return true; }
+
+private:
+  bool setupDone;
+};
+
+class SchedulerClass {
+public:
+  SchedulerClass() : numTasks(0) { }
+  void start(Task *task);
+  void begin();
+  //runs each started task once, returns false if there are none
+  bool runOnce();
+
+private:
+  Task *tasks[SCHEDULER_MAX_TASKS];
+  uint8_t numTasks;
+};
+
+extern SchedulerClass Scheduler;
+
+#endif
@@ -0,0 +1,74 @@
+/**
+ * IIRR -- Intelligent Irrigator Based on ESP8266
+    Copyright (C) 2016--2019  Sergio Queiroz <srmq@cin.ufpe.br>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef _HOST_TIMELIB_H_
+#define _HOST_TIMELIB_H_
+
+//TimeLib for the host build, the system time is the Hal backend clock
+
+#include <Arduino.h>
+#include <time.h>
+
+typedef struct {
+  uint8_t Second;
+  uint8_t Minute;
+  uint8_t Hour;
+  uint8_t Wday;   //day of week, sunday is day 1
+  uint8_t Day;
+  uint8_t Month;
+  uint8_t Year;   //offset from 1970
+} tmElements_t;
+
+#define SECS_PER_MIN ((time_t)(60UL))
+#define SECS_PER_HOUR ((time_t)(3600UL))
+#define SECS_PER_DAY ((time_t)(SECS_PER_HOUR * 24UL))
+#define DAYS_PER_WEEK ((time_t)(7UL))
+#define SECS_PER_WEEK ((time_t)(SECS_PER_DAY * DAYS_PER_WEEK))
+
+#define numberOfSeconds(_time_) ((_time_) % SECS_PER_MIN)
+#define numberOfMinutes(_time_) (((_time_) / SECS_PER_MIN) % SECS_PER_MIN)
+#define numberOfHours(_time_) (((_time_) % SECS_PER_DAY) / SECS_PER_HOUR)
+#define dayOfWeek(_time_) ((((_time_) / SECS_PER_DAY + 4) % DAYS_PER_WEEK) + 1)
+#define elapsedDays(_time_) ((_time_) / SECS_PER_DAY)
+#define elapsedSecsToday(_time_) ((_time_) % SECS_PER_DAY)
+#define previousMidnight(_time_) (((_time_) / SECS_PER_DAY) * SECS_PER_DAY)
+#define nextMidnight(_time_) (previousMidnight(_time_) + SECS_PER_DAY)
+
+int hour();
+int hour(time_t t);
+int minute();
+int minute(time_t t);
+int second();
+int second(time_t t);
+int day();
+int day(time_t t);
+int weekday();
+int weekday(time_t t);
+int month();
+int month(time_t t);
+int year();
+int year(time_t t);
+
+time_t now();
+void setTime(time_t t);
+void setTime(int hr, int min, int sec, int day, int month, int yr);
+
+void breakTime(time_t time, tmElements_t& tm);
+time_t makeTime(const tmElements_t& tm);
+
+#endif
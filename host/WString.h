@@ -0,0 +1,113 @@
+/**
+ * IIRR -- Intelligent Irrigator Based on ESP8266
+    Copyright (C) 2016--2019  Sergio Queiroz <srmq@cin.ufpe.br>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef _HOST_WSTRING_H_
+#define _HOST_WSTRING_H_
+
+#include <stddef.h>
+#include <string>
+
+class __FlashStringHelper;
+#define F(string_literal) (reinterpret_cast<const __FlashStringHelper *>(string_literal))
+#define FPSTR(pstr_pointer) (reinterpret_cast<const __FlashStringHelper *>(pstr_pointer))
+
+//Arduino String on top of std::string
+class String {
+public:
+  String(const char *cstr = "") : str(cstr != NULL ? cstr : "") { }
+  String(const __FlashStringHelper *pstr) : str(reinterpret_cast<const char *>(pstr)) { }
+  String(const std::string& s) : str(s) { }
+  explicit String(char c) : str(1, c) { }
+  explicit String(unsigned char value, unsigned char base = 10);
+  explicit String(int value, unsigned char base = 10);
+  explicit String(unsigned int value, unsigned char base = 10);
+  explicit String(long value, unsigned char base = 10);
+  explicit String(unsigned long value, unsigned char base = 10);
+  explicit String(float value, unsigned char decimalPlaces = 2);
+  explicit String(double value, unsigned char decimalPlaces = 2);
+
+  unsigned int length() const { return str.length(); }
+  const char *c_str() const { return str.c_str(); }
+  void reserve(unsigned int size) { str.reserve(size); }
+
+  bool concat(const String& s) { str += s.str; return true; }
+  bool concat(const char *cstr) { if (cstr != NULL) str += cstr; return true; }
+  bool concat(const __FlashStringHelper *pstr) { return concat(reinterpret_cast<const char *>(pstr)); }
+  bool concat(char c) { str += c; return true; }
+  bool concat(unsigned char value) { return concat(String(value)); }
+  bool concat(int value) { return concat(String(value)); }
+  bool concat(unsigned int value) { return concat(String(value)); }
+  bool concat(long value) { return concat(String(value)); }
+  bool concat(unsigned long value) { return concat(String(value)); }
+  bool concat(float value) { return concat(String(value)); }
+  bool concat(double value) { return concat(String(value)); }
+
+  template<typename T> String& operator+=(const T& value) { concat(value); return *this; }
+
+  int compareTo(const String& s) const { return str.compare(s.str); }
+  bool equals(const String& s) const { return str == s.str; }
+  bool equals(const char *cstr) const { return str == (cstr != NULL ? cstr : ""); }
+  bool equalsIgnoreCase(const String& s) const;
+  bool operator==(const String& s) const { return equals(s); }
+  bool operator==(const char *cstr) const { return equals(cstr); }
+  bool operator!=(const String& s) const { return !equals(s); }
+  bool operator!=(const char *cstr) const { return !equals(cstr); }
+  bool operator<(const String& s) const { return str < s.str; }
+  bool startsWith(const String& prefix) const { return str.compare(0, prefix.str.length(), prefix.str) == 0; }
+  bool startsWith(const String& prefix, unsigned int offset) const;
+  bool endsWith(const String& suffix) const;
+
+  char charAt(unsigned int index) const { return (index < str.length()) ? str[index] : 0; }
+  void setCharAt(unsigned int index, char c) { if (index < str.length()) str[index] = c; }
+  char operator[](unsigned int index) const { return charAt(index); }
+  char& operator[](unsigned int index) { return str[index]; }
+  void toCharArray(char *buf, unsigned int bufsize, unsigned int index = 0) const;
+
+  int indexOf(char c, unsigned int fromIndex = 0) const;
+  int indexOf(const String& s, unsigned int fromIndex = 0) const;
+  int lastIndexOf(char c) const;
+  String substring(unsigned int beginIndex) const { return substring(beginIndex, str.length()); }
+  String substring(unsigned int beginIndex, unsigned int endIndex) const;
+
+  void replace(const String& find, const String& replacement);
+  void remove(unsigned int index) { if (index < str.length()) str.erase(index); }
+  void remove(unsigned int index, unsigned int count) { if (index < str.length()) str.erase(index, count); }
+  void toLowerCase();
+  void toUpperCase();
+  void trim();
+
+  long toInt() const { return atol(str.c_str()); }
+  float toFloat() const { return (float)atof(str.c_str()); }
+
+private:
+  std::string str;
+};
+
+inline String operator+(const String& lhs, const String& rhs) { String result(lhs); result.concat(rhs); return result; }
+inline String operator+(const String& lhs, const char *rhs) { String result(lhs); result.concat(rhs); return result; }
+inline String operator+(const char *lhs, const String& rhs) { String result(lhs); result.concat(rhs); return result; }
+inline String operator+(const String& lhs, char rhs) { String result(lhs); result.concat(rhs); return result; }
+inline String operator+(const String& lhs, const __FlashStringHelper *rhs) { String result(lhs); result.concat(rhs); return result; }
+inline String operator+(const String& lhs, int rhs) { String result(lhs); result.concat(rhs); return result; }
+inline String operator+(const String& lhs, unsigned int rhs) { String result(lhs); result.concat(rhs); return result; }
+inline String operator+(const String& lhs, long rhs) { String result(lhs); result.concat(rhs); return result; }
+inline String operator+(const String& lhs, unsigned long rhs) { String result(lhs); result.concat(rhs); return result; }
+inline String operator+(const String& lhs, float rhs) { String result(lhs); result.concat(rhs); return result; }
+inline String operator+(const String& lhs, double rhs) { String result(lhs); result.concat(rhs); return result; }
+
+#endif
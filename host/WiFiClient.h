@@ -0,0 +1,42 @@
+/**
+ * IIRR -- Intelligent Irrigator Based on ESP8266
+    Copyright (C) 2016--2019  Sergio Queiroz <srmq@cin.ufpe.br>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef _HOST_WIFICLIENT_H_
+#define _HOST_WIFICLIENT_H_
+
+//TCP client for the host build, connections are always refused
+
+#include <Arduino.h>
+
+class WiFiClient : public Stream {
+public:
+  int connect(const char *host, uint16_t port) { return 0; }
+  uint8_t connected() { return 0; }
+  void stop() { }
+
+  virtual size_t write(uint8_t c) override { return 0; }
+  virtual size_t write(const uint8_t *buffer, size_t size) override { return 0; }
+  using Print::write;
+  size_t write(Stream& stream);
+  virtual int available() override { return 0; }
+  virtual int read() override { return -1; }
+  virtual int peek() override { return -1; }
+  virtual void flush() override { }
+};
+
+#endif
@@ -0,0 +1,208 @@
+/**
+ * IIRR -- Intelligent Irrigator Based on ESP8266
+    Copyright (C) 2016--2019  Sergio Queiroz <srmq@cin.ufpe.br>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+//Per-read overhead of the probe path on the host build.
+//Usage: bench_probe_read [rounds]
+//1. Addressing: the per-pin writes of the former selectSensor and
+//   enableSensorVoltage against the GpioMasks leases through MuxArbiter.
+//   Both go through the Hal, pin writes and register stores are counted.
+//2. Conversion: MoistureCurve fixed point against the float log/exp path
+//   and against pow(). Exits with an error if the fixed point result is
+//   more than MAX_ABS_ERROR away from pow().
+
+#include "Hal.h"
+#include "MuxAddress.h"
+#include "MuxArbiter.h"
+#include "MoistureCurve.h"
+#include "global_funcs.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+#define MAX_ABS_ERROR 2e-4
+#define CURVE_POINTS 4096
+
+class CountingBackend : public LinuxHalBackend {
+public:
+  unsigned long pinWrites;
+  unsigned long analogReads;
+
+  CountingBackend() : pinWrites(0), analogReads(0) { }
+
+  virtual void digitalWrite(uint8_t pin, uint8_t val) override {
+    pinWrites++;
+    LinuxHalBackend::digitalWrite(pin, val);
+  }
+
+  virtual int analogRead(uint8_t pin) override {
+    analogReads++;
+    return LinuxHalBackend::analogRead(pin);
+  }
+};
+
+typedef std::chrono::steady_clock BenchClock;
+
+static double nsSince(const BenchClock::time_point& start, unsigned long calls) {
+  const std::chrono::duration<double, std::nano> elapsed = BenchClock::now() - start;
+  return elapsed.count()/calls;
+}
+
+static void writeAddress(int address, uint8_t p0, uint8_t p1, uint8_t p2) {
+  Hal::halDigitalWrite(p0, (address & 1) ? HIGH : LOW);
+  Hal::halDigitalWrite(p1, (address & 2) ? HIGH : LOW);
+  Hal::halDigitalWrite(p2, (address & 4) ? HIGH : LOW);
+}
+
+//the former readVoltage(): decoder, mux, enable, read, disable
+static int switchReadVoltage(int decoderOutput, SensorInput input) {
+  writeAddress(decoderOutput, DECOD_A0_PIN, DECOD_A1_PIN, DECOD_A2_PIN);
+  writeAddress(input, MULA_PIN, MULB_PIN, MULC_PIN);
+  enableMulAndDecod();
+  const int value = Hal::halAnalogRead(ANALOG_PIN);
+  disableMulAndDecod();
+  return value;
+}
+
+static int switchProbeRead(int sType, int sDir) {
+  const int output = 2*sType + sDir;
+  const int afterSensor = 2*sType + (sDir == LEFT ? RIGHT : LEFT);
+  return switchReadVoltage(output, SensorInput(output)) - switchReadVoltage(output, SensorInput(afterSensor));
+}
+
+static int maskProbeRead(const GpioMasks& reference, const GpioMasks& afterSensor) {
+  MuxArbiter::acquire(MUX_PROBES, reference);
+  const int refVoltage = Hal::halAnalogRead(ANALOG_PIN);
+  MuxArbiter::select(MUX_PROBES, afterSensor);
+  const int afterSensorVoltage = Hal::halAnalogRead(ANALOG_PIN);
+  MuxArbiter::release(MUX_PROBES);
+  return refVoltage - afterSensorVoltage;
+}
+
+//GPOS and GPOC, plus GP16O when GPIO16 is addressed
+static unsigned int boardStores(const GpioMasks& masks) {
+  return 2 + (((masks.setMask | masks.clearMask) & HAL_GPIO16_MASK) ? 1 : 0);
+}
+
+static void benchAddressing(unsigned long rounds) {
+  CountingBackend backend;
+  Hal::setBackend(&backend);
+  MuxArbiter::begin();
+  GpioMasks references[6] = {GpioMasks(0, 0), GpioMasks(0, 0), GpioMasks(0, 0), GpioMasks(0, 0), GpioMasks(0, 0), GpioMasks(0, 0)};
+  GpioMasks afterSensors[6] = {GpioMasks(0, 0), GpioMasks(0, 0), GpioMasks(0, 0), GpioMasks(0, 0), GpioMasks(0, 0), GpioMasks(0, 0)};
+  unsigned int maskStores = 0;
+  for (int probe = 0; probe < 6; probe++) {
+    const int sType = probe/2;
+    const int sDir = probe % 2;
+    references[probe] = decoderMasks(probe) | muxMasks(SensorInput(probe));
+    afterSensors[probe] = muxMasks(SensorInput(2*sType + (sDir == LEFT ? RIGHT : LEFT)));
+    maskStores += boardStores(references[probe]) + boardStores(afterSensors[probe]);
+  }
+  const unsigned long reads = rounds*6;
+  long checksum = 0;
+
+  backend.pinWrites = backend.analogReads = 0;
+  BenchClock::time_point start = BenchClock::now();
+  for (unsigned long r = 0; r < rounds; r++) {
+    for (int probe = 0; probe < 6; probe++) checksum += switchProbeRead(probe/2, probe % 2);
+  }
+  const double switchNs = nsSince(start, reads);
+  const double switchWrites = double(backend.pinWrites)/reads;
+
+  backend.pinWrites = backend.analogReads = 0;
+  //the inhibit pin is still written pin by pin, count it apart from the masks
+  unsigned long inhibitWrites = 0;
+  start = BenchClock::now();
+  for (unsigned long r = 0; r < rounds; r++) {
+    for (int probe = 0; probe < 6; probe++) {
+      const unsigned long before = backend.pinWrites;
+      checksum += maskProbeRead(references[probe], afterSensors[probe]);
+      if (r == 0) inhibitWrites += (backend.pinWrites - before);
+    }
+  }
+  const double maskNs = nsSince(start, reads);
+  const double maskHostWrites = double(backend.pinWrites)/reads;
+  //on the host every mask is replayed pin by pin, on the board it is a few stores
+  unsigned int replayedPins = 0;
+  for (int probe = 0; probe < 6; probe++) {
+    for (uint8_t pin = 0; pin < HAL_NUM_PINS; pin++) {
+      const uint32_t bit = 1ul << pin;
+      if ((references[probe].setMask | references[probe].clearMask) & bit) replayedPins++;
+      if ((afterSensors[probe].setMask | afterSensors[probe].clearMask) & bit) replayedPins++;
+    }
+  }
+  const double maskPinWrites = double(inhibitWrites - replayedPins)/6;
+
+  printf("probe read addressing, %lu reads (checksum %ld)\n", reads, checksum);
+  printf("  pin by pin: %6.1f ns on the host, %4.1f pin writes on the board\n", switchNs, switchWrites);
+  printf("  GpioMasks : %6.1f ns on the host (%4.1f replayed pin writes), %4.1f pin writes + %4.1f register stores on the board\n",
+         maskNs, maskHostWrites, maskPinWrites, double(maskStores)/6);
+  Hal::setBackend(NULL);
+}
+
+static bool benchConversion(unsigned long rounds) {
+  static long resistances[CURVE_POINTS];
+  //log spaced from 100 ohm to 20 Mohm
+  for (int i = 0; i < CURVE_POINTS; i++) {
+    resistances[i] = long(100*pow(200000.0, double(i)/(CURVE_POINTS - 1)) + 0.5);
+  }
+  const MoistureCurve curve;
+  double maxAbsError = 0;
+  for (int i = 0; i < CURVE_POINTS; i++) {
+    double expected = pow(curve.getMulX()/resistances[i], 1/curve.getExpFact());
+    if (expected > 1) expected = 1;
+    const double error = fabs(curve.toMoisture(resistances[i]) - expected);
+    if (error > maxAbsError) maxAbsError = error;
+  }
+
+  const unsigned long calls = rounds*CURVE_POINTS;
+  uint64_t fixedSum = 0;
+  BenchClock::time_point start = BenchClock::now();
+  for (unsigned long r = 0; r < rounds; r++) {
+    for (int i = 0; i < CURVE_POINTS; i++) fixedSum += curve.toMoistureQ16(resistances[i]);
+  }
+  const double fixedNs = nsSince(start, calls);
+
+  double floatSum = 0;
+  start = BenchClock::now();
+  for (unsigned long r = 0; r < rounds; r++) {
+    for (int i = 0; i < CURVE_POINTS; i++) floatSum += curve.toMoistureFloat(resistances[i]);
+  }
+  const double floatNs = nsSince(start, calls);
+
+  double powSum = 0;
+  const double mulX = curve.getMulX();
+  const double invExpFact = 1/curve.getExpFact();
+  start = BenchClock::now();
+  for (unsigned long r = 0; r < rounds; r++) {
+    for (int i = 0; i < CURVE_POINTS; i++) powSum += std::min(1.0, pow(mulX/resistances[i], invExpFact));
+  }
+  const double powNs = nsSince(start, calls);
+
+  printf("resistance to moisture, %lu conversions (checksums %.0f %.0f %.0f)\n", calls,
+         double(fixedSum)/MOISTURE_Q16_ONE, floatSum, powSum);
+  printf("  fixed point Q16: %6.1f ns, max abs error %.2e\n", fixedNs, maxAbsError);
+  printf("  float log/exp  : %6.1f ns\n", floatNs);
+  printf("  double pow     : %6.1f ns\n", powNs);
+  return maxAbsError <= MAX_ABS_ERROR;
+}
+
+int main(int argc, char **argv) {
+  const unsigned long rounds = (argc > 1) ? strtoul(argv[1], NULL, 10) : 2000;
+  benchAddressing(rounds*100);
+  return benchConversion(rounds) ? 0 : 1;
+}
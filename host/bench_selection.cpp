@@ -0,0 +1,113 @@
+/**
+ * IIRR -- Intelligent Irrigator Based on ESP8266
+    Copyright (C) 2016--2019  Sergio Queiroz <srmq@cin.ufpe.br>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+//Compares SelectionKernel with the exchange sort readMoisture used before
+//it, for the NUM_PROBES of the board and for larger probe counts.
+//Usage: bench_selection [rounds]
+//Prints ns per call for each size, exits with an error if the median or
+//a quartile differs from the one of a full sort.
+
+#include "SelectionKernel.h"
+#include "sensor_calibration.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#define BENCH_SETS 4096
+
+//the former sortResistances()
+template<int N>
+static void exchangeSort(long values[N]) {
+  for (int i = 0; i < N - 1; i++) {
+    for (int j = i + 1; j < N; j++) {
+      if (values[j] < values[i]) {
+        const long tmp = values[i];
+        values[i] = values[j];
+        values[j] = tmp;
+      }
+    }
+  }
+}
+
+static unsigned long rngState = 1;
+
+static long nextResistance() {
+  rngState = rngState*1103515245ul + 12345ul;
+  return 1000 + (long)((rngState >> 8) % 200000);
+}
+
+template<int N>
+static double nsPerCall(const long sets[BENCH_SETS][N], unsigned long rounds, bool useKernel, long& checksum) {
+  long values[N];
+  const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for (unsigned long r = 0; r < rounds; r++) {
+    for (int s = 0; s < BENCH_SETS; s++) {
+      memcpy(values, sets[s], sizeof(values));
+      if (useKernel) {
+        const ProbeStats<long> stats = SelectionKernel<long, N>::quantiles(values);
+        checksum += stats.median + stats.iqr();
+      } else {
+        exchangeSort<N>(values);
+        checksum += values[N/2] + (values[(3*N)/4] - values[N/4]);
+      }
+    }
+  }
+  const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+  return elapsed.count()/(rounds*BENCH_SETS);
+}
+
+template<int N>
+static bool benchSize(unsigned long rounds) {
+  static long sets[BENCH_SETS][N];
+  bool ok = true;
+  for (int s = 0; s < BENCH_SETS; s++) {
+    for (int i = 0; i < N; i++) sets[s][i] = nextResistance();
+    //sorted and constant inputs are the worst cases of a naive quickselect
+    if (s == 1) exchangeSort<N>(sets[s]);
+    if (s == 2) for (int i = 0; i < N; i++) sets[s][i] = 5000;
+
+    long sorted[N];
+    long selected[N];
+    memcpy(sorted, sets[s], sizeof(sorted));
+    memcpy(selected, sets[s], sizeof(selected));
+    exchangeSort<N>(sorted);
+    const ProbeStats<long> stats = SelectionKernel<long, N>::quantiles(selected);
+    if (stats.median != sorted[N/2] || stats.lowerQuartile != sorted[N/4] || stats.upperQuartile != sorted[(3*N)/4]) {
+      printf("N=%d set %d: kernel %ld/%ld/%ld, sort %ld/%ld/%ld\n", N, s, stats.lowerQuartile, stats.median,
+             stats.upperQuartile, sorted[N/4], sorted[N/2], sorted[(3*N)/4]);
+      ok = false;
+    }
+  }
+  long sortChecksum = 0;
+  long kernelChecksum = 0;
+  const double sortNs = nsPerCall<N>(sets, rounds, false, sortChecksum);
+  const double kernelNs = nsPerCall<N>(sets, rounds, true, kernelChecksum);
+  if (sortChecksum != kernelChecksum) ok = false;
+  printf("%3d samples: exchange sort %8.1f ns, selection kernel %8.1f ns, %5.2fx\n", N, sortNs, kernelNs, sortNs/kernelNs);
+  return ok;
+}
+
+int main(int argc, char **argv) {
+  const unsigned long rounds = (argc > 1) ? strtoul(argv[1], NULL, 10) : 50;
+  bool ok = benchSize<NUM_PROBES>(rounds);
+  ok = benchSize<31>(rounds) && ok;
+  ok = benchSize<63>(rounds) && ok;
+  ok = benchSize<127>(rounds) && ok;
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,66 @@
+/**
+ * IIRR -- Intelligent Irrigator Based on ESP8266
+    Copyright (C) 2016--2019  Sergio Queiroz <srmq@cin.ufpe.br>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+//Runs the sensor task against the soil simulator and prints its stats.
+//Usage: iirr_sim [days] [wellLiters] [wellRechargePerMin]
+//Exits with an error if the pump never started, ran dry, or no start was
+//measured as a decision.
+
+#include "Hal.h"
+#include "SoilSimulator.h"
+#include "SensorTask.h"
+#include <FS.h>
+
+extern bool fsOpen;
+
+int main(int argc, char **argv) {
+  const unsigned long days = (argc > 1) ? strtoul(argv[1], NULL, 10) : 7;
+  SimParams simParams;
+  if (argc > 2) simParams.wellLiters = atof(argv[2]);
+  if (argc > 3) simParams.wellRechargePerMin = atof(argv[3]);
+
+  SoilSimulator sim(simParams);
+  Hal::setBackend(&sim);
+  HostFS::reset();
+  fsOpen = SPIFFS.begin();
+
+  ConfParams confParams;
+  confParams.irrSlotSeconds = 600;
+  confParams.irrMIntervMins = 60;
+  confParams.irrMaxTimeDaySeconds = 3600;
+  confParams.critLevel = 0.45;
+  confParams.satLevel = 0.65;
+  confParams.normalPulsesPerSec = 75;
+  confParams.pulsesPerLiter = 450;
+  //the pump governor of data/conf/params.json
+  confParams.hystFraction = 0.1;
+  confParams.minRunSecs = 60;
+  confParams.minRestSecs = 300;
+  confParams.maxStartsPerHour = 6;
+
+  SensorTask sensorTask;
+  const SimStats& stats = sim.run(sensorTask, confParams, days);
+
+  printf("days %lu cycles %lu starts %lu pumpOn %.0fs liters %.1f dryRun %.0fs decisions %lu early %lu avgLatency %.1fs maxLatency %.1fs well %.0f\n",
+         days, stats.sensorCycles, stats.pumpStarts, stats.pumpOnSecs, stats.litersUsed, stats.dryRunSecs,
+         stats.decisions, stats.earlyStarts, stats.decisions ? stats.sumDecisionLatencySecs/stats.decisions : 0,
+         stats.maxDecisionLatencySecs, sim.wellLevel());
+
+  Hal::setBackend(NULL);
+  return (stats.pumpStarts > 0 && stats.dryRunSecs == 0 && stats.decisions > 0) ? 0 : 1;
+}
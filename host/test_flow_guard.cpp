@@ -0,0 +1,87 @@
+/**
+ * IIRR -- Intelligent Irrigator Based on ESP8266
+    Copyright (C) 2016--2019  Sergio Queiroz <srmq@cin.ufpe.br>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+//FlowMonitor collapse guard: late edges from air bubbles must not stop
+//the pump, FLOW_COLLAPSE_LONG_PERIODS of them in a row or a silent
+//sensor must.
+
+#include "HostTest.h"
+#include "FlowMonitor.h"
+#include "MuxAddress.h"
+
+#define NORMAL_PERIOD_US 10000ul //100 pulses/s
+#define GUARD_PULSES_PER_SEC 50  //slowest accepted period is 20 ms
+
+class VirtualClockBackend : public LinuxHalBackend {
+public:
+  unsigned long nowUs;
+
+  VirtualClockBackend() : nowUs(1000000ul) { }
+  virtual unsigned long micros() override { return nowUs; }
+
+  void pulseAfter(unsigned long us) {
+    nowUs += us;
+    fireInterrupt(FLOWSIGNAL_PIN);
+  }
+};
+
+static VirtualClockBackend backend;
+
+static void startPump() {
+  FlowMonitor::stopCoverage();
+  Hal::halDigitalWrite(PUMP_PIN, HIGH);
+  FlowMonitor::armCollapseGuard(GUARD_PULSES_PER_SEC, GpioMasks(0, pinBit(PUMP_PIN)));
+  FlowMonitor::startCoverage();
+  for (int i = 0; i < 100; i++) backend.pulseAfter(NORMAL_PERIOD_US);
+}
+
+static bool pumpIsOn() {
+  return Hal::halDigitalRead(PUMP_PIN) == HIGH;
+}
+
+int main() {
+  beginTest(&backend);
+  FlowMonitor::begin();
+
+  startPump();
+  check(!FlowMonitor::hasCollapsed() && pumpIsOn(), "steady flow keeps the pump on");
+
+  //an air bubble: one late edge, then the flow comes back
+  backend.pulseAfter(4*NORMAL_PERIOD_US);
+  for (int i = 0; i < 10; i++) backend.pulseAfter(NORMAL_PERIOD_US);
+  check(!FlowMonitor::hasCollapsed() && pumpIsOn(), "one late edge does not stop the pump");
+
+  //a late edge less than the debounce, in a row
+  for (int i = 1; i < FLOW_COLLAPSE_LONG_PERIODS; i++) backend.pulseAfter(3*NORMAL_PERIOD_US);
+  backend.pulseAfter(NORMAL_PERIOD_US);
+  check(!FlowMonitor::hasCollapsed() && pumpIsOn(), "late edges short of FLOW_COLLAPSE_LONG_PERIODS do not stop the pump");
+
+  //the well runs dry: every period is late
+  for (int i = 0; i < FLOW_COLLAPSE_LONG_PERIODS; i++) backend.pulseAfter(3*NORMAL_PERIOD_US);
+  check(FlowMonitor::hasCollapsed() && !pumpIsOn(), "FLOW_COLLAPSE_LONG_PERIODS late edges in a row stop the pump");
+
+  //the sensor goes silent: no edge for the ISR, the poll catches it
+  startPump();
+  check(!FlowMonitor::hasCollapsed() && pumpIsOn(), "rearming clears the collapse");
+  backend.nowUs += (FLOW_COLLAPSE_PERIODS - 1)*2*NORMAL_PERIOD_US;
+  check(!FlowMonitor::hasCollapsed() && pumpIsOn(), "a short silence does not stop the pump");
+  backend.nowUs += 4*NORMAL_PERIOD_US;
+  check(FlowMonitor::hasCollapsed() && !pumpIsOn(), "FLOW_COLLAPSE_PERIODS of silence stop the pump");
+
+  return endTest("flow guard");
+}
@@ -0,0 +1,107 @@
+/**
+ * IIRR -- Intelligent Irrigator Based on ESP8266
+    Copyright (C) 2016--2019  Sergio Queiroz <srmq@cin.ufpe.br>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+//LogCatalog with more log files than LOG_CATALOG_SIZE: the oldest are
+//left out and counted, and LogRetention finds and deletes them from the
+//directory before the cataloged ones.
+
+#include "HostTest.h"
+#include "LogCatalog.h"
+#include "LogRetention.h"
+#include "TimeKeeper.h"
+#include "global_funcs.h"
+
+#define EXTRA_DAYS 10
+#define NUM_DAYS (LOG_CATALOG_SIZE/LOG_KINDS + EXTRA_DAYS)
+
+static LinuxHalBackend backend;
+
+static void logName(uint8_t kind, time_t date, char *out, size_t size) {
+  LogSegment segment;
+  segment.kind = kind;
+  segment.day = elapsedDays(date);
+  LogCatalog::fileName(segment, out, size);
+}
+
+static void writeLog(uint8_t kind, time_t date) {
+  char name[LOG_CATALOG_ENTRY_SIZE];
+  logName(kind, date, name, sizeof(name));
+  File file = SPIFFS.open(name, "w");
+  file.print(F("20190101T000000Z,0.5,0.5,0.5\n"));
+  file.close();
+}
+
+static int filesOnFS() {
+  int count = 0;
+  Dir logDir = SPIFFS.openDir(String(FPSTR(LOG_DIR)));
+  while (logDir.next()) count++;
+  return count;
+}
+
+int main() {
+  beginTest(&backend);
+  const time_t today = TimeKeeper::tkMakeTime(2019, 6, 1, 12, 0, 0);
+  backend.setNow(today);
+  const time_t firstDate = previousMidnight(today) - (NUM_DAYS - 1)*SECS_PER_DAY;
+  for (int d = 0; d < NUM_DAYS; d++) {
+    for (uint8_t kind = 0; kind < LOG_KINDS; kind++) writeLog(kind, firstDate + d*SECS_PER_DAY);
+  }
+
+  check(!LogCatalog::build(), "build() reports the files left out");
+  check(LogCatalog::count() == LOG_CATALOG_SIZE, "the catalog is full");
+  check(LogCatalog::dropped() == EXTRA_DAYS*LOG_KINDS, "every file left out is counted");
+  const time_t oldestKept = firstDate + EXTRA_DAYS*SECS_PER_DAY;
+  for (uint8_t kind = 0; kind < LOG_KINDS; kind++) {
+    check(LogCatalog::firstFrom(kind, 0) != NULL && LogCatalog::firstFrom(kind, 0)->date() == oldestKept, "the newest files are kept");
+  }
+
+  //a new file pushes out the oldest one
+  writeLog(LOGKIND_SENSOR, previousMidnight(today) + SECS_PER_DAY);
+  LogCatalog::opened(LOGKIND_SENSOR, today + SECS_PER_DAY, 100);
+  check(LogCatalog::find(LOGKIND_SENSOR, today + SECS_PER_DAY) != NULL, "a new file is cataloged when full");
+  check(LogCatalog::dropped() == EXTRA_DAYS*LOG_KINDS + 1, "the file it pushed out is counted");
+
+  //retention deletes what was left out first, oldest first
+  ConfParams conf;
+  LogRetention retention(NULL);
+  unsigned long nowMs = 0;
+  const int leftOut = LogCatalog::dropped();
+  for (int i = 0; i < leftOut; i++) {
+    const int before = filesOnFS();
+    check(retention.step(conf, FS_LOG_KEEP_DAYS, today, nowMs += 1000), "retention step succeeds");
+    check(filesOnFS() == before - 1, "each step deletes one file");
+  }
+  bool oldestGone = true;
+  for (int d = 0; d <= EXTRA_DAYS; d++) {
+    char name[LOG_CATALOG_ENTRY_SIZE];
+    logName(LOGKIND_SENSOR, firstDate + d*SECS_PER_DAY, name, sizeof(name));
+    if (SPIFFS.exists(name)) oldestGone = false;
+    logName(LOGKIND_MSG, firstDate + d*SECS_PER_DAY, name, sizeof(name));
+    if (d < EXTRA_DAYS && SPIFFS.exists(name)) oldestGone = false;
+  }
+  check(oldestGone, "the files left out are the ones deleted");
+  check(LogCatalog::dropped() == 0, "the catalog has every file again");
+  check(LogCatalog::count() == LOG_CATALOG_SIZE, "the cataloged files are deleted after");
+
+  //and then the cataloged ones past keepDays, until none is left
+  for (int i = 0; i < NUM_DAYS*LOG_KINDS; i++) retention.step(conf, FS_LOG_KEEP_DAYS, today, nowMs += 1000);
+  check(filesOnFS() == LogCatalog::count(), "the catalog names every file on the FS");
+  check(LogCatalog::firstFrom(LOGKIND_SENSOR, 0)->date() >= previousMidnight(today) - FS_LOG_KEEP_DAYS*SECS_PER_DAY, "nothing older than keepDays is left");
+
+  return endTest("log catalog");
+}
@@ -0,0 +1,93 @@
+/**
+ * IIRR -- Intelligent Irrigator Based on ESP8266
+    Copyright (C) 2016--2019  Sergio Queiroz <srmq@cin.ufpe.br>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+//The FS_MAX_OPEN_FILES budget of global_funcs.h: with both LogWriter
+//files and a cloud and a web reader open, a LogIndex rebuild still finds
+//a free handle, and nothing opens a sixth file.
+
+#include "HostTest.h"
+#include "LogWriter.h"
+#include "LogIndex.h"
+#include "LogCatalog.h"
+#include "TimeKeeper.h"
+#include "global_funcs.h"
+
+static_assert(HOST_FS_MAX_OPEN_FILES == FS_MAX_OPEN_FILES, "the host FS opens as many files as SPIFFS");
+
+#define NUM_RECORDS 200
+
+static LinuxHalBackend backend;
+
+static void writeRecords(LogWriter& log, time_t firstTime) {
+  for (int i = 0; i < NUM_RECORDS; i++) {
+    const time_t aTime = firstTime + i*60;
+    char tsStr[16];
+    snprintf_P(tsStr, 16, TS_FMT_STR, TimeKeeper::tkYear(aTime), TimeKeeper::tkMonth(aTime), TimeKeeper::tkDay(aTime), TimeKeeper::tkHour(aTime), TimeKeeper::tkMinute(aTime), TimeKeeper::tkSecond(aTime));
+    if (log.beginRecord(aTime)) {
+      log.print(tsStr);
+      log.println(F(",0.50,0.60,0.70"));
+    }
+  }
+  log.commit();
+}
+
+static bool hasIndex(const char* logName) {
+  char idxName[LOG_NAME_SIZE];
+  return LogIndex::indexName(logName, idxName, LOG_NAME_SIZE) && SPIFFS.exists(idxName);
+}
+
+int main() {
+  beginTest(&backend);
+  const time_t firstTime = TimeKeeper::tkMakeTime(2019, 6, 1, 0, 0, 0);
+  backend.setNow(firstTime);
+  LogCatalog::build();
+
+  LogWriter sensorLog(LOGKIND_SENSOR, LOGF_FMT_STR, NULL);
+  LogWriter msgLog(LOGKIND_MSG, MSGF_FMT_STR, NULL);
+  writeRecords(sensorLog, firstTime);
+  writeRecords(msgLog, firstTime);
+  check(HostFS::openFiles() == 2, "the writers keep their files open");
+
+  //a cloud send and a web download hold their files across task switches
+  File cloudFile = SPIFFS.open(sensorLog.getFileName(), "r");
+  File webFile = SPIFFS.open(msgLog.getFileName(), "r");
+  check(cloudFile && webFile && HostFS::openFiles() == 4, "the readers open their files");
+
+  //the cloud finds the index of its log gone
+  LogIndex::remove(sensorLog.getFileName());
+  const size_t hint = LogIndex::seekHint(cloudFile, firstTime + NUM_RECORDS*30);
+  check(hint > 0, "the index is rebuilt with the readers and writers open");
+  check(hasIndex(sensorLog.getFileName()), "the rebuilt index is on the FS");
+  check(HostFS::openFiles() == 4, "the rebuild leaves the files as they were");
+  check(cloudFile.seek(hint, SeekSet) && cloudFile.available() > 0, "the reader goes on from the hint");
+
+  //a writer opens its file again with the index gone
+  msgLog.close();
+  LogIndex::remove(msgLog.getFileName());
+  writeRecords(msgLog, firstTime + NUM_RECORDS*60);
+  check(hasIndex(msgLog.getFileName()), "the writer rebuilds the index of its file");
+
+  cloudFile.close();
+  webFile.close();
+  sensorLog.close();
+  msgLog.close();
+  printf("open files: at most %u of %d\n", HostFS::maxOpenFilesSeen(), FS_MAX_OPEN_FILES);
+  check(HostFS::maxOpenFilesSeen() <= FS_MAX_OPEN_FILES, "never more than FS_MAX_OPEN_FILES");
+
+  return endTest("open files");
+}
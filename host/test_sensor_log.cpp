@@ -0,0 +1,265 @@
+/**
+ * IIRR -- Intelligent Irrigator Based on ESP8266
+    Copyright (C) 2016--2019  Sergio Queiroz <srmq@cin.ufpe.br>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+//Binary sensor log: its CSV is byte for byte the text log Print wrote,
+//position() and seek() of the stream come back to the same line, and on
+//a full FS a short write is cut back to the last whole record, so every
+//line read afterwards is one that was written, and the records written
+//once there is space again follow in order.
+
+#include "HostTest.h"
+#include "LogWriter.h"
+#include "LogIndex.h"
+#include "LogCatalog.h"
+#include "SensorLog.h"
+#include "TimeKeeper.h"
+#include "global_funcs.h"
+#include "sensor_calibration.h"
+#include <cmath>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#define FS_BYTES (24*HOST_FS_PAGE_SIZE)
+#define FILLER_BYTES (8*HOST_FS_PAGE_SIZE)
+#define RECORD_SECS 60
+#define CSV_RECORDS 4000
+#define TEXT_LOG "/text.csv"
+#define BINARY_LOG "/binary.slb"
+
+static LinuxHalBackend backend;
+static time_t firstTime;
+
+static SensorLogRecord recordOf(int i) {
+  return SensorLogRecord(firstTime + i*RECORD_SECS, 10 + 0.01*i, 20.5 - 0.02*i, 30.25 + 0.1*(i % 7), (i % 5) == 0);
+}
+
+//as SensorTask::writeSensorRecord()
+static void writeRecord(LogWriter& log, int i) {
+  const SensorLogRecord record = recordOf(i);
+  if (!log.beginRecord(record.timeStamp)) return;
+  if (log.getFileSize() == 0) {
+    uint8_t header[SENSORLOG_HEADER_SIZE];
+    SensorLogRecord::encodeHeader(header, SensorLogRecord::baseTimeOf(record.timeStamp));
+    log.write(header, SENSORLOG_HEADER_SIZE);
+  }
+  uint8_t bytes[SENSORLOG_RECORD_SIZE];
+  record.encode(bytes, SensorLogRecord::baseTimeOf(record.timeStamp));
+  log.write(bytes, SENSORLOG_RECORD_SIZE);
+}
+
+//the lines of the log, each must be the CSV of a record written, in order.
+//Returns the number of the last record read, -1 when there is none
+static int checkLines(SensorLogStream& stream, int firstRecord, int& lines) {
+  char line[SENSORLOG_LINE_SIZE + 1];
+  int last = firstRecord - 1;
+  bool allWritten = true;
+  lines = 0;
+  while (stream.available() > 0) {
+    const size_t len = stream.readBytesUntil('\n', line, SENSORLOG_LINE_SIZE);
+    line[len] = '\0';
+    lines++;
+    int year, month, day, hour, min, secs;
+    if (sscanf(line, "%4d%2d%2dT%2d%2d%2d", &year, &month, &day, &hour, &min, &secs) != 6) {
+      allWritten = false;
+      break;
+    }
+    const int i = (TimeKeeper::tkMakeTime(year, month, day, hour, min, secs) - firstTime)/RECORD_SECS;
+    char expected[SENSORLOG_LINE_SIZE];
+    recordOf(i).toCSV(expected);
+    expected[strlen(expected) - 1] = '\0'; //readBytesUntil() leaves out the '\n'
+    if (i <= last || strcmp(line, expected) != 0) {
+      allWritten = false;
+      break;
+    }
+    last = i;
+  }
+  check(allWritten, "every line read is a record that was written, in order");
+  return last;
+}
+
+//moistures, read errors, negatives, values that round at .xx5 and that
+//print as -0.00, and a NaN
+static float csvValue(int i) {
+  switch (i % 8) {
+    case 0: return i/1000.0f;
+    case 1: return -i/1000.0f;
+    case 2: return (i/2)/100.0f + 0.005f;
+    case 3: return -0.004f*(i % 3);
+    case 4: return MOISTURE_READERROR;
+    case 5: return NAN;
+    case 6: return 327.67f - i/100000.0f;
+    default: return (i % 1000)/1000.0f;
+  }
+}
+
+//the same records as the text log of before, by Print, and as the binary log
+static void writeCSVLogs(float (*valueOf)(int), int numRecords) {
+  File text = SPIFFS.open(TEXT_LOG, "w");
+  File binary = SPIFFS.open(BINARY_LOG, "w");
+  uint8_t header[SENSORLOG_HEADER_SIZE];
+  SensorLogRecord::encodeHeader(header, firstTime);
+  binary.write(header, SENSORLOG_HEADER_SIZE);
+  for (int i = 0; i < numRecords; i++) {
+    const time_t aTime = firstTime + i*(SECS_PER_DAY/numRecords);
+    char tsStr[16];
+    snprintf_P(tsStr, 16, TS_FMT_STR, TimeKeeper::tkYear(aTime), TimeKeeper::tkMonth(aTime), TimeKeeper::tkDay(aTime), TimeKeeper::tkHour(aTime), TimeKeeper::tkMinute(aTime), TimeKeeper::tkSecond(aTime));
+    const float surface = valueOf(i), middle = valueOf(i + 1), deep = valueOf(i + 2);
+    text.print(tsStr);
+    text.print(',');
+    text.print(surface);
+    text.print(',');
+    text.print(middle);
+    text.print(',');
+    text.print(deep);
+    text.print(',');
+    text.println((i % 3) == 0 ? '1' : '0');
+    uint8_t bytes[SENSORLOG_RECORD_SIZE];
+    SensorLogRecord(aTime, surface, middle, deep, (i % 3) == 0).encode(bytes, firstTime);
+    binary.write(bytes, SENSORLOG_RECORD_SIZE);
+  }
+  text.close();
+  binary.close();
+}
+
+static std::string readAll(Stream& stream) {
+  std::string all;
+  int c;
+  while ((c = stream.read()) >= 0) all += (char)c;
+  return all;
+}
+
+static void testCSV() {
+  HostFS::reset();
+  writeCSVLogs(csvValue, CSV_RECORDS);
+  File text = SPIFFS.open(TEXT_LOG, "r");
+  File binary = SPIFFS.open(BINARY_LOG, "r");
+  SensorLogStream textStream(text);
+  SensorLogStream binaryStream(binary);
+  check(!textStream.isBinary() && binaryStream.isBinary(), "each log is read as what it is");
+  check(binaryStream.csvSize() == text.size(), "csvSize() is the size of the text log");
+  const std::string textCSV = readAll(textStream);
+  const std::string binaryCSV = readAll(binaryStream);
+  check(binaryCSV == textCSV, "the binary log reads as the text log, byte for byte");
+  size_t firstDiff = 0;
+  while (firstDiff < textCSV.size() && firstDiff < binaryCSV.size() && textCSV[firstDiff] == binaryCSV[firstDiff]) firstDiff++;
+  if (firstDiff < textCSV.size()) {
+    const size_t lineStart = textCSV.rfind('\n', firstDiff) + 1;
+    printf("sensor log: text and binary differ at %s", textCSV.substr(lineStart, textCSV.find('\n', firstDiff) + 1 - lineStart).c_str());
+  }
+  text.close();
+  binary.close();
+
+  //out of the int16 range the value is clipped
+  const SensorLogRecord clipped(firstTime, 500, -1e6, INFINITY, false);
+  char line[SENSORLOG_LINE_SIZE];
+  clipped.toCSV(line);
+  check(strcmp(line, "20190601T000000,327.67,-327.67,327.67,0\r\n") == 0, "values past +-327.67 are clipped to it");
+}
+
+//position() before each line, seek() back to it, from the end to the start
+static void testSeek() {
+  HostFS::reset();
+  writeCSVLogs(csvValue, 300);
+  File binary = SPIFFS.open(BINARY_LOG, "r");
+  SensorLogStream stream(binary);
+  std::vector<size_t> positions;
+  std::vector<std::string> lines;
+  char line[SENSORLOG_LINE_SIZE + 1];
+  while (stream.available() > 0) {
+    positions.push_back(stream.position());
+    const size_t len = stream.readBytesUntil('\n', line, SENSORLOG_LINE_SIZE);
+    lines.push_back(std::string(line, len));
+  }
+  check(lines.size() == 300, "a line per record");
+  bool allBack = true;
+  for (int i = lines.size() - 1; i >= 0; i--) {
+    stream.seek(positions[i]);
+    const size_t len = stream.readBytesUntil('\n', line, SENSORLOG_LINE_SIZE);
+    if (std::string(line, len) != lines[i]) allBack = false;
+  }
+  check(allBack, "seek() to a position() reads the same line again");
+
+  //in the middle of a line position() is its record, csvSize() keeps the place
+  stream.seek(positions[10]);
+  stream.readBytes(line, 5);
+  check(stream.position() == positions[10], "position() inside a line is its record");
+  stream.csvSize();
+  const size_t len = stream.readBytesUntil('\n', line, SENSORLOG_LINE_SIZE);
+  check(std::string(line, len) == lines[10].substr(5), "csvSize() leaves the line where it was");
+  check(stream.position() == positions[11], "the next line follows");
+  binary.close();
+}
+
+static void testShortWrite() {
+  HostFS::reset(FS_BYTES);
+  LogCatalog::build();
+  File filler = SPIFFS.open("/filler", "w");
+  for (int i = 0; i < FILLER_BYTES; i++) filler.write('x');
+  filler.close();
+
+  LogWriter sensorLog(LOGKIND_SENSOR, LOGF_FMT_STR, NULL);
+  sensorLog.setRecordSize(SENSORLOG_HEADER_SIZE, SENSORLOG_RECORD_SIZE);
+  int numRecords = 0;
+  size_t fileSize;
+  do {
+    fileSize = sensorLog.getFileSize();
+    writeRecord(sensorLog, numRecords++);
+    sensorLog.commit();
+  } while (sensorLog.getFileSize() > fileSize);
+  printf("sensor log: full at %lu bytes, record %d\n", (unsigned long)fileSize, numRecords - 1);
+  check((fileSize - SENSORLOG_HEADER_SIZE) % SENSORLOG_RECORD_SIZE == 0, "the full log ends on a whole record");
+
+  //space again, the log goes on
+  SPIFFS.remove("/filler");
+  const int resumedAt = numRecords;
+  for (int i = 0; i < 50; i++) writeRecord(sensorLog, numRecords++);
+  sensorLog.close();
+
+  File file = SPIFFS.open(sensorLog.getFileName(), "r");
+  check((file.size() - SENSORLOG_HEADER_SIZE) % SENSORLOG_RECORD_SIZE == 0, "the log is whole records");
+  SensorLogStream stream(file);
+  check(stream.isBinary(), "the header survives");
+  int lines;
+  const int last = checkLines(stream, 0, lines);
+  check(lines == (int)(file.size() - SENSORLOG_HEADER_SIZE)/SENSORLOG_RECORD_SIZE, "a line per record");
+  check(last == numRecords - 1, "the records after the cut are all there");
+
+  //the index points at whole records, also past the cut
+  const time_t afterCut = recordOf(resumedAt + 20).timeStamp;
+  const size_t hint = LogIndex::seekHint(file, afterCut);
+  check(hint == 0 || (hint - SENSORLOG_HEADER_SIZE) % SENSORLOG_RECORD_SIZE == 0, "the index points at a record");
+  stream.seek(hint);
+  const int fromHint = checkLines(stream, 0, lines);
+  check(fromHint == numRecords - 1 && lines > 0, "reading from the hint gets to the end");
+
+  //a seek into the middle of a record ends the text instead of rendering garbage
+  stream.seek(SENSORLOG_HEADER_SIZE + 4);
+  check(stream.available() == 0 && stream.read() == -1, "no line from the middle of a record");
+  file.close();
+}
+
+int main() {
+  beginTest(&backend);
+  firstTime = TimeKeeper::tkMakeTime(2019, 6, 1, 0, 0, 0);
+  backend.setNow(firstTime);
+  testCSV();
+  testSeek();
+  testShortWrite();
+  return endTest("sensor log");
+}
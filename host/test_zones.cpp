@@ -0,0 +1,218 @@
+/**
+ * IIRR -- Intelligent Irrigator Based on ESP8266
+    Copyright (C) 2016--2019  Sergio Queiroz <srmq@cin.ufpe.br>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+//Two zones behind one pump, built with ZONES_ON_BOARD=2: the scheduler
+//keeps a zone out until the minimum interval from its own end, the valve
+//switch restarts a pump stopped by a dose, with a fresh flow reading, but
+//not one cut by the collapse guard, and a simulated week never waters a
+//zone twice in an interval.
+
+#include "HostTest.h"
+#include "FlowMonitor.h"
+#include "ZoneScheduler.h"
+#include "WaterController.h"
+#include "SoilSimulator.h"
+#include "SensorTask.h"
+
+static_assert(ZONES_ON_BOARD == 2, "built with two zones on board");
+
+#define NORMAL_PERIOD_US 10000ul //100 pulses/s
+#define INTERVAL_MINS 60
+
+static const uint8_t VALVE_PINS[2] = {3, 10}; //as in ZONE_PINS of CMakeLists.txt
+
+class VirtualClockBackend : public LinuxHalBackend {
+public:
+  unsigned long nowUs;
+
+  VirtualClockBackend() : nowUs(1000000ul) { }
+  virtual unsigned long micros() override { return nowUs; }
+
+  void pulses(int n) {
+    for (int i = 0; i < n; i++) {
+      nowUs += NORMAL_PERIOD_US;
+      fireInterrupt(FLOWSIGNAL_PIN);
+    }
+  }
+};
+
+//every probe reads dry, so both zones want water all the time
+class DryZonesSimulator : public SoilSimulator {
+public:
+  unsigned long valveOpens[2];
+  unsigned long earlyReopens;
+  unsigned long pumpWithValvesClosed;
+
+  DryZonesSimulator(const SimParams& params) : SoilSimulator(params), earlyReopens(0), pumpWithValvesClosed(0) {
+    for (int z = 0; z < 2; z++) {
+      valveOpens[z] = 0;
+      closedAt[z] = 0;
+      valveIsOpen[z] = false;
+    }
+  }
+
+  virtual void digitalWrite(uint8_t pin, uint8_t val) override {
+    for (int z = 0; z < 2; z++) {
+      if (pin != VALVE_PINS[z]) continue;
+      if (val == HIGH && !valveIsOpen[z]) {
+        valveOpens[z]++;
+        if (closedAt[z] != 0 && (now() - closedAt[z]) <= 60*INTERVAL_MINS) earlyReopens++;
+      } else if (val == LOW && valveIsOpen[z]) {
+        closedAt[z] = now();
+      }
+      valveIsOpen[z] = (val == HIGH);
+    }
+    SoilSimulator::digitalWrite(pin, val);
+    if (digitalRead(PUMP_PIN) == HIGH && !valveIsOpen[0] && !valveIsOpen[1]) pumpWithValvesClosed++;
+  }
+
+  //the divided side of a probe reads at half, far below the critical level
+  virtual int analogRead(uint8_t pin) override {
+    const int readVal = SoilSimulator::analogRead(pin);
+    return (readVal < 990) ? readVal/2 : readVal;
+  }
+
+private:
+  time_t closedAt[2];
+  bool valveIsOpen[2];
+};
+
+static void testScheduler() {
+  ZoneScheduler scheduler;
+  scheduler.setNumZones(2);
+  scheduler.setMinInterval(60*INTERVAL_MINS);
+  const time_t t0 = 1546300800;
+  scheduler.request(0, t0);
+  scheduler.request(1, t0);
+  check(scheduler.takeNext() == 0, "zone 0 goes first");
+  scheduler.beginZone(0, t0);
+  check(scheduler.takeNext() == 1, "zone 1 is next");
+  scheduler.beginZone(1, t0 + 600);
+  check(scheduler.getZoneEnd(0) == t0 + 600, "the switch ends zone 0");
+  scheduler.request(0, t0 + 1200);
+  check(!scheduler.hasPending(), "zone 0 is not queued again before its interval");
+  scheduler.endZone(t0 + 1200);
+  scheduler.request(1, t0 + 1300);
+  check(!scheduler.hasPending(), "zone 1 is not queued again before its interval");
+  scheduler.request(0, t0 + 600 + 60*INTERVAL_MINS + 1);
+  check(scheduler.isPending(0), "zone 0 is queued after its interval");
+}
+
+static void testSelectZone() {
+  VirtualClockBackend backend;
+  Hal::setBackend(&backend);
+  FlowMonitor::begin();
+  mainConfParams.normalPulsesPerSec = 100;
+  mainConfParams.pulsesPerLiter = 100;
+
+  WellPumpWaterController waterControl;
+  check(waterControl.selectZone(0) == WATER_STARTOK, "selecting a zone with the pump off");
+  check(waterControl.startWater() == WATER_STARTOK, "the pump starts");
+  backend.pulses(100);
+  check(Hal::halDigitalRead(VALVE_PINS[0]) == HIGH && Hal::halDigitalRead(VALVE_PINS[1]) == LOW, "only the valve of zone 0 is open");
+
+  //the dose of zone 0 stops the pump, the switch starts it again
+  waterControl.setDoseLiters(0.5, true);
+  backend.pulses(50);
+  check(waterControl.isDoseReached() && Hal::halDigitalRead(PUMP_PIN) == LOW, "the dose stops the pump");
+  check(waterControl.selectZone(1) == WATER_STARTOK, "switching after a dose");
+  check(Hal::halDigitalRead(PUMP_PIN) == HIGH, "the switch restarts a pump stopped by the dose");
+  check(Hal::halDigitalRead(VALVE_PINS[0]) == LOW && Hal::halDigitalRead(VALVE_PINS[1]) == HIGH, "only the valve of zone 1 is open");
+  check(!waterControl.isDoseReached(), "the dose of zone 0 is cleared");
+
+  //the guard is armed again for zone 1: the well runs dry
+  backend.pulses(50);
+  backend.nowUs += 100*NORMAL_PERIOD_US;
+  check(waterControl.isFlowCollapsed() && Hal::halDigitalRead(PUMP_PIN) == LOW, "the guard stops the pump of zone 1");
+  check(waterControl.selectZone(0) == WATER_STARTEMPTY, "switching after a collapse reports the empty well");
+  check(Hal::halDigitalRead(PUMP_PIN) == LOW, "the switch leaves a collapsed pump off");
+  check(waterControl.currStatus() == WATER_CURREMPTY, "the collapse is kept as empty");
+
+  Hal::setBackend(NULL);
+}
+
+//the pump stopped by the dose of zone 0 is off for a while before the switch
+static void testDoseRestart() {
+  VirtualClockBackend backend;
+  Hal::setBackend(&backend);
+  FlowMonitor::begin();
+  mainConfParams.normalPulsesPerSec = 100;
+  mainConfParams.pulsesPerLiter = 100;
+  mainConfParams.flowSettleSecs = 10;
+
+  WellPumpWaterController waterControl;
+  waterControl.selectZone(0);
+  waterControl.startWater();
+  backend.pulses(200);
+  waterControl.setDoseLiters(0.5, true);
+  backend.pulses(50);
+  check(waterControl.isDoseReached() && Hal::halDigitalRead(PUMP_PIN) == LOW, "the dose of zone 0 stops the pump");
+  backend.nowUs += 3000000ul;
+  check(waterControl.selectZone(1) == WATER_STARTOK, "the switch reports the restart");
+
+  bool emptyInSettle = false;
+  for (unsigned int tick = 0; tick < 10*mainConfParams.flowSettleSecs; tick++) {
+    backend.pulses(10);
+    if (waterControl.currStatus() == WATER_CURREMPTY) emptyInSettle = true;
+  }
+  check(!emptyInSettle, "no empty well while zone 1 settles");
+  check(Hal::halDigitalRead(PUMP_PIN) == HIGH, "the pump of zone 1 keeps running");
+  check(waterControl.pumpedLiters() > 12.4 && waterControl.pumpedLiters() < 12.6, "the liters of the run count both zones");
+  check(waterControl.selectZone(0) == WATER_STARTNOACTION, "a running pump is not restarted");
+
+  Hal::setBackend(NULL);
+}
+
+static void testSimulatedWeek(float doseLitersPerLevel) {
+  SimParams simParams;
+  DryZonesSimulator sim(simParams);
+  beginTest(&sim);
+
+  ConfParams confParams;
+  confParams.irrSlotSeconds = 600;
+  confParams.irrMIntervMins = INTERVAL_MINS;
+  confParams.irrMaxTimeDaySeconds = 3600;
+  confParams.critLevel = 0.45;
+  confParams.satLevel = 0.65;
+  confParams.normalPulsesPerSec = 75;
+  confParams.pulsesPerLiter = 450;
+  confParams.numZones = 2;
+  confParams.doseLitersPerLevel = doseLitersPerLevel;
+
+  SensorTask sensorTask;
+  const unsigned long governorStarts = SensorTask::getPumpGovernor().getTotalStarts();
+  const SimStats& stats = sim.run(sensorTask, confParams, 7);
+  printf("zones: dose %.1f starts %lu governor %lu zone0 %lu zone1 %lu earlyReopens %lu\n", doseLitersPerLevel, stats.pumpStarts, SensorTask::getPumpGovernor().getTotalStarts() - governorStarts,
+         sim.valveOpens[0], sim.valveOpens[1], sim.earlyReopens);
+  check(stats.pumpStarts > 0 && stats.dryRunSecs == 0, "the pump runs and never dry");
+  check(sim.valveOpens[0] > 0 && sim.valveOpens[1] > 0, "both zones are watered");
+  check(sim.earlyReopens == 0, "no zone is watered again before the minimum interval");
+  check(sim.pumpWithValvesClosed == 0, "the pump never runs against closed valves");
+  check(SensorTask::getPumpGovernor().getTotalStarts() - governorStarts == stats.pumpStarts, "the governor counts every start of the pump");
+
+  Hal::setBackend(NULL);
+}
+
+int main() {
+  testScheduler();
+  testSelectZone();
+  testDoseRestart();
+  testSimulatedWeek(0);
+  testSimulatedWeek(5);
+  return endTest("zones");
+}
@@ -34,10 +34,24 @@
 //#define NOWATER_SWITCH_PIN D7
 #define FLOWSIGNAL_PIN D7
 #define PUMP_PIN D8
+#define FLOWSENSOR_DECODER_OUTPUT 6
+
+#define MAX_ZONES 4
+#define ZONE_PIN_NONE 0xFF
+//{bankPin, valvePin} of each zone, see ZoneScheduler.h. The NodeMCU pins
+//are all taken, a board with more zones defines both at build time,
+//e.g. -DZONES_ON_BOARD=2 "-DZONE_PINS={1,3},{9,10}"
+#ifndef ZONES_ON_BOARD
+#define ZONES_ON_BOARD 1
+#define ZONE_PINS {ZONE_PIN_NONE, ZONE_PIN_NONE}
+#endif
 
 #define REFERENCE_RESISTOR 4700
 #define NUM_PROBES 11
+#define MIN_PROBES 5
+#define MAX_PROBES 31
 #define SIGNAL_DELAY 10
+#define MUX_SETTLE_DELAY 1
 #define MINAFTERVOLTAGE_OPENCIRCUIT 10
 
 #define AFTERVOLTAGE_OPEN -1